@@ -0,0 +1,393 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Atlas of small I420 streams.
+ *
+ * Each page is a set of three textures, a Y one and two half sized chroma
+ * ones, with one material binding them and one GLSL program shared by all
+ * the pages. A slot is allocated in Y coordinates with shelf packing; the
+ * same rectangle halved holds its chroma in the other two textures. All the
+ * streams of a page are painted with the same material and program, so
+ * neither textures nor shaders change between them.
+ *
+ * This saves texture binds and program changes, not draw calls: every
+ * stream is still painted by its actor with a rectangle of its own, which
+ * Cogl may or may not batch. */
+
+#include "config.h"
+#include <glib.h>
+
+#include "clutter-helix-private.h"
+#include "clutter-helix-shaders.h"
+
+#define ATLAS_PAGE_SIZE  2048
+#define ATLAS_MAX_PAGES  4
+#define ATLAS_PADDING    2   /* around each slot, in Y texels */
+
+typedef struct _ClutterHelixAtlasShelf
+{
+  guint y;
+  guint height;
+  guint x_free;    /* first free column */
+  guint n_slots;
+} ClutterHelixAtlasShelf;
+
+typedef struct _ClutterHelixAtlasPage
+{
+  guint       size;
+  CoglHandle  y_tex;
+  CoglHandle  u_tex;
+  CoglHandle  v_tex;
+  CoglHandle  material;
+  GSList     *shelves;
+  guint       shelf_top;  /* where the next shelf starts */
+  guint       n_slots;
+} ClutterHelixAtlasPage;
+
+struct _ClutterHelixAtlasSlot
+{
+  ClutterHelixAtlasPage  *page;
+  ClutterHelixAtlasShelf *shelf;
+  guint                   x;       /* of the picture, padding excluded */
+  guint                   y;
+  guint                   width;
+  guint                   height;
+};
+
+static GSList     *atlas_pages = NULL;
+static CoglHandle  atlas_program = COGL_INVALID_HANDLE;
+
+static guint
+clutter_helix_atlas_page_size (void)
+{
+  GLint max_size = 0;
+
+  glGetIntegerv (GL_MAX_TEXTURE_SIZE, &max_size);
+
+  return MIN (ATLAS_PAGE_SIZE, max_size);
+}
+
+static ClutterHelixAtlasPage *
+clutter_helix_atlas_page_new (void)
+{
+  ClutterHelixAtlasPage *page;
+
+  page = g_slice_new0 (ClutterHelixAtlasPage);
+  page->size = clutter_helix_atlas_page_size ();
+
+  page->y_tex = cogl_texture_new_with_size (page->size, page->size,
+                                            COGL_TEXTURE_NO_SLICING,
+                                            COGL_PIXEL_FORMAT_G_8);
+  page->u_tex = cogl_texture_new_with_size (page->size / 2, page->size / 2,
+                                            COGL_TEXTURE_NO_SLICING,
+                                            COGL_PIXEL_FORMAT_G_8);
+  page->v_tex = cogl_texture_new_with_size (page->size / 2, page->size / 2,
+                                            COGL_TEXTURE_NO_SLICING,
+                                            COGL_PIXEL_FORMAT_G_8);
+
+  /* same layers as the I420 renderers: the first chroma plane in layer 1 */
+  page->material = cogl_material_new ();
+  cogl_material_set_layer (page->material, 0, page->y_tex);
+  cogl_material_set_layer (page->material, 1, page->u_tex);
+  cogl_material_set_layer (page->material, 2, page->v_tex);
+
+  return page;
+}
+
+static void
+clutter_helix_atlas_page_free (ClutterHelixAtlasPage *page)
+{
+  g_slist_foreach (page->shelves, (GFunc) g_free, NULL);
+  g_slist_free (page->shelves);
+  cogl_material_unref (page->material);
+  cogl_texture_unref (page->y_tex);
+  cogl_texture_unref (page->u_tex);
+  cogl_texture_unref (page->v_tex);
+  g_slice_free (ClutterHelixAtlasPage, page);
+}
+
+static CoglHandle
+clutter_helix_atlas_get_program (void)
+{
+  CoglHandle shader;
+  GLint location;
+
+  if (atlas_program != COGL_INVALID_HANDLE)
+    return atlas_program;
+
+  shader = cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
+  cogl_shader_source (shader, YV12_TO_RGBA_SHADER (YUV_FIXED_VARS,
+                                                    YUV_FIXED_TO_RGB));
+  cogl_shader_compile (shader);
+
+  atlas_program = cogl_create_program ();
+  cogl_program_attach_shader (atlas_program, shader);
+  cogl_program_link (atlas_program);
+  cogl_shader_unref (shader);
+
+  cogl_program_use (atlas_program);
+  location = cogl_program_get_uniform_location (atlas_program, "ytex");
+  cogl_program_uniform_1i (location, 0);
+  location = cogl_program_get_uniform_location (atlas_program, "vtex");
+  cogl_program_uniform_1i (location, 1);
+  location = cogl_program_get_uniform_location (atlas_program, "utex");
+  cogl_program_uniform_1i (location, 2);
+  cogl_program_use (COGL_INVALID_HANDLE);
+
+  return atlas_program;
+}
+
+/* Shelf packing: the best fitting shelf with room left, or a new one */
+static gboolean
+clutter_helix_atlas_page_alloc (ClutterHelixAtlasPage *page,
+                                guint                  width,
+                                guint                  height,
+                                ClutterHelixAtlasSlot *slot)
+{
+  ClutterHelixAtlasShelf *shelf, *best = NULL;
+  GSList *l;
+
+  for (l = page->shelves; l; l = l->next)
+    {
+      shelf = l->data;
+
+      /* an empty shelf can start over */
+      if (shelf->n_slots == 0)
+        shelf->x_free = 0;
+
+      if (shelf->height < height || shelf->height > height + height / 2 ||
+          shelf->x_free + width > page->size)
+        continue;
+
+      if (best == NULL || shelf->height < best->height)
+        best = shelf;
+    }
+
+  if (best == NULL)
+    {
+      if (page->shelf_top + height > page->size || width > page->size)
+        return FALSE;
+
+      best = g_new0 (ClutterHelixAtlasShelf, 1);
+      best->y      = page->shelf_top;
+      best->height = height;
+      page->shelf_top += height;
+      page->shelves = g_slist_prepend (page->shelves, best);
+    }
+
+  slot->page  = page;
+  slot->shelf = best;
+  slot->x     = best->x_free + ATLAS_PADDING;
+  slot->y     = best->y + ATLAS_PADDING;
+
+  best->x_free += width;
+  best->n_slots++;
+  page->n_slots++;
+
+  return TRUE;
+}
+
+/* Gives the empty shelves at the top of @page back, so that shelves of
+ * another height can use the room */
+static void
+clutter_helix_atlas_page_trim (ClutterHelixAtlasPage *page)
+{
+  ClutterHelixAtlasShelf *shelf;
+  gboolean trimmed;
+  GSList *l;
+
+  do
+    {
+      trimmed = FALSE;
+
+      for (l = page->shelves; l; l = l->next)
+        {
+          shelf = l->data;
+
+          if (shelf->n_slots == 0 &&
+              shelf->y + shelf->height == page->shelf_top)
+            {
+              page->shelf_top = shelf->y;
+              page->shelves = g_slist_delete_link (page->shelves, l);
+              g_free (shelf);
+              trimmed = TRUE;
+              break;
+            }
+        }
+    }
+  while (trimmed);
+}
+
+/* Whether a @width x @height stream may go to the atlas on a GL with
+ * @features. The atlas draws with a program of its own, whichever renderer
+ * the stream would get alone doesn't matter. */
+gboolean
+clutter_helix_atlas_accepts (gint  features,
+                             guint width,
+                             guint height)
+{
+  gint needed = CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE;
+
+  return (features & needed) == needed &&
+         width <= CLUTTER_HELIX_ATLAS_MAX_STREAM &&
+         height <= CLUTTER_HELIX_ATLAS_MAX_STREAM;
+}
+
+/* A slot for a @width x @height I420 picture, or NULL if the atlas is full.
+ * Has to be called in the clutter thread. */
+ClutterHelixAtlasSlot *
+clutter_helix_atlas_slot_new (guint width,
+                              guint height)
+{
+  ClutterHelixAtlasSlot *slot;
+  ClutterHelixAtlasPage *page;
+  guint padded_width, padded_height;
+  GSList *l;
+
+  /* even sizes so that the chroma rectangles land on whole texels */
+  padded_width  = (width + 2 * ATLAS_PADDING + 1) & ~1;
+  padded_height = (height + 2 * ATLAS_PADDING + 1) & ~1;
+
+  slot = g_slice_new0 (ClutterHelixAtlasSlot);
+  slot->width  = width;
+  slot->height = height;
+
+  for (l = atlas_pages; l; l = l->next)
+    if (clutter_helix_atlas_page_alloc (l->data,
+                                        padded_width, padded_height,
+                                        slot))
+      return slot;
+
+  if (g_slist_length (atlas_pages) < ATLAS_MAX_PAGES)
+    {
+      page = clutter_helix_atlas_page_new ();
+      atlas_pages = g_slist_append (atlas_pages, page);
+
+      if (clutter_helix_atlas_page_alloc (page,
+                                          padded_width, padded_height,
+                                          slot))
+        return slot;
+    }
+
+  g_slice_free (ClutterHelixAtlasSlot, slot);
+
+  return NULL;
+}
+
+void
+clutter_helix_atlas_slot_free (ClutterHelixAtlasSlot *slot)
+{
+  ClutterHelixAtlasPage *page;
+
+  if (slot == NULL)
+    return;
+
+  page = slot->page;
+  slot->shelf->n_slots--;
+
+  if (--page->n_slots == 0)
+    {
+      atlas_pages = g_slist_remove (atlas_pages, page);
+      clutter_helix_atlas_page_free (page);
+    }
+  else
+    clutter_helix_atlas_page_trim (page);
+
+  g_slice_free (ClutterHelixAtlasSlot, slot);
+}
+
+void
+clutter_helix_atlas_slot_get_size (ClutterHelixAtlasSlot *slot,
+                                   guint                 *width,
+                                   guint                 *height)
+{
+  *width  = slot->width;
+  *height = slot->height;
+}
+
+/* @buffer holds a Y plane and two chroma planes of half the size, rounded
+ * up, at @offsets and @strides bytes apart */
+void
+clutter_helix_atlas_slot_upload (ClutterHelixAtlasSlot *slot,
+                                 const guchar          *buffer,
+                                 const guint           *strides,
+                                 const guint           *offsets)
+{
+  ClutterHelixAtlasPage *page = slot->page;
+  guint w = slot->width, h = slot->height;
+  guint cw = (w + 1) / 2, ch = (h + 1) / 2;
+
+  cogl_texture_set_region (page->y_tex,
+                           0, 0,
+                           slot->x, slot->y,
+                           w, h,
+                           w, h,
+                           COGL_PIXEL_FORMAT_G_8,
+                           strides[0],
+                           buffer + offsets[0]);
+  cogl_texture_set_region (page->u_tex,
+                           0, 0,
+                           slot->x / 2, slot->y / 2,
+                           cw, ch,
+                           cw, ch,
+                           COGL_PIXEL_FORMAT_G_8,
+                           strides[1],
+                           buffer + offsets[1]);
+  cogl_texture_set_region (page->v_tex,
+                           0, 0,
+                           slot->x / 2, slot->y / 2,
+                           cw, ch,
+                           cw, ch,
+                           COGL_PIXEL_FORMAT_G_8,
+                           strides[2],
+                           buffer + offsets[2]);
+}
+
+void
+clutter_helix_atlas_slot_paint (ClutterHelixAtlasSlot *slot,
+                                gfloat                 x_1,
+                                gfloat                 y_1,
+                                gfloat                 x_2,
+                                gfloat                 y_2,
+                                guint8                 opacity)
+{
+  ClutterHelixAtlasPage *page = slot->page;
+  gfloat size = page->size, coords[12];
+  gint i;
+
+  /* inset by half a chroma texel so that linear filtering does not bleed
+   * the neighbouring slots in */
+  coords[0] = (slot->x + 1) / size;
+  coords[1] = (slot->y + 1) / size;
+  coords[2] = (slot->x + slot->width - 1) / size;
+  coords[3] = (slot->y + slot->height - 1) / size;
+  for (i = 4; i < 12; i++)
+    coords[i] = coords[i % 4];
+
+  cogl_material_set_color4ub (page->material,
+                              opacity, opacity, opacity, opacity);
+  cogl_set_source (page->material);
+  cogl_program_use (clutter_helix_atlas_get_program ());
+  cogl_rectangle_with_multitexture_coords (x_1, y_1, x_2, y_2, coords, 12);
+  cogl_program_use (COGL_INVALID_HANDLE);
+}
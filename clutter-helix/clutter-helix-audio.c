@@ -40,6 +40,7 @@
 #include "config.h"
 
 #include "clutter-helix-audio.h"
+#include "clutter-helix-private.h"
 #include "player.h"
 
 #include <glib.h>
@@ -48,6 +49,15 @@ struct _ClutterHelixAudioPrivate
 {
   void             *player;
   char             *uri;
+  ClutterHelixPlayerSlot  slots[2];
+  ClutterHelixPlayerSlot *active;     /* slot playing priv->uri */
+  ClutterHelixPlayerSlot *preroll;    /* slot opening priv->next_uri */
+  char             *next_uri;
+  GMutex           *id_lock;    /* active and the ids set from Helix */
+  gboolean          next_parked;
+  guint             preroll_id;
+  guint             swap_id;
+  guint             hold_id;
   gboolean          can_seek;
   int               buffer_percent;
   gdouble           duration;
@@ -69,7 +79,9 @@ enum {
   PROP_AUDIO_VOLUME,
   PROP_CAN_SEEK,
   PROP_BUFFER_FILL,
-  PROP_DURATION
+  PROP_DURATION,
+
+  PROP_NEXT_URI
 };
 
 #define TICK_TIMEOUT 0.5
@@ -84,6 +96,39 @@ G_DEFINE_TYPE_WITH_CODE (ClutterHelixAudio,
                          G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_MEDIA,
                                                 clutter_media_init));
 
+static void on_pos_length_cb (unsigned int pos,
+                              unsigned int ulLength,
+                              void        *context);
+
+static void on_buffering_cb (unsigned int   flags,
+                             unsigned short percentage,
+                             void          *context);
+
+static void on_state_change_cb (unsigned short old_state,
+                                unsigned short new_state,
+                                void          *context);
+
+static void on_error_cb (unsigned long code,
+                         char         *message,
+                         void         *context);
+
+static void
+clutter_helix_audio_open_player (ClutterHelixAudio      *audio,
+                                 ClutterHelixPlayerSlot *slot)
+{
+  PlayerCallbacks callbacks = {
+    on_pos_length_cb,
+    on_buffering_cb,
+    on_state_change_cb,
+    NULL,
+    on_error_cb
+  };
+
+  slot->owner  = audio;
+  slot->failed = FALSE;
+  get_player (&slot->player, &callbacks, (void *)slot);
+}
+
 /* Interface implementation */
 
 static void
@@ -159,6 +204,127 @@ get_uri (ClutterMedia *media)
   return priv->uri;
 }
 
+/*
+ * Gapless playback
+ *
+ * Same scheme as ClutterHelixVideoTexture: the next URI is opened on a second
+ * player which is started muted, then parked (paused and rewound) as soon as
+ * it reports a position. When the current item ends, the parked player takes
+ * over.
+ */
+
+static void
+clutter_helix_audio_cancel_preroll (ClutterHelixAudio *audio)
+{
+  ClutterHelixAudioPrivate *priv = audio->priv;
+
+  if (priv->next_uri && priv->preroll->player)
+    player_stop (priv->preroll->player);
+
+  g_mutex_lock (priv->id_lock);
+  if (priv->preroll_id > 0)
+    {
+      g_source_remove (priv->preroll_id);
+      priv->preroll_id = 0;
+    }
+  priv->next_parked = FALSE;
+  g_mutex_unlock (priv->id_lock);
+
+  g_free (priv->next_uri);
+  priv->next_uri = NULL;
+}
+
+static gboolean
+preroll_pause_idle_func (gpointer data)
+{
+  ClutterHelixAudio *audio = (ClutterHelixAudio *)data;
+  ClutterHelixAudioPrivate *priv = audio->priv;
+
+  g_mutex_lock (priv->id_lock);
+  priv->preroll_id = 0;
+  g_mutex_unlock (priv->id_lock);
+
+  if (priv->next_uri && priv->preroll->player)
+    {
+      player_pause (priv->preroll->player);
+      player_seek (priv->preroll->player, 0);
+    }
+
+  return FALSE;
+}
+
+static void
+set_next_uri (ClutterHelixAudio *audio,
+              const char        *uri)
+{
+  ClutterHelixAudioPrivate *priv = audio->priv;
+  ClutterHelixPlayerSlot *slot;
+
+  if (!priv->player)
+    return;
+
+  clutter_helix_audio_cancel_preroll (audio);
+
+  slot = priv->preroll;
+  if (uri && slot->player == NULL)
+    clutter_helix_audio_open_player (audio, slot);
+
+  if (uri && slot->player)
+    {
+      priv->next_uri = g_strdup (uri);
+      slot->failed = FALSE;
+
+      player_setvolume (slot->player, 0);
+      player_openurl (slot->player, priv->next_uri);
+      player_begin (slot->player);
+    }
+
+  g_object_notify (G_OBJECT (audio), "next-uri");
+}
+
+static gboolean
+swap_players_idle_func (gpointer data)
+{
+  ClutterHelixAudio *audio = (ClutterHelixAudio *)data;
+  ClutterHelixAudioPrivate *priv = audio->priv;
+  ClutterHelixPlayerSlot *finished;
+  int volume;
+
+  finished = priv->active;
+  volume = player_getvolume (finished->player);
+  player_stop (finished->player);
+
+  g_mutex_lock (priv->id_lock);
+  priv->swap_id = 0;
+  if (priv->preroll_id > 0)
+    {
+      g_source_remove (priv->preroll_id);
+      priv->preroll_id = 0;
+    }
+  priv->active      = priv->preroll;
+  priv->preroll     = finished;
+  priv->player      = priv->active->player;
+  priv->next_parked = FALSE;
+  g_mutex_unlock (priv->id_lock);
+
+  g_free (priv->uri);
+  priv->uri         = priv->next_uri;
+  priv->next_uri    = NULL;
+  priv->can_seek    = player_canseek (priv->player);
+  priv->duration    = 0.0;
+
+  player_setvolume (priv->player, volume < 0 ? 0 : volume);
+  player_begin (priv->player);
+
+  g_object_notify (G_OBJECT (audio), "uri");
+  g_object_notify (G_OBJECT (audio), "next-uri");
+  g_object_notify (G_OBJECT (audio), "can-seek");
+  g_object_notify (G_OBJECT (audio), "duration");
+  g_object_notify (G_OBJECT (audio), "progress");
+
+  return FALSE;
+}
+
 static void
 set_playing (ClutterMedia *media,
 	     gboolean         playing)
@@ -172,6 +338,12 @@ set_playing (ClutterMedia *media,
 
   if (!priv->player)
     return;
+
+  if (priv->hold_id > 0)
+    {
+      g_source_remove (priv->hold_id);
+      priv->hold_id = 0;
+    }
         
   if (priv->uri) 
     {
@@ -241,6 +413,57 @@ get_position (ClutterMedia *media)
   return ((gdouble)position / (gdouble)1000);
 }
 
+/*
+ * Sync group support, see clutter-helix-sync-group.c
+ */
+
+gint64
+clutter_helix_audio_get_time (ClutterHelixAudio *audio)
+{
+  if (!audio->priv->player)
+    return 0;
+
+  return get_curr_playtime (audio->priv->player);
+}
+
+void
+clutter_helix_audio_seek (ClutterHelixAudio *audio,
+                          gint64             position)
+{
+  if (!audio->priv->player)
+    return;
+
+  player_seek (audio->priv->player, position);
+}
+
+static gboolean
+hold_timeout_func (gpointer data)
+{
+  ClutterHelixAudio *audio = CLUTTER_HELIX_AUDIO (data);
+
+  audio->priv->hold_id = 0;
+  player_begin (audio->priv->player);
+
+  return FALSE;
+}
+
+/* Pauses for @duration ms, to let the others catch up */
+void
+clutter_helix_audio_hold (ClutterHelixAudio *audio,
+                          guint              duration)
+{
+  ClutterHelixAudioPrivate *priv = audio->priv;
+
+  if (!priv->player || priv->hold_id > 0 ||
+      priv->state != PLAYER_STATE_PLAYING)
+    return;
+
+  player_pause (priv->player);
+  priv->hold_id = clutter_threads_add_timeout (duration,
+                                               hold_timeout_func,
+                                               audio);
+}
+
 static gdouble get_progress (ClutterMedia *media)
 {
   ClutterHelixAudio *audio = CLUTTER_HELIX_AUDIO(media);
@@ -369,16 +592,40 @@ clutter_helix_audio_dispose (GObject *object)
 {
   ClutterHelixAudio        *self;
   ClutterHelixAudioPrivate *priv; 
+  guint                     i;
 
   self = CLUTTER_HELIX_AUDIO(object); 
   priv = self->priv;
 
   if (priv->player) 
     {
-      put_player(priv->player);
+      clutter_helix_audio_cancel_preroll (self);
+
+      for (i = 0; i < G_N_ELEMENTS (priv->slots); i++)
+        {
+          if (priv->slots[i].player == NULL)
+            continue;
+
+          put_player (priv->slots[i].player);
+          priv->slots[i].player = NULL;
+        }
       priv->player = NULL;
     }
 
+  g_mutex_lock (priv->id_lock);
+  if (priv->swap_id > 0)
+    {
+      g_source_remove (priv->swap_id);
+      priv->swap_id = 0;
+    }
+  g_mutex_unlock (priv->id_lock);
+
+  if (priv->hold_id > 0)
+    {
+      g_source_remove (priv->hold_id);
+      priv->hold_id = 0;
+    }
+
   if (priv->tick_timeout_id > 0) 
     {
       g_source_remove (priv->tick_timeout_id);
@@ -406,6 +653,8 @@ clutter_helix_audio_finalize (GObject *object)
   if (priv->uri)
     g_free (priv->uri);
 
+  g_mutex_free (priv->id_lock);
+
   deinit_main();
 
   G_OBJECT_CLASS (clutter_helix_audio_parent_class)->finalize (object);
@@ -435,6 +684,9 @@ clutter_helix_audio_set_property (GObject      *object,
     case PROP_AUDIO_VOLUME:
       set_volume (CLUTTER_MEDIA(audio), g_value_get_double (value));
       break;
+    case PROP_NEXT_URI:
+      set_next_uri (audio, g_value_get_string (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -475,6 +727,9 @@ clutter_helix_audio_get_property (GObject    *object,
     case PROP_DURATION:
       g_value_set_double (value, get_duration (media));
       break;
+    case PROP_NEXT_URI:
+      g_value_set_string (value, audio->priv->next_uri);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -501,6 +756,21 @@ clutter_helix_audio_class_init (ClutterHelixAudioClass *klass)
   g_object_class_override_property (object_class, PROP_CAN_SEEK, "can-seek");
   g_object_class_override_property (object_class, PROP_DURATION, "duration");
   g_object_class_override_property (object_class, PROP_BUFFER_FILL, "buffer-fill");
+
+  /**
+   * ClutterHelixAudio:next-uri:
+   *
+   * The URI to play once the current one has reached its end. It is opened
+   * and prerolled on a second player in the background so that playback
+   * continues without a gap. No #ClutterMedia::eos is emitted when switching
+   * to the next URI.
+   */
+  g_object_class_install_property (object_class, PROP_NEXT_URI,
+      g_param_spec_string ("next-uri",
+                           "Next URI",
+                           "URI to play after the current one",
+                           NULL,
+                           G_PARAM_READWRITE));
 }
 
 static void
@@ -508,10 +778,21 @@ on_buffering_cb (unsigned int flags,
 		 unsigned short percentage,
 		 void *context)
 {
-  ClutterHelixAudio *audio = (ClutterHelixAudio *)context;
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixAudio *audio = (ClutterHelixAudio *)slot->owner;
+  gboolean active;
 
-  if (audio && audio->priv)
-    audio->priv->buffer_percent = percentage;
+  if (audio == NULL || audio->priv == NULL)
+    return;
+
+  g_mutex_lock (audio->priv->id_lock);
+  active = (slot == audio->priv->active);
+  g_mutex_unlock (audio->priv->id_lock);
+
+  if (!active)
+    return;
+
+  audio->priv->buffer_percent = percentage;
   
   g_object_notify (G_OBJECT (audio), "buffer-fill");
 }
@@ -519,7 +800,8 @@ on_buffering_cb (unsigned int flags,
 static void
 on_pos_length_cb (unsigned int pos, unsigned int ulLength, void *context)
 {
-  ClutterHelixAudio *audio = (ClutterHelixAudio *)context;
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixAudio *audio = (ClutterHelixAudio *)slot->owner;
   ClutterHelixAudioPrivate *priv;
 
   priv = audio->priv;
@@ -527,6 +809,24 @@ on_pos_length_cb (unsigned int pos, unsigned int ulLength, void *context)
   if (!priv->player)
     return;
 
+  g_mutex_lock (priv->id_lock);
+  if (slot != priv->active)
+    {
+      /* the next item is decoding, park it until the current one ends */
+      if (priv->next_uri && !priv->next_parked)
+        {
+          priv->next_parked = TRUE;
+          priv->preroll_id =
+            clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                           preroll_pause_idle_func,
+                                           audio,
+                                           NULL);
+        }
+      g_mutex_unlock (priv->id_lock);
+      return;
+    }
+  g_mutex_unlock (priv->id_lock);
+
   /**
    * Determine the duration.
    **/
@@ -538,12 +838,18 @@ on_pos_length_cb (unsigned int pos, unsigned int ulLength, void *context)
 static void
 on_state_change_cb (unsigned short old_state, unsigned short new_state, void *context)
 {
-  ClutterHelixAudio *audio = (ClutterHelixAudio *)context;
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixAudio *audio = (ClutterHelixAudio *)slot->owner;
   ClutterHelixAudioPrivate *priv;
+  gboolean active;
 
   priv = audio->priv;
 
-  if (!priv->player)
+  g_mutex_lock (priv->id_lock);
+  active = (slot == priv->active);
+  g_mutex_unlock (priv->id_lock);
+
+  if (!priv->player || !active)
     return;
 
   priv->state = new_state;
@@ -553,6 +859,20 @@ on_state_change_cb (unsigned short old_state, unsigned short new_state, void *co
 
   if (old_state != new_state && new_state == PLAYER_STATE_READY) 
     {
+      /* The next item is ready, carry on with it instead of stopping */
+      if (priv->next_uri && !priv->preroll->failed)
+        {
+          g_mutex_lock (priv->id_lock);
+          if (priv->swap_id == 0)
+            priv->swap_id =
+              clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                             swap_players_idle_func,
+                                             audio,
+                                             NULL);
+          g_mutex_unlock (priv->id_lock);
+          return;
+        }
+
       g_object_notify (G_OBJECT (audio), "progress");
       g_signal_emit_by_name (CLUTTER_MEDIA(audio), "eos");
     }
@@ -562,7 +882,20 @@ static void
 on_error_cb (unsigned long code, char *message, void *context)
 {
   GError *error;
-  ClutterHelixAudio *audio = (ClutterHelixAudio *)context;
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixAudio *audio = (ClutterHelixAudio *)slot->owner;
+  gboolean active;
+
+  g_mutex_lock (audio->priv->id_lock);
+  active = (slot == audio->priv->active);
+  g_mutex_unlock (audio->priv->id_lock);
+
+  if (!active)
+    {
+      g_warning ("Failed to preroll %s: %s", audio->priv->next_uri, message);
+      slot->failed = TRUE;
+      return;
+    }
   
   error = g_error_new (g_quark_from_string ("clutter-helix"),
 		       (int) code,  message);
@@ -590,22 +923,17 @@ static void
 clutter_helix_audio_init (ClutterHelixAudio *audio)
 {
   ClutterHelixAudioPrivate *priv;
-  PlayerCallbacks callbacks = {
-    on_pos_length_cb,
-    on_buffering_cb,
-    on_state_change_cb,
-    NULL,
-    on_error_cb
-  };
 
   audio->priv = priv =
     G_TYPE_INSTANCE_GET_PRIVATE (audio,
                                  CLUTTER_HELIX_TYPE_AUDIO,
                                  ClutterHelixAudioPrivate);
+  priv->id_lock = g_mutex_new ();
   priv->state = PLAYER_STATE_READY;
-  get_player(&priv->player,
-	     &callbacks,
-	     (void *)audio);
+  priv->active  = &priv->slots[0];
+  priv->preroll = &priv->slots[1];
+  clutter_helix_audio_open_player (audio, priv->active);
+  priv->player = priv->active->player;
   priv->async_queue = g_async_queue_new ();
 }
 
@@ -0,0 +1,697 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Core programs: GLSL programs built and drawn with the GL 2.0 / GLES2 API
+ * alone, for the core renderers of ClutterHelixVideoTexture.
+ *
+ * The Cogl GLSL path goes through the fixed function state, gl_TexCoord and
+ * gl_Color, which GLES2 only has through the Cogl wrapper shaders. Here the
+ * vertex shader is ours too, fed from a buffer object with the position and
+ * texture coordinates as attributes and the Cogl transform as a uniform.
+ *
+ * On desktop GL the shaders are GLSL 1.30, on a compatibility context: the
+ * attributes are set up without a vertex array object, which a GL 3 core
+ * profile would require.
+ *
+ * Cogl caches some of the GL state, so everything touched between _begin()
+ * and _end() is put back as it was.
+ *
+ * Linked programs are kept on disk where the driver can hand them out, see
+ * "Program binaries" below, so that only the first run pays the compiler. */
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <clutter/clutter.h>
+
+#include "clutter-helix-private.h"
+#include "clutter-helix-shaders.h"
+
+#define POSITION_ATTRIB   0
+#define TEX_COORD_ATTRIB  1
+
+#ifndef GL_SHADING_LANGUAGE_VERSION
+#define GL_SHADING_LANGUAGE_VERSION 0x8B8C
+#endif
+
+/* GL_ARB_get_program_binary, the OES enums have the same values */
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#endif
+
+#define BINARY_MAGIC "CHPB"
+
+typedef GLuint (* CreateShaderFunc)             (GLenum type);
+typedef void   (* ShaderSourceFunc)             (GLuint shader, GLsizei count,
+                                                 const GLchar **string,
+                                                 const GLint *length);
+typedef void   (* CompileShaderFunc)            (GLuint shader);
+typedef void   (* GetShaderivFunc)              (GLuint shader, GLenum pname,
+                                                 GLint *params);
+typedef void   (* GetShaderInfoLogFunc)         (GLuint shader, GLsizei size,
+                                                 GLsizei *length, GLchar *log);
+typedef void   (* DeleteShaderFunc)             (GLuint shader);
+typedef GLuint (* CreateProgramFunc)            (void);
+typedef void   (* AttachShaderFunc)             (GLuint program, GLuint shader);
+typedef void   (* BindAttribLocationFunc)       (GLuint program, GLuint index,
+                                                 const GLchar *name);
+typedef void   (* LinkProgramFunc)              (GLuint program);
+typedef void   (* GetProgramivFunc)             (GLuint program, GLenum pname,
+                                                 GLint *params);
+typedef void   (* GetProgramInfoLogFunc)        (GLuint program, GLsizei size,
+                                                 GLsizei *length, GLchar *log);
+typedef void   (* DeleteProgramFunc)            (GLuint program);
+typedef void   (* UseProgramFunc)               (GLuint program);
+typedef GLint  (* GetUniformLocationFunc)       (GLuint program,
+                                                 const GLchar *name);
+typedef void   (* Uniform1iFunc)                (GLint location, GLint value);
+typedef void   (* Uniform1fFunc)                (GLint location, GLfloat value);
+typedef void   (* Uniform3fvFunc)               (GLint location, GLsizei count,
+                                                 const GLfloat *value);
+typedef void   (* UniformMatrixfvFunc)          (GLint location, GLsizei count,
+                                                 GLboolean transpose,
+                                                 const GLfloat *value);
+typedef void   (* GenBuffersFunc)               (GLsizei n, GLuint *buffers);
+typedef void   (* BindBufferFunc)               (GLenum target, GLuint buffer);
+typedef void   (* BufferDataFunc)               (GLenum target, GLsizeiptr size,
+                                                 const GLvoid *data,
+                                                 GLenum usage);
+typedef void   (* DeleteBuffersFunc)            (GLsizei n, const GLuint *buffers);
+typedef void   (* VertexAttribPointerFunc)      (GLuint index, GLint size,
+                                                 GLenum type,
+                                                 GLboolean normalized,
+                                                 GLsizei stride,
+                                                 const GLvoid *pointer);
+typedef void   (* VertexAttribArrayFunc)        (GLuint index);
+typedef void   (* GetVertexAttribivFunc)        (GLuint index, GLenum pname,
+                                                 GLint *params);
+typedef void   (* ActiveTextureFunc)            (GLenum texture);
+typedef void   (* GetProgramBinaryFunc)         (GLuint program, GLsizei size,
+                                                 GLsizei *length,
+                                                 GLenum *format,
+                                                 GLvoid *binary);
+typedef void   (* ProgramBinaryFunc)            (GLuint program, GLenum format,
+                                                 const GLvoid *binary,
+                                                 GLsizei length);
+typedef void   (* ProgramParameteriFunc)        (GLuint program, GLenum pname,
+                                                 GLint value);
+
+typedef struct _ClutterHelixCoreSymbols
+{
+  CreateShaderFunc        CreateShader;
+  ShaderSourceFunc        ShaderSource;
+  CompileShaderFunc       CompileShader;
+  GetShaderivFunc         GetShaderiv;
+  GetShaderInfoLogFunc    GetShaderInfoLog;
+  DeleteShaderFunc        DeleteShader;
+  CreateProgramFunc       CreateProgram;
+  AttachShaderFunc        AttachShader;
+  BindAttribLocationFunc  BindAttribLocation;
+  LinkProgramFunc         LinkProgram;
+  GetProgramivFunc        GetProgramiv;
+  GetProgramInfoLogFunc   GetProgramInfoLog;
+  DeleteProgramFunc       DeleteProgram;
+  UseProgramFunc          UseProgram;
+  GetUniformLocationFunc  GetUniformLocation;
+  Uniform1iFunc           Uniform1i;
+  Uniform1fFunc           Uniform1f;
+  Uniform3fvFunc          Uniform3fv;
+  UniformMatrixfvFunc     UniformMatrix3fv;
+  UniformMatrixfvFunc     UniformMatrix4fv;
+  GenBuffersFunc          GenBuffers;
+  BindBufferFunc          BindBuffer;
+  BufferDataFunc          BufferData;
+  DeleteBuffersFunc       DeleteBuffers;
+  VertexAttribPointerFunc VertexAttribPointer;
+  VertexAttribArrayFunc   EnableVertexAttribArray;
+  VertexAttribArrayFunc   DisableVertexAttribArray;
+  GetVertexAttribivFunc   GetVertexAttribiv;
+  ActiveTextureFunc       ActiveTexture;
+
+  /* optional, see clutter_helix_core_binaries_available() */
+  GetProgramBinaryFunc    GetProgramBinary;
+  ProgramBinaryFunc       ProgramBinary;
+  ProgramParameteriFunc   ProgramParameteri;
+} ClutterHelixCoreSymbols;
+
+struct _ClutterHelixCoreProgram
+{
+  GLuint    program;
+  GLuint    buffer;            /* the vertices of the quad drawn */
+  GLint     mvp_location;
+  GLint     opacity_location;
+  guint     n_samplers;
+
+  /* GL state saved by clutter_helix_core_program_begin() */
+  GLint     saved_program;
+  GLint     saved_active_texture;
+  GLint     saved_buffer;
+  GLint     saved_textures[CLUTTER_HELIX_CORE_MAX_SAMPLERS];
+  GLint     saved_attribs[2];
+  GLboolean saved_blend;
+  GLint     saved_blend_src;
+  GLint     saved_blend_dst;
+};
+
+static ClutterHelixCoreSymbols gl;
+
+/* GLES2 has the entry points, desktop GL has them from 2.0 on */
+#ifdef HAVE_COGL_GLES2
+#define CORE_PROC(name) ((gpointer) name)
+#else
+#define CORE_PROC(name) ((gpointer) cogl_get_proc_address (#name))
+#endif
+
+#define RESOLVE(func, type) \
+  ((gl.func = (type) CORE_PROC (gl##func)) != NULL)
+
+static gboolean
+clutter_helix_core_resolve (void)
+{
+  return RESOLVE (CreateShader, CreateShaderFunc) &&
+         RESOLVE (ShaderSource, ShaderSourceFunc) &&
+         RESOLVE (CompileShader, CompileShaderFunc) &&
+         RESOLVE (GetShaderiv, GetShaderivFunc) &&
+         RESOLVE (GetShaderInfoLog, GetShaderInfoLogFunc) &&
+         RESOLVE (DeleteShader, DeleteShaderFunc) &&
+         RESOLVE (CreateProgram, CreateProgramFunc) &&
+         RESOLVE (AttachShader, AttachShaderFunc) &&
+         RESOLVE (BindAttribLocation, BindAttribLocationFunc) &&
+         RESOLVE (LinkProgram, LinkProgramFunc) &&
+         RESOLVE (GetProgramiv, GetProgramivFunc) &&
+         RESOLVE (GetProgramInfoLog, GetProgramInfoLogFunc) &&
+         RESOLVE (DeleteProgram, DeleteProgramFunc) &&
+         RESOLVE (UseProgram, UseProgramFunc) &&
+         RESOLVE (GetUniformLocation, GetUniformLocationFunc) &&
+         RESOLVE (Uniform1i, Uniform1iFunc) &&
+         RESOLVE (Uniform1f, Uniform1fFunc) &&
+         RESOLVE (Uniform3fv, Uniform3fvFunc) &&
+         RESOLVE (UniformMatrix3fv, UniformMatrixfvFunc) &&
+         RESOLVE (UniformMatrix4fv, UniformMatrixfvFunc) &&
+         RESOLVE (GenBuffers, GenBuffersFunc) &&
+         RESOLVE (BindBuffer, BindBufferFunc) &&
+         RESOLVE (BufferData, BufferDataFunc) &&
+         RESOLVE (DeleteBuffers, DeleteBuffersFunc) &&
+         RESOLVE (VertexAttribPointer, VertexAttribPointerFunc) &&
+         RESOLVE (EnableVertexAttribArray, VertexAttribArrayFunc) &&
+         RESOLVE (DisableVertexAttribArray, VertexAttribArrayFunc) &&
+         RESOLVE (GetVertexAttribiv, GetVertexAttribivFunc) &&
+         RESOLVE (ActiveTexture, ActiveTextureFunc);
+}
+
+/* Whether the core renderers can run in the current GL context: the entry
+ * points above, and GLSL 1.30 for the desktop flavour of the shaders. */
+gboolean
+clutter_helix_core_program_available (void)
+{
+  static gint available = -1;
+
+  if (available < 0)
+    {
+      available = clutter_helix_core_resolve ();
+
+#ifndef HAVE_COGL_GLES2
+      if (available)
+        {
+          const gchar *version;
+          gint major = 0, minor = 0;
+
+          version = (const gchar *) glGetString (GL_SHADING_LANGUAGE_VERSION);
+          if (version == NULL ||
+              sscanf (version, "%d.%d", &major, &minor) != 2 ||
+              major * 100 + minor < 130)
+            available = FALSE;
+        }
+#endif
+    }
+
+  return available;
+}
+
+static GLuint
+clutter_helix_core_compile (GLenum       type,
+                            const gchar *source)
+{
+  GLuint shader;
+  GLint status;
+
+  shader = gl.CreateShader (type);
+  gl.ShaderSource (shader, 1, (const GLchar **) &source, NULL);
+  gl.CompileShader (shader);
+
+  gl.GetShaderiv (shader, GL_COMPILE_STATUS, &status);
+  if (!status)
+    {
+      gchar log[512];
+
+      gl.GetShaderInfoLog (shader, sizeof (log), NULL, log);
+      g_warning ("Could not compile a core shader: %s", log);
+      gl.DeleteShader (shader);
+      return 0;
+    }
+
+  return shader;
+}
+
+/* Compiles and links the core vertex shader and @fragment_src. Returns 0
+ * if they don't build. */
+static GLuint
+clutter_helix_core_link (const gchar *fragment_src)
+{
+  GLuint vertex, fragment, handle;
+  GLint status;
+
+  vertex = clutter_helix_core_compile (GL_VERTEX_SHADER, CORE_VERTEX_SHADER);
+  fragment = clutter_helix_core_compile (GL_FRAGMENT_SHADER, fragment_src);
+  if (vertex == 0 || fragment == 0)
+    {
+      if (vertex)
+        gl.DeleteShader (vertex);
+      if (fragment)
+        gl.DeleteShader (fragment);
+      return 0;
+    }
+
+  handle = gl.CreateProgram ();
+  gl.AttachShader (handle, vertex);
+  gl.AttachShader (handle, fragment);
+  gl.BindAttribLocation (handle, POSITION_ATTRIB, "position");
+  gl.BindAttribLocation (handle, TEX_COORD_ATTRIB, "tex_coord_in");
+  if (gl.ProgramParameteri)
+    gl.ProgramParameteri (handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  gl.LinkProgram (handle);
+
+  /* the program keeps them as long as it needs them */
+  gl.DeleteShader (vertex);
+  gl.DeleteShader (fragment);
+
+  gl.GetProgramiv (handle, GL_LINK_STATUS, &status);
+  if (!status)
+    {
+      gchar log[512];
+
+      gl.GetProgramInfoLog (handle, sizeof (log), NULL, log);
+      g_warning ("Could not link a core program: %s", log);
+      gl.DeleteProgram (handle);
+      return 0;
+    }
+
+  return handle;
+}
+
+/*
+ * Program binaries
+ *
+ * Under $XDG_CACHE_HOME/clutter-helix/programs, one file per program named
+ * after a hash of the driver (vendor, renderer and version strings) and a
+ * hash of the shader sources. A driver update changes the names, so the
+ * files of other drivers are never loaded; they are left alone, as other
+ * processes or GPUs of the same user may still use them. The files the
+ * driver rejects when loading them get removed right away.
+ *
+ * A file is BINARY_MAGIC, the binary format as 4 bytes, then the binary.
+ */
+
+static gboolean
+clutter_helix_core_binaries_available (void)
+{
+  static gint available = -1;
+  const gchar *extensions;
+  GLint n_formats = 0;
+
+  if (available >= 0)
+    return available;
+
+  extensions = (const gchar *) glGetString (GL_EXTENSIONS);
+
+#ifdef HAVE_COGL_GLES2
+  if (cogl_check_extension ("GL_OES_get_program_binary", extensions))
+    {
+      gl.GetProgramBinary = (GetProgramBinaryFunc)
+        cogl_get_proc_address ("glGetProgramBinaryOES");
+      gl.ProgramBinary = (ProgramBinaryFunc)
+        cogl_get_proc_address ("glProgramBinaryOES");
+    }
+#else
+  if (cogl_check_extension ("GL_ARB_get_program_binary", extensions))
+    {
+      gl.GetProgramBinary = (GetProgramBinaryFunc)
+        cogl_get_proc_address ("glGetProgramBinary");
+      gl.ProgramBinary = (ProgramBinaryFunc)
+        cogl_get_proc_address ("glProgramBinary");
+      gl.ProgramParameteri = (ProgramParameteriFunc)
+        cogl_get_proc_address ("glProgramParameteri");
+    }
+#endif
+
+  /* drivers may have the extension without any format to save to */
+  if (gl.GetProgramBinary && gl.ProgramBinary)
+    glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  available = n_formats > 0;
+
+  return available;
+}
+
+/* the prefix of the names of the files of the current driver */
+static const gchar *
+clutter_helix_core_driver_hash (void)
+{
+  static gchar *hash = NULL;
+
+  if (hash == NULL)
+    {
+      GChecksum *checksum;
+      GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+      const gchar *name;
+      guint i;
+
+      checksum = g_checksum_new (G_CHECKSUM_SHA1);
+      for (i = 0; i < G_N_ELEMENTS (names); i++)
+        {
+          name = (const gchar *) glGetString (names[i]);
+          g_checksum_update (checksum, (const guchar *) (name ? name : ""), -1);
+          g_checksum_update (checksum, (const guchar *) "\n", 1);
+        }
+      hash = g_strndup (g_checksum_get_string (checksum), 16);
+      g_checksum_free (checksum);
+    }
+
+  return hash;
+}
+
+static gchar *
+clutter_helix_core_binary_path (const gchar *fragment_src)
+{
+  GChecksum *checksum;
+  gchar *name, *path;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  g_checksum_update (checksum, (const guchar *) CORE_VERTEX_SHADER, -1);
+  g_checksum_update (checksum, (const guchar *) "", 1);
+  g_checksum_update (checksum, (const guchar *) fragment_src, -1);
+  name = g_strdup_printf ("%s-%s.bin", clutter_helix_core_driver_hash (),
+                          g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  path = g_build_filename (g_get_user_cache_dir (), "clutter-helix",
+                           "programs", name, NULL);
+  g_free (name);
+
+  return path;
+}
+
+/* Returns the program saved at @path, 0 if there's none the driver takes */
+static GLuint
+clutter_helix_core_load_binary (const gchar *path)
+{
+  gchar *contents;
+  gsize length;
+  guint32 format;
+  GLuint handle;
+  GLint status = FALSE;
+
+  if (!g_file_get_contents (path, &contents, &length, NULL))
+    return 0;
+
+  handle = gl.CreateProgram ();
+  if (length > 8 && memcmp (contents, BINARY_MAGIC, 4) == 0)
+    {
+      memcpy (&format, contents + 4, sizeof (format));
+      gl.ProgramBinary (handle, format, contents + 8, length - 8);
+      gl.GetProgramiv (handle, GL_LINK_STATUS, &status);
+    }
+  g_free (contents);
+
+  if (!status)
+    {
+      g_unlink (path);
+      gl.DeleteProgram (handle);
+      return 0;
+    }
+
+  return handle;
+}
+
+static void
+clutter_helix_core_save_binary (GLuint       handle,
+                                const gchar *path)
+{
+  GLint length = 0;
+  GLenum format = 0;
+  guint32 format_32;
+  gchar *contents, *dir;
+
+  gl.GetProgramiv (handle, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  contents = g_malloc (8 + length);
+  gl.GetProgramBinary (handle, length, &length, &format, contents + 8);
+  memcpy (contents, BINARY_MAGIC, 4);
+  format_32 = format;
+  memcpy (contents + 4, &format_32, sizeof (format_32));
+
+  /* not worth a warning, the next run compiles again */
+  dir = g_path_get_dirname (path);
+  if (g_mkdir_with_parents (dir, 0700) == 0)
+    g_file_set_contents (path, contents, 8 + length, NULL);
+
+  g_free (dir);
+  g_free (contents);
+}
+
+/* Builds the program of the core vertex shader and @fragment_src, or loads
+ * it from the disk cache. Texture unit i is bound to the sampler called
+ * @samplers[i]. Returns NULL if the program doesn't build. */
+ClutterHelixCoreProgram *
+clutter_helix_core_program_new (const gchar         *fragment_src,
+                                const gchar * const *samplers,
+                                guint                n_samplers)
+{
+  ClutterHelixCoreProgram *program;
+  GLuint handle = 0;
+  GLint current;
+  gchar *path = NULL;
+  guint i;
+
+  g_return_val_if_fail (n_samplers <= CLUTTER_HELIX_CORE_MAX_SAMPLERS, NULL);
+
+  if (!clutter_helix_core_program_available ())
+    return NULL;
+
+  if (clutter_helix_core_binaries_available ())
+    {
+      path = clutter_helix_core_binary_path (fragment_src);
+      handle = clutter_helix_core_load_binary (path);
+    }
+
+  if (handle == 0)
+    {
+      handle = clutter_helix_core_link (fragment_src);
+      if (handle == 0)
+        {
+          g_free (path);
+          return NULL;
+        }
+
+      if (path)
+        clutter_helix_core_save_binary (handle, path);
+    }
+  g_free (path);
+
+  program = g_slice_new0 (ClutterHelixCoreProgram);
+  program->program          = handle;
+  program->n_samplers       = n_samplers;
+  program->mvp_location     = gl.GetUniformLocation (handle, "mvp");
+  program->opacity_location = gl.GetUniformLocation (handle, "opacity");
+  gl.GenBuffers (1, &program->buffer);
+
+  /* uniforms are not part of the binaries, set them either way */
+  glGetIntegerv (GL_CURRENT_PROGRAM, &current);
+  gl.UseProgram (handle);
+  for (i = 0; i < n_samplers; i++)
+    gl.Uniform1i (gl.GetUniformLocation (handle, samplers[i]), i);
+  gl.UseProgram (current);
+
+  return program;
+}
+
+void
+clutter_helix_core_program_free (ClutterHelixCoreProgram *program)
+{
+  if (program == NULL)
+    return;
+
+  gl.DeleteBuffers (1, &program->buffer);
+  gl.DeleteProgram (program->program);
+  g_slice_free (ClutterHelixCoreProgram, program);
+}
+
+gint
+clutter_helix_core_program_get_uniform (ClutterHelixCoreProgram *program,
+                                        const gchar             *name)
+{
+  return gl.GetUniformLocation (program->program, name);
+}
+
+/* Saves the GL state the program changes, then makes it current with the
+ * Cogl transform. To be paired with clutter_helix_core_program_end(). */
+void
+clutter_helix_core_program_begin (ClutterHelixCoreProgram *program)
+{
+  CoglMatrix modelview, projection, mvp;
+  guint i;
+
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program->saved_program);
+  glGetIntegerv (GL_ACTIVE_TEXTURE, &program->saved_active_texture);
+  glGetIntegerv (GL_ARRAY_BUFFER_BINDING, &program->saved_buffer);
+  for (i = 0; i < program->n_samplers; i++)
+    {
+      gl.ActiveTexture (GL_TEXTURE0 + i);
+      glGetIntegerv (GL_TEXTURE_BINDING_2D, &program->saved_textures[i]);
+    }
+  gl.GetVertexAttribiv (POSITION_ATTRIB, GL_VERTEX_ATTRIB_ARRAY_ENABLED,
+                        &program->saved_attribs[0]);
+  gl.GetVertexAttribiv (TEX_COORD_ATTRIB, GL_VERTEX_ATTRIB_ARRAY_ENABLED,
+                        &program->saved_attribs[1]);
+  program->saved_blend = glIsEnabled (GL_BLEND);
+  glGetIntegerv (GL_BLEND_SRC_RGB, &program->saved_blend_src);
+  glGetIntegerv (GL_BLEND_DST_RGB, &program->saved_blend_dst);
+
+  gl.UseProgram (program->program);
+
+  cogl_get_modelview_matrix (&modelview);
+  cogl_get_projection_matrix (&projection);
+  cogl_matrix_multiply (&mvp, &projection, &modelview);
+  gl.UniformMatrix4fv (program->mvp_location, 1, GL_FALSE,
+                       cogl_matrix_get_array (&mvp));
+
+  /* the fragments are premultiplied by the opacity */
+  glEnable (GL_BLEND);
+  glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  gl.BindBuffer (GL_ARRAY_BUFFER, program->buffer);
+  gl.EnableVertexAttribArray (POSITION_ATTRIB);
+  gl.EnableVertexAttribArray (TEX_COORD_ATTRIB);
+  gl.VertexAttribPointer (POSITION_ATTRIB, 2, GL_FLOAT, GL_FALSE,
+                          4 * sizeof (GLfloat), (const GLvoid *) 0);
+  gl.VertexAttribPointer (TEX_COORD_ATTRIB, 2, GL_FLOAT, GL_FALSE,
+                          4 * sizeof (GLfloat),
+                          (const GLvoid *) (2 * sizeof (GLfloat)));
+}
+
+/* Sets a float, vec3 or mat3 uniform from @n_values floats, between
+ * clutter_helix_core_program_begin() and clutter_helix_core_program_end() */
+void
+clutter_helix_core_program_uniform (ClutterHelixCoreProgram *program,
+                                    gint                     location,
+                                    guint                    n_values,
+                                    const gfloat            *values)
+{
+  g_return_if_fail (n_values == 1 || n_values == 3 || n_values == 9);
+
+  switch (n_values)
+    {
+    case 1:
+      gl.Uniform1f (location, values[0]);
+      break;
+    case 3:
+      gl.Uniform3fv (location, 1, values);
+      break;
+    case 9:
+      gl.UniformMatrix3fv (location, 1, GL_FALSE, values);
+      break;
+    }
+}
+
+/* Draws the rectangle from (@x_1, @y_1) to (@x_2, @y_2) with the part of
+ * @textures from (@s_1, @t_1) to (@s_2, @t_2), one by sampler. */
+void
+clutter_helix_core_program_draw (ClutterHelixCoreProgram *program,
+                                 const CoglHandle        *textures,
+                                 gfloat                   x_1,
+                                 gfloat                   y_1,
+                                 gfloat                   x_2,
+                                 gfloat                   y_2,
+                                 gfloat                   s_1,
+                                 gfloat                   t_1,
+                                 gfloat                   s_2,
+                                 gfloat                   t_2,
+                                 guint8                   opacity)
+{
+  GLfloat vertices[] =
+  {
+    x_1, y_1, s_1, t_1,
+    x_2, y_1, s_2, t_1,
+    x_1, y_2, s_1, t_2,
+    x_2, y_2, s_2, t_2,
+  };
+  GLuint handle;
+  GLenum target;
+  guint i;
+
+  for (i = 0; i < program->n_samplers; i++)
+    {
+      if (textures[i] == COGL_INVALID_HANDLE ||
+          !cogl_texture_get_gl_texture (textures[i], &handle, &target))
+        return;
+
+      gl.ActiveTexture (GL_TEXTURE0 + i);
+      glBindTexture (GL_TEXTURE_2D, handle);
+    }
+
+  gl.Uniform1f (program->opacity_location, opacity / 255.0);
+  gl.BufferData (GL_ARRAY_BUFFER, sizeof (vertices), vertices,
+                 GL_STREAM_DRAW);
+  glDrawArrays (GL_TRIANGLE_STRIP, 0, 4);
+}
+
+/* Puts back the GL state saved by clutter_helix_core_program_begin() */
+void
+clutter_helix_core_program_end (ClutterHelixCoreProgram *program)
+{
+  guint i;
+
+  if (!program->saved_attribs[0])
+    gl.DisableVertexAttribArray (POSITION_ATTRIB);
+  if (!program->saved_attribs[1])
+    gl.DisableVertexAttribArray (TEX_COORD_ATTRIB);
+  gl.BindBuffer (GL_ARRAY_BUFFER, program->saved_buffer);
+
+  glBlendFunc (program->saved_blend_src, program->saved_blend_dst);
+  if (!program->saved_blend)
+    glDisable (GL_BLEND);
+
+  for (i = 0; i < program->n_samplers; i++)
+    {
+      gl.ActiveTexture (GL_TEXTURE0 + i);
+      glBindTexture (GL_TEXTURE_2D, program->saved_textures[i]);
+    }
+  gl.ActiveTexture (program->saved_active_texture);
+
+  gl.UseProgram (program->saved_program);
+}
@@ -0,0 +1,278 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <glib.h>
+
+#include "clutter-helix-private.h"
+
+/* Wraps a buffer handed by Helix. The frame takes ownership of @data. */
+ClutterHelixFrame *
+clutter_helix_frame_new (guchar *data,
+                         guint   size,
+                         guint   width,
+                         guint   height,
+                         gint    cid)
+{
+  ClutterHelixFrame *frame;
+
+  frame = g_slice_new0 (ClutterHelixFrame);
+  frame->data   = data;
+  frame->size   = size;
+  frame->width  = width;
+  frame->height = height;
+  frame->cid    = cid;
+  frame->ref_count = 1;
+
+  return frame;
+}
+
+ClutterHelixFrame *
+clutter_helix_frame_ref (ClutterHelixFrame *frame)
+{
+  g_return_val_if_fail (frame != NULL, NULL);
+
+  g_atomic_int_inc (&frame->ref_count);
+
+  return frame;
+}
+
+/* Drops a reference, the pixels go with the last one */
+void
+clutter_helix_frame_free (ClutterHelixFrame *frame)
+{
+  if (frame == NULL || !g_atomic_int_dec_and_test (&frame->ref_count))
+    return;
+
+  free (frame->data);
+  g_slice_free (ClutterHelixFrame, frame);
+}
+
+/* wall clock time in microseconds, for frame pacing */
+gint64
+clutter_helix_get_time_us (void)
+{
+  GTimeVal now;
+
+  g_get_current_time (&now);
+
+  return (gint64) now.tv_sec * G_USEC_PER_SEC + now.tv_usec;
+}
+
+/*
+ * ClutterHelixFrameCache
+ */
+
+struct _ClutterHelixFrameCache
+{
+  GMutex  *lock;
+  GQueue  *frames;    /* sorted by timestamp */
+  gsize    size;
+  gsize    max_size;
+  guint64  clock;     /* bumped on every insertion / lookup */
+};
+
+ClutterHelixFrameCache *
+clutter_helix_frame_cache_new (gsize max_size)
+{
+  ClutterHelixFrameCache *cache;
+
+  cache = g_slice_new0 (ClutterHelixFrameCache);
+  cache->lock     = g_mutex_new ();
+  cache->frames   = g_queue_new ();
+  cache->max_size = max_size;
+
+  return cache;
+}
+
+void
+clutter_helix_frame_cache_free (ClutterHelixFrameCache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  clutter_helix_frame_cache_clear (cache);
+  g_queue_free (cache->frames);
+  g_mutex_free (cache->lock);
+  g_slice_free (ClutterHelixFrameCache, cache);
+}
+
+void
+clutter_helix_frame_cache_clear (ClutterHelixFrameCache *cache)
+{
+  ClutterHelixFrame *frame;
+
+  g_mutex_lock (cache->lock);
+  while ((frame = g_queue_pop_head (cache->frames)))
+    clutter_helix_frame_free (frame);
+  cache->size = 0;
+  g_mutex_unlock (cache->lock);
+}
+
+static gint
+clutter_helix_frame_compare_use (gconstpointer a,
+                                 gconstpointer b)
+{
+  const ClutterHelixFrame *frame_a = ((GList *) a)->data;
+  const ClutterHelixFrame *frame_b = ((GList *) b)->data;
+
+  return frame_a->last_use < frame_b->last_use ? -1 :
+         frame_a->last_use > frame_b->last_use;
+}
+
+/* Called with cache->lock held. The most recently inserted frame, @keep, is
+ * never evicted so that a cache smaller than a frame still holds one. */
+static void
+clutter_helix_frame_cache_evict (ClutterHelixFrameCache *cache,
+                                 ClutterHelixFrame      *keep)
+{
+  GList *l, *lru = NULL, *link;
+
+  if (cache->size <= cache->max_size)
+    return;
+
+  /* sort the candidates once rather than looking for the least recently used
+   * one for every frame evicted */
+  for (l = cache->frames->head; l; l = l->next)
+    if (l->data != keep)
+      lru = g_list_prepend (lru, l);
+  lru = g_list_sort (lru, clutter_helix_frame_compare_use);
+
+  for (l = lru; l && cache->size > cache->max_size; l = l->next)
+    {
+      ClutterHelixFrame *frame;
+
+      link = l->data;
+      frame = link->data;
+      cache->size -= frame->size;
+      g_queue_delete_link (cache->frames, link);
+      clutter_helix_frame_free (frame);
+    }
+
+  g_list_free (lru);
+}
+
+void
+clutter_helix_frame_cache_set_max_size (ClutterHelixFrameCache *cache,
+                                        gsize                   max_size)
+{
+  g_mutex_lock (cache->lock);
+  cache->max_size = max_size;
+  clutter_helix_frame_cache_evict (cache, NULL);
+  g_mutex_unlock (cache->lock);
+}
+
+gsize
+clutter_helix_frame_cache_get_max_size (ClutterHelixFrameCache *cache)
+{
+  return cache->max_size;
+}
+
+/* Takes ownership of @frame. A frame already cached with the same timestamp
+ * is replaced. */
+void
+clutter_helix_frame_cache_insert (ClutterHelixFrameCache *cache,
+                                  ClutterHelixFrame      *frame)
+{
+  ClutterHelixFrame *other = NULL;
+  GList *l;
+
+  g_mutex_lock (cache->lock);
+
+  /* frames mostly come in order, look for the insertion point backwards */
+  for (l = cache->frames->tail; l; l = l->prev)
+    {
+      other = l->data;
+      if (other->timestamp <= frame->timestamp)
+        break;
+    }
+
+  if (l && other->timestamp == frame->timestamp)
+    {
+      cache->size -= other->size;
+      clutter_helix_frame_free (other);
+      l->data = frame;
+    }
+  else if (l)
+    g_queue_insert_after (cache->frames, l, frame);
+  else
+    g_queue_push_head (cache->frames, frame);
+
+  frame->last_use = ++cache->clock;
+  cache->size += frame->size;
+  clutter_helix_frame_cache_evict (cache, frame);
+
+  g_mutex_unlock (cache->lock);
+}
+
+/* Finds the frame closest to @timestamp, then walks @n_frames frames from
+ * there. Returns a reference to the frame reached, to drop with
+ * clutter_helix_frame_free(), or NULL if the walk leaves the cache or crosses
+ * a hole longer than @max_gap ms. */
+ClutterHelixFrame *
+clutter_helix_frame_cache_step (ClutterHelixFrameCache *cache,
+                                gint64                  timestamp,
+                                gint                    n_frames,
+                                gint64                  max_gap)
+{
+  ClutterHelixFrame *frame, *found = NULL;
+  GList *l, *closest = NULL;
+  gint64 distance, best = G_MAXINT64;
+
+  g_mutex_lock (cache->lock);
+
+  for (l = cache->frames->head; l; l = l->next)
+    {
+      frame = l->data;
+      distance = ABS (frame->timestamp - timestamp);
+      if (distance > best)
+        break;
+      best = distance;
+      closest = l;
+    }
+
+  if (closest == NULL || best > max_gap)
+    goto out;
+
+  for (l = closest; l && n_frames != 0; n_frames += n_frames > 0 ? -1 : 1)
+    {
+      GList *next = n_frames > 0 ? l->next : l->prev;
+
+      if (next == NULL ||
+          ABS (((ClutterHelixFrame *) next->data)->timestamp -
+               ((ClutterHelixFrame *) l->data)->timestamp) > max_gap)
+        goto out;
+
+      l = next;
+    }
+
+  frame = l->data;
+  frame->last_use = ++cache->clock;
+  found = clutter_helix_frame_ref (frame);
+
+out:
+  g_mutex_unlock (cache->lock);
+
+  return found;
+}
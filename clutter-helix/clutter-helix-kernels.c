@@ -0,0 +1,430 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Pixel crunching on decoded frames, before they get uploaded. Every kernel
+ * has a plain C version, the SSE2 ones are used when the compiler targets
+ * it (always the case on x86_64). */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "clutter-helix-private.h"
+
+/*
+ * halve: 2x2 box filter, @width and @height are the size of @src. Odd sizes
+ * round up, the last column or row of @src being used twice.
+ *
+ * The SSE2 versions average the two rows then the two columns, which rounds
+ * up twice instead of once. That's off by one at most, invisible on video.
+ */
+
+/* @odd: the last destination pixel only has one source column */
+static void
+halve_row_c (const guchar *row0,
+             const guchar *row1,
+             guchar       *dst,
+             guint         dst_width,
+             guint         bpp,
+             gboolean      odd)
+{
+  guint x, c, next = bpp;
+
+  for (x = 0; x < dst_width; x++)
+    {
+      if (odd && x == dst_width - 1)
+        next = 0;
+
+      for (c = 0; c < bpp; c++)
+        dst[c] = (row0[c] + row0[next + c] + row1[c] + row1[next + c] + 2) >> 2;
+
+      row0 += 2 * bpp;
+      row1 += 2 * bpp;
+      dst  += bpp;
+    }
+}
+
+#ifdef __SSE2__
+/* 16 destination pixels per iteration, returns how many were done */
+static guint
+halve_row_8_sse2 (const guchar *row0,
+                  const guchar *row1,
+                  guchar       *dst,
+                  guint         dst_width)
+{
+  const __m128i mask = _mm_set1_epi16 (0x00ff);
+  guint x;
+
+  for (x = 0; x + 16 <= dst_width; x += 16)
+    {
+      __m128i a, b, even, odd, lo, hi;
+
+      a = _mm_avg_epu8 (_mm_loadu_si128 ((const __m128i *) (row0 + 2 * x)),
+                        _mm_loadu_si128 ((const __m128i *) (row1 + 2 * x)));
+      b = _mm_avg_epu8 (_mm_loadu_si128 ((const __m128i *) (row0 + 2 * x + 16)),
+                        _mm_loadu_si128 ((const __m128i *) (row1 + 2 * x + 16)));
+
+      /* average even and odd bytes in 16 bit lanes */
+      even = _mm_and_si128 (a, mask);
+      odd  = _mm_srli_epi16 (a, 8);
+      lo   = _mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (even, odd),
+                                            _mm_set1_epi16 (1)), 1);
+      even = _mm_and_si128 (b, mask);
+      odd  = _mm_srli_epi16 (b, 8);
+      hi   = _mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (even, odd),
+                                            _mm_set1_epi16 (1)), 1);
+
+      _mm_storeu_si128 ((__m128i *) (dst + x), _mm_packus_epi16 (lo, hi));
+    }
+
+  return x;
+}
+
+/* 4 destination pixels per iteration, returns how many were done */
+static guint
+halve_row_32_sse2 (const guchar *row0,
+                   const guchar *row1,
+                   guchar       *dst,
+                   guint         dst_width)
+{
+  guint x;
+
+  for (x = 0; x + 4 <= dst_width; x += 4)
+    {
+      __m128 a, b;
+      __m128i even, odd;
+
+      a = _mm_castsi128_ps (
+            _mm_avg_epu8 (_mm_loadu_si128 ((const __m128i *) (row0 + 8 * x)),
+                          _mm_loadu_si128 ((const __m128i *) (row1 + 8 * x))));
+      b = _mm_castsi128_ps (
+            _mm_avg_epu8 (_mm_loadu_si128 ((const __m128i *) (row0 + 8 * x + 16)),
+                          _mm_loadu_si128 ((const __m128i *) (row1 + 8 * x + 16))));
+
+      even = _mm_castps_si128 (_mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0)));
+      odd  = _mm_castps_si128 (_mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1)));
+
+      _mm_storeu_si128 ((__m128i *) (dst + 4 * x), _mm_avg_epu8 (even, odd));
+    }
+
+  return x;
+}
+#endif
+
+void
+clutter_helix_halve_plane (const guchar *src,
+                           guint         src_stride,
+                           guint         width,
+                           guint         height,
+                           guint         bpp,
+                           guchar       *dst,
+                           guint         dst_stride)
+{
+  guint y, done, dst_width = (width + 1) / 2, dst_height = (height + 1) / 2;
+
+  for (y = 0; y < dst_height; y++)
+    {
+      const guchar *row0 = src + 2 * y * src_stride;
+      const guchar *row1 = 2 * y + 1 < height ? row0 + src_stride : row0;
+      guchar *out = dst + y * dst_stride;
+
+      /* the SIMD versions only do whole pairs of source pixels */
+      done = 0;
+#ifdef __SSE2__
+      if (bpp == 1)
+        done = halve_row_8_sse2 (row0, row1, out, width / 2);
+      else if (bpp == 4)
+        done = halve_row_32_sse2 (row0, row1, out, width / 2);
+#endif
+      halve_row_c (row0 + 2 * done * bpp,
+                   row1 + 2 * done * bpp,
+                   out + done * bpp,
+                   dst_width - done,
+                   bpp,
+                   width & 1);
+    }
+}
+
+/*
+ * narrow: 16 bit samples with @depth significant bits, the low ones, down to
+ * 8 bits, rounded to nearest. For high bit depth frames when there is no 16
+ * bit texture format to upload them to.
+ */
+void
+clutter_helix_narrow_plane (const guint16 *src,
+                            gsize          n_samples,
+                            guint          depth,
+                            guchar        *dst)
+{
+  guint shift = depth > 8 ? depth - 8 : 0;
+  guint round = shift ? 1 << (shift - 1) : 0;
+  gsize i = 0;
+
+#ifdef __SSE2__
+  {
+    const __m128i bias  = _mm_set1_epi16 (round);
+    const __m128i count = _mm_cvtsi32_si128 (shift);
+
+    for (; i + 16 <= n_samples; i += 16)
+      {
+        __m128i a, b;
+
+        a = _mm_loadu_si128 ((const __m128i *) (src + i));
+        b = _mm_loadu_si128 ((const __m128i *) (src + i + 8));
+        a = _mm_srl_epi16 (_mm_adds_epu16 (a, bias), count);
+        b = _mm_srl_epi16 (_mm_adds_epu16 (b, bias), count);
+
+        /* saturates the values rounded up to 256 */
+        _mm_storeu_si128 ((__m128i *) (dst + i), _mm_packus_epi16 (a, b));
+      }
+  }
+#endif
+
+  for (; i < n_samples; i++)
+    {
+      guint value = (src[i] + round) >> shift;
+
+      dst[i] = MIN (value, 255);
+    }
+}
+
+/*
+ * hash: 64 bit hash of @height rows of @width bytes, to tell whether a block
+ * of a plane changed since the last frame. Not cryptographic. Two lanes take
+ * 8 bytes each at a time, the bytes past the last 16 of a row go to the
+ * first lane one by one, so both versions give the same hashes.
+ */
+#define HASH_PRIME 0x9e3779b1u
+#define HASH_SEED  G_GUINT64_CONSTANT (0x27d4eb2f165667c5)
+
+static inline guint64
+hash_lane (guint64 lane,
+           guint64 value)
+{
+  lane += value;
+  lane ^= lane >> 31;
+
+  return lane * HASH_PRIME;
+}
+
+#ifdef __SSE2__
+static inline __m128i
+hash_lanes_sse2 (__m128i lanes,
+                 __m128i value)
+{
+  const __m128i prime = _mm_set1_epi32 (HASH_PRIME);
+  __m128i low, high;
+
+  lanes = _mm_add_epi64 (lanes, value);
+  lanes = _mm_xor_si128 (lanes, _mm_srli_epi64 (lanes, 31));
+
+  /* 64 x 32 bit multiplication, from two 32 x 32 bit ones */
+  low  = _mm_mul_epu32 (lanes, prime);
+  high = _mm_mul_epu32 (_mm_srli_epi64 (lanes, 32), prime);
+
+  return _mm_add_epi64 (low, _mm_slli_epi64 (high, 32));
+}
+#endif
+
+guint64
+clutter_helix_hash_block (const guchar *src,
+                          guint         stride,
+                          guint         width,
+                          guint         height)
+{
+  guint64 lanes[2] = { HASH_SEED, ~HASH_SEED };
+  guint x, y;
+
+  for (y = 0; y < height; y++)
+    {
+      const guchar *row = src + y * stride;
+
+      x = 0;
+#ifdef __SSE2__
+      {
+        __m128i acc = _mm_loadu_si128 ((const __m128i *) lanes);
+
+        for (; x + 16 <= width; x += 16)
+          acc = hash_lanes_sse2 (acc,
+                                 _mm_loadu_si128 ((const __m128i *) (row + x)));
+
+        _mm_storeu_si128 ((__m128i *) lanes, acc);
+      }
+#endif
+      for (; x + 16 <= width; x += 16)
+        {
+          guint64 a, b;
+
+          memcpy (&a, row + x, 8);
+          memcpy (&b, row + x + 8, 8);
+          lanes[0] = hash_lane (lanes[0], GUINT64_FROM_LE (a));
+          lanes[1] = hash_lane (lanes[1], GUINT64_FROM_LE (b));
+        }
+
+      for (; x < width; x++)
+        lanes[0] = hash_lane (lanes[0], row[x]);
+    }
+
+  return hash_lane (lanes[0], lanes[1]);
+}
+
+/*
+ * colors: how the YUV renderers go to RGB. @values gets the y, u and v
+ * columns of a 3x3 matrix then an offset, rgb = matrix * (y, u, v) + offset
+ * with the samples as read, between 0 and 1. Contrast scales the luma
+ * around its middle, brightness shifts it, saturation scales the chroma.
+ */
+void
+clutter_helix_yuv_matrix (gboolean  bt709,
+                          gboolean  full_range,
+                          gdouble   brightness,
+                          gdouble   contrast,
+                          gdouble   saturation,
+                          gfloat   *values)
+{
+  gdouble kr, kb, kg, y_scale, y_offset, c_scale, a, d, e;
+  gdouble rv, gu, gv, bu;
+  gfloat *m = values;
+
+  if (bt709)
+    {
+      kr = 0.2126;
+      kb = 0.0722;
+    }
+  else
+    {
+      kr = 0.299;
+      kb = 0.114;
+    }
+  kg = 1.0 - kr - kb;
+
+  if (full_range)
+    {
+      y_scale  = 1.0;
+      y_offset = 0.0;
+      c_scale  = 1.0;
+    }
+  else
+    {
+      y_scale  = 255.0 / 219.0;
+      y_offset = -16.0 / 219.0;
+      c_scale  = 255.0 / 224.0;
+    }
+
+  /* Y' = a * y + d, U' = e * (u - 0.5), V' = e * (v - 0.5) */
+  a = contrast * y_scale;
+  d = contrast * y_offset + 0.5 * (1.0 - contrast) + brightness;
+  e = saturation * c_scale;
+
+  rv = 2.0 * (1.0 - kr);
+  gu = -2.0 * (1.0 - kb) * kb / kg;
+  gv = -2.0 * (1.0 - kr) * kr / kg;
+  bu = 2.0 * (1.0 - kb);
+
+  /* y, u and v columns */
+  m[0] = a;      m[1] = a;      m[2] = a;
+  m[3] = 0;      m[4] = e * gu; m[5] = e * bu;
+  m[6] = e * rv; m[7] = e * gv; m[8] = 0;
+
+  /* offset */
+  m[9]  = d - 0.5 * e * rv;
+  m[10] = d - 0.5 * e * (gu + gv);
+  m[11] = d - 0.5 * e * bu;
+}
+
+/* Chroma sample @i of a row of @n interleaved UV pairs, clamped to the edges
+ * as the texture is */
+static inline const guchar *
+uv_at (const guchar *row,
+       gint          i,
+       gint          n)
+{
+  return row + 2 * CLAMP (i, 0, n - 1);
+}
+
+/*
+ * nv12 to rgb: CPU reference of the NV12 renderers, see NV12_TO_RGBA_SHADER,
+ * converting with @values from clutter_helix_yuv_matrix(). Chroma is
+ * interpolated the way the shader does: by hand horizontally, so that U and
+ * V don't mix, and like linear texture filtering vertically. Slow, meant to
+ * check the renderers against.
+ */
+void
+clutter_helix_nv12_to_rgb (const guchar *y_plane,
+                           guint         y_stride,
+                           const guchar *uv_plane,
+                           guint         uv_stride,
+                           guint         width,
+                           guint         height,
+                           const gfloat *values,
+                           guchar       *rgb,
+                           guint         rgb_stride)
+{
+  gint cw = (width + 1) / 2, ch = (height + 1) / 2;
+  guint x, y, c;
+
+  for (y = 0; y < height; y++)
+    {
+      gdouble fy = (y + 0.5) * ch / height - 0.5;
+      gint j = (gint) (fy + 1.0) - 1; /* floor, fy may be -0.25 */
+      gdouble wy = fy - j;
+      const guchar *row0 = uv_plane + CLAMP (j, 0, ch - 1) * uv_stride;
+      const guchar *row1 = uv_plane + CLAMP (j + 1, 0, ch - 1) * uv_stride;
+
+      for (x = 0; x < width; x++)
+        {
+          gdouble fx = (x + 0.5) * cw / width - 0.5;
+          gint i = (gint) (fx + 1.0) - 1;
+          gdouble wx = fx - i, yuv[3];
+          guchar *out = rgb + y * rgb_stride + 3 * x;
+
+          yuv[0] = y_plane[y * y_stride + x] / 255.0;
+
+          for (c = 0; c < 2; c++)
+            {
+              /* each pair sampled at its texel centre, so linear filtering
+               * only mixes the rows */
+              gdouble left  = (1 - wy) * uv_at (row0, i, cw)[c] +
+                              wy * uv_at (row1, i, cw)[c];
+              gdouble right = (1 - wy) * uv_at (row0, i + 1, cw)[c] +
+                              wy * uv_at (row1, i + 1, cw)[c];
+
+              yuv[1 + c] = ((1 - wx) * left + wx * right) / 255.0;
+            }
+
+          for (c = 0; c < 3; c++)
+            {
+              gdouble value = values[c] * yuv[0] +
+                              values[3 + c] * yuv[1] +
+                              values[6 + c] * yuv[2] +
+                              values[9 + c];
+
+              out[c] = CLAMP (value * 255.0 + 0.5, 0, 255);
+            }
+        }
+    }
+}
@@ -0,0 +1,315 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Internal helpers shared between the Clutter-Helix objects. Nothing in
+ * here is installed or part of the public API. */
+
+#ifndef _HAVE_CLUTTER_HELIX_PRIVATE_H
+#define _HAVE_CLUTTER_HELIX_PRIVATE_H
+
+#include <glib.h>
+#include <clutter/clutter.h>
+
+#include "clutter-helix-video-texture.h"
+#include "clutter-helix-audio.h"
+#include "clutter-helix-sync-group.h"
+
+G_BEGIN_DECLS
+
+/*
+ * features: what the GL of the stage supports, the renderers of
+ * ClutterHelixVideoTexture say which they need
+ */
+typedef enum _ClutterHelixFeatures
+{
+  CLUTTER_HELIX_FP             = 0x1, /* fragment programs (ARB fp1.0) */
+  CLUTTER_HELIX_GLSL           = 0x2, /* GLSL */
+  CLUTTER_HELIX_MULTI_TEXTURE  = 0x4, /* multi-texturing */
+  CLUTTER_HELIX_TEXTURE_16     = 0x8, /* 16 bit luminance textures */
+  CLUTTER_HELIX_MULTI_TEXTURE_4 = 0x10, /* 4 texture units */
+  CLUTTER_HELIX_GL_CORE        = 0x20, /* GLES2 / GLSL 1.30 shaders, no Cogl */
+} ClutterHelixFeatures;
+
+/*
+ * player slot: the context handed to the Helix callbacks.
+ *
+ * A media object owns more than one Helix player when it prerolls the next
+ * item of a playlist, so the callbacks need to know which of them fired.
+ */
+typedef struct _ClutterHelixPlayerSlot
+{
+  gpointer  owner;   /* the ClutterMedia object owning the player */
+  void     *player;  /* the Helix player, NULL until get_player() */
+  gboolean  failed;  /* the player reported an error while prerolling */
+} ClutterHelixPlayerSlot;
+
+/*
+ * frame: a decoded picture handed to us by Helix.
+ *
+ * The pixel data is allocated by Helix with malloc(), so frames always
+ * release it with free(). Frames are reference counted,
+ * clutter_helix_frame_free() drops a reference.
+ */
+typedef enum _ClutterHelixFrameFlags
+{
+  CLUTTER_HELIX_FRAME_BOTTOM_FIRST = 1 << 0, /* field order, if interlaced */
+} ClutterHelixFrameFlags;
+
+typedef struct _ClutterHelixFrame
+{
+  guchar  *data;
+  guint    size;
+  guint    width;
+  guint    height;
+  gint     cid;
+  guint    flags;      /* ClutterHelixFrameFlags */
+  gint64   timestamp;  /* stream time, in ms */
+  guint64  last_use;   /* LRU stamp, see ClutterHelixFrameCache */
+  gint     ref_count;
+} ClutterHelixFrame;
+
+ClutterHelixFrame *clutter_helix_frame_new  (guchar                  *data,
+                                             guint                    size,
+                                             guint                    width,
+                                             guint                    height,
+                                             gint                     cid);
+ClutterHelixFrame *clutter_helix_frame_ref  (ClutterHelixFrame       *frame);
+void               clutter_helix_frame_free (ClutterHelixFrame       *frame);
+
+gint64             clutter_helix_get_time_us (void);
+
+/*
+ * frame cache: decoded frames sorted by timestamp, bounded in bytes and
+ * evicted least recently used first. Safe to use from several threads.
+ */
+typedef struct _ClutterHelixFrameCache ClutterHelixFrameCache;
+
+ClutterHelixFrameCache *clutter_helix_frame_cache_new   (gsize                   max_size);
+void                    clutter_helix_frame_cache_free  (ClutterHelixFrameCache *cache);
+void                    clutter_helix_frame_cache_clear (ClutterHelixFrameCache *cache);
+void                    clutter_helix_frame_cache_set_max_size
+                                                        (ClutterHelixFrameCache *cache,
+                                                         gsize                   max_size);
+gsize                   clutter_helix_frame_cache_get_max_size
+                                                        (ClutterHelixFrameCache *cache);
+void                    clutter_helix_frame_cache_insert (ClutterHelixFrameCache *cache,
+                                                          ClutterHelixFrame      *frame);
+ClutterHelixFrame      *clutter_helix_frame_cache_step   (ClutterHelixFrameCache *cache,
+                                                          gint64                  timestamp,
+                                                          gint                    n_frames,
+                                                          gint64                  max_gap);
+
+/*
+ * kernels: CPU processing of decoded planes, see clutter-helix-kernels.c
+ */
+void clutter_helix_halve_plane (const guchar *src,
+                                guint         src_stride,
+                                guint         width,
+                                guint         height,
+                                guint         bpp,
+                                guchar       *dst,
+                                guint         dst_stride);
+void clutter_helix_narrow_plane (const guint16 *src,
+                                 gsize          n_samples,
+                                 guint          depth,
+                                 guchar        *dst);
+guint64 clutter_helix_hash_block (const guchar *src,
+                                  guint         stride,
+                                  guint         width,
+                                  guint         height);
+void clutter_helix_yuv_matrix (gboolean  bt709,
+                               gboolean  full_range,
+                               gdouble   brightness,
+                               gdouble   contrast,
+                               gdouble   saturation,
+                               gfloat   *values);
+void clutter_helix_nv12_to_rgb (const guchar *y_plane,
+                                guint         y_stride,
+                                const guchar *uv_plane,
+                                guint         uv_stride,
+                                guint         width,
+                                guint         height,
+                                const gfloat *values,
+                                guchar       *rgb,
+                                guint         rgb_stride);
+
+/*
+ * texture budget: process-wide accounting of the texture memory used by the
+ * video textures, see clutter_helix_set_texture_budget().
+ *
+ * @evict is called on the least recently painted owners, in the clutter
+ * thread, until the budget is met. It returns FALSE if it can't free anything.
+ */
+typedef gboolean (* ClutterHelixEvictFunc) (gpointer owner);
+
+void     clutter_helix_texture_budget_add    (gpointer              owner,
+                                              ClutterHelixEvictFunc evict);
+void     clutter_helix_texture_budget_remove (gpointer              owner);
+void     clutter_helix_texture_budget_update (gpointer              owner,
+                                              gsize                 bytes);
+void     clutter_helix_texture_budget_touch  (gpointer              owner);
+gboolean clutter_helix_texture_budget_fits   (gsize                 extra_bytes);
+
+/*
+ * atlas: shared textures packing the planes of small I420 streams, see
+ * clutter-helix-atlas.c. To be used in the clutter thread only.
+ */
+#define CLUTTER_HELIX_ATLAS_MAX_STREAM 640 /* larger streams get their own */
+
+typedef struct _ClutterHelixAtlasSlot ClutterHelixAtlasSlot;
+
+gboolean               clutter_helix_atlas_accepts       (gint                   features,
+                                                          guint                  width,
+                                                          guint                  height);
+
+ClutterHelixAtlasSlot *clutter_helix_atlas_slot_new      (guint                  width,
+                                                          guint                  height);
+void                   clutter_helix_atlas_slot_free     (ClutterHelixAtlasSlot *slot);
+void                   clutter_helix_atlas_slot_get_size (ClutterHelixAtlasSlot *slot,
+                                                          guint                 *width,
+                                                          guint                 *height);
+void                   clutter_helix_atlas_slot_upload   (ClutterHelixAtlasSlot *slot,
+                                                          const guchar          *buffer,
+                                                          const guint           *strides,
+                                                          const guint           *offsets);
+void                   clutter_helix_atlas_slot_paint    (ClutterHelixAtlasSlot *slot,
+                                                          gfloat                 x_1,
+                                                          gfloat                 y_1,
+                                                          gfloat                 x_2,
+                                                          gfloat                 y_2,
+                                                          guint8                 opacity);
+
+/*
+ * uploader: a thread uploading frames from a GL context sharing textures
+ * with the one of the stage, see clutter-helix-uploader.c. Planes are 8 bit
+ * luminance or 32 bit BGRA.
+ *
+ * @done is called in the upload thread with each frame uploaded.
+ */
+#define CLUTTER_HELIX_UPLOAD_MAX_PLANES 3
+
+typedef struct _ClutterHelixUploadPlane
+{
+  guint offset;
+  guint stride;
+  guint width;       /* of the plane in the frame */
+  guint height;
+  guint tex_width;   /* of the texture it goes to */
+  guint tex_height;
+  guint bpp;         /* 1 or 4 */
+} ClutterHelixUploadPlane;
+
+typedef struct _ClutterHelixUploader ClutterHelixUploader;
+
+typedef void (* ClutterHelixUploadFunc) (ClutterHelixFrame *frame,
+                                         gpointer           data);
+
+ClutterHelixUploader *clutter_helix_uploader_new  (ClutterHelixUploadFunc         done,
+                                                   gpointer                       data);
+void                  clutter_helix_uploader_free (ClutterHelixUploader          *uploader);
+ClutterHelixFrame    *clutter_helix_uploader_push (ClutterHelixUploader          *uploader,
+                                                   ClutterHelixFrame             *frame,
+                                                   const ClutterHelixUploadPlane *planes,
+                                                   guint                          n_planes);
+gboolean              clutter_helix_uploader_swap (ClutterHelixUploader          *uploader,
+                                                   const ClutterHelixFrame       *frame,
+                                                   CoglHandle                    *textures,
+                                                   guint                         *n_textures);
+gsize                 clutter_helix_uploader_get_size (ClutterHelixUploader      *uploader);
+
+/*
+ * core programs: GLSL programs for GLES2 and GLSL 1.30, drawn
+ * without Cogl, see clutter-helix-core-program.c. To be used in the clutter
+ * thread only.
+ */
+#define CLUTTER_HELIX_CORE_MAX_SAMPLERS 4
+
+typedef struct _ClutterHelixCoreProgram ClutterHelixCoreProgram;
+
+gboolean                 clutter_helix_core_program_available   (void);
+ClutterHelixCoreProgram *clutter_helix_core_program_new         (const gchar             *fragment_src,
+                                                                 const gchar * const     *samplers,
+                                                                 guint                    n_samplers);
+void                     clutter_helix_core_program_free        (ClutterHelixCoreProgram *program);
+gint                     clutter_helix_core_program_get_uniform (ClutterHelixCoreProgram *program,
+                                                                 const gchar             *name);
+void                     clutter_helix_core_program_begin       (ClutterHelixCoreProgram *program);
+void                     clutter_helix_core_program_uniform     (ClutterHelixCoreProgram *program,
+                                                                 gint                     location,
+                                                                 guint                    n_values,
+                                                                 const gfloat            *values);
+void                     clutter_helix_core_program_draw        (ClutterHelixCoreProgram *program,
+                                                                 const CoglHandle        *textures,
+                                                                 gfloat                   x_1,
+                                                                 gfloat                   y_1,
+                                                                 gfloat                   x_2,
+                                                                 gfloat                   y_2,
+                                                                 gfloat                   s_1,
+                                                                 gfloat                   t_1,
+                                                                 gfloat                   s_2,
+                                                                 gfloat                   t_2,
+                                                                 guint8                   opacity);
+void                     clutter_helix_core_program_end         (ClutterHelixCoreProgram *program);
+
+/*
+ * ClutterHelixVideoTexture internals used by ClutterHelixVideoClone
+ */
+void clutter_helix_video_texture_paint_frame  (ClutterHelixVideoTexture *video_texture,
+                                               gfloat                    x_1,
+                                               gfloat                    y_1,
+                                               gfloat                    x_2,
+                                               gfloat                    y_2,
+                                               guint8                    opacity);
+void clutter_helix_video_texture_add_clone    (ClutterHelixVideoTexture *video_texture,
+                                               ClutterActor             *clone);
+void clutter_helix_video_texture_remove_clone (ClutterHelixVideoTexture *video_texture,
+                                               ClutterActor             *clone);
+void clutter_helix_video_texture_queue_flush_hidden
+                                              (ClutterHelixVideoTexture *video_texture);
+void clutter_helix_video_texture_painted      (ClutterHelixVideoTexture *video_texture,
+                                               ClutterActor             *actor);
+
+/*
+ * sync groups, see clutter-helix-sync-group.c. Times are in ms.
+ */
+gint64 clutter_helix_sync_group_get_clock (ClutterHelixSyncGroup *group);
+guint  clutter_helix_sync_group_get_delay (ClutterHelixSyncGroup *group,
+                                           gint64                 timestamp);
+
+gint64 clutter_helix_video_texture_get_time       (ClutterHelixVideoTexture *video_texture);
+void   clutter_helix_video_texture_seek           (ClutterHelixVideoTexture *video_texture,
+                                                   gint64                    position);
+void   clutter_helix_video_texture_hold           (ClutterHelixVideoTexture *video_texture,
+                                                   guint                     duration);
+void   clutter_helix_video_texture_set_sync_group (ClutterHelixVideoTexture *video_texture,
+                                                   ClutterHelixSyncGroup    *group);
+
+gint64 clutter_helix_audio_get_time (ClutterHelixAudio *audio);
+void   clutter_helix_audio_seek     (ClutterHelixAudio *audio,
+                                     gint64             position);
+void   clutter_helix_audio_hold     (ClutterHelixAudio *audio,
+                                     guint              duration);
+
+G_END_DECLS
+
+#endif
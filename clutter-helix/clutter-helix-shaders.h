@@ -39,5 +39,266 @@
 #define FRAGMENT_SHADER_END                             \
      "  gl_FragColor = gl_FragColor * " COLOR_VAR ";"
 
+/* YUV to RGB, from the y, u and v samples as read (0.0 to 1.0) to color.
+ * The fixed conversion is BT.601 with limited range, the matrix one is
+ * whatever is in the color_matrix and color_offset uniforms. The shaders
+ * below take the vars and convert parts of either. */
+#define YUV_FIXED_VARS ""
+
+#define YUV_FIXED_TO_RGB                                        \
+     "  y = 1.1640625 * (y - 0.0625);"                          \
+     "  u = u - 0.5;"                                           \
+     "  v = v - 0.5;"                                           \
+     "  color.r = y + 1.59765625 * v;"                          \
+     "  color.g = y - 0.390625 * u - 0.8125 * v;"               \
+     "  color.b = y + 2.015625 * u;"
+
+#define YUV_MATRIX_VARS                                         \
+     "uniform mat3 color_matrix;"                               \
+     "uniform vec3 color_offset;"
+
+#define YUV_MATRIX_TO_RGB                                       \
+     "  color.rgb = color_matrix * vec3 (y, u, v) + color_offset;"
+
+/* Luma of planar YUV, progressive or deinterlaced. luma_height is the
+ * number of rows of ytex, field the parity of the lines of the field shown,
+ * 0.0 for the top one. Bob interpolates between the lines of the field,
+ * blend filters the lines with their neighbours. */
+#define LUMA_PROGRESSIVE_VARS ""
+
+#define LUMA_PROGRESSIVE                                        \
+     "  float y = texture2D (ytex, coord).g;"
+
+#define LUMA_FIELD_VARS                                         \
+     "uniform float luma_height;"                               \
+     "uniform float field;"
+
+#define LUMA_BOB                                                \
+     "  float r = (coord.y * luma_height - 0.5 - field) * 0.5;" \
+     "  float k = floor (r);"                                   \
+     "  float y = mix (texture2D (ytex, vec2 (coord.x, (2.0 * k + field + 0.5) / luma_height)).g," \
+     "                 texture2D (ytex, vec2 (coord.x, (2.0 * k + field + 2.5) / luma_height)).g," \
+     "                 r - k);"
+
+#define LUMA_BLEND                                              \
+     "  float dy = 1.0 / luma_height;"                          \
+     "  float y = 0.5 * texture2D (ytex, coord).g +"            \
+     "            0.25 * texture2D (ytex, vec2 (coord.x, coord.y - dy)).g +" \
+     "            0.25 * texture2D (ytex, vec2 (coord.x, coord.y + dy)).g;"
+
+/* planar YUV 4:2:0 to RGBA, with the Y, V and U planes in the ytex, vtex and
+ * utex samplers */
+#define YV12_TO_RGBA_SHADER(vars, convert)                      \
+     YV12_FIELDS_TO_RGBA_SHADER (vars, convert,                 \
+                                 LUMA_PROGRESSIVE_VARS, LUMA_PROGRESSIVE)
+
+#define YV12_FIELDS_TO_RGBA_SHADER(vars, convert, luma_vars, luma) \
+     FRAGMENT_SHADER_VARS                                       \
+     vars                                                       \
+     luma_vars                                                  \
+     "uniform sampler2D ytex;"                                  \
+     "uniform sampler2D utex;"                                  \
+     "uniform sampler2D vtex;"                                  \
+     "void main () {"                                           \
+     "  vec2 coord = vec2(" TEX_COORD ");"                      \
+     luma                                                       \
+     "  float u = texture2D (utex, coord).g;"                   \
+     "  float v = texture2D (vtex, coord).g;"                   \
+     "  vec4 color;"                                            \
+     convert                                                    \
+     "  color.a = 1.0;"                                         \
+     "  gl_FragColor = color;"                                  \
+     FRAGMENT_SHADER_END                                        \
+     "}"
+
+/* the same with a straight alpha plane in atex, premultiplied here as the
+ * blending of the materials expects */
+#define YUVA_TO_RGBA_SHADER(vars, convert)                      \
+     FRAGMENT_SHADER_VARS                                       \
+     vars                                                       \
+     "uniform sampler2D ytex;"                                  \
+     "uniform sampler2D utex;"                                  \
+     "uniform sampler2D vtex;"                                  \
+     "uniform sampler2D atex;"                                  \
+     "void main () {"                                           \
+     "  vec2 coord = vec2(" TEX_COORD ");"                      \
+     "  float y = texture2D (ytex, coord).g;"                   \
+     "  float u = texture2D (utex, coord).g;"                   \
+     "  float v = texture2D (vtex, coord).g;"                   \
+     "  vec4 color;"                                            \
+     convert                                                    \
+     "  color.a = texture2D (atex, coord).a;"                   \
+     "  color.rgb = clamp (color.rgb, 0.0, 1.0) * color.a;"     \
+     "  gl_FragColor = color;"                                  \
+     FRAGMENT_SHADER_END                                        \
+     "}"
+
+/* the same with samples of more than 8 bits in 16 bit textures, scale maps
+ * the largest sample value to 1.0 */
+#define YV12_16_TO_RGBA_SHADER(vars, convert)                   \
+     FRAGMENT_SHADER_VARS                                       \
+     vars                                                       \
+     "uniform sampler2D ytex;"                                  \
+     "uniform sampler2D utex;"                                  \
+     "uniform sampler2D vtex;"                                  \
+     "uniform float scale;"                                     \
+     "void main () {"                                           \
+     "  vec2 coord = vec2(" TEX_COORD ");"                      \
+     "  float y = texture2D (ytex, coord).g * scale;"           \
+     "  float u = texture2D (utex, coord).g * scale;"           \
+     "  float v = texture2D (vtex, coord).g * scale;"           \
+     "  vec4 color;"                                            \
+     convert                                                    \
+     "  color.a = 1.0;"                                         \
+     "  gl_FragColor = color;"                                  \
+     FRAGMENT_SHADER_END                                        \
+     "}"
+
+/* semi-planar YUV 4:2:0 to RGBA: the Y plane in ytex, the interleaved U and
+ * V plane as a single channel texture twice chroma_width wide in uvtex. The
+ * chroma samples are fetched at texel centers, so that linear filtering does
+ * not mix U with V, and interpolated horizontally here */
+#define NV12_TO_RGBA_SHADER(vars, convert)                      \
+     FRAGMENT_SHADER_VARS                                       \
+     vars                                                       \
+     "uniform sampler2D ytex;"                                  \
+     "uniform sampler2D uvtex;"                                 \
+     "uniform float chroma_width;"                              \
+     "vec2 uv_at (float i, float t) {"                          \
+     "  float x = clamp (i, 0.0, chroma_width - 1.0);"          \
+     "  return vec2 (texture2D (uvtex, vec2 ((x + 0.25) / chroma_width, t)).g," \
+     "               texture2D (uvtex, vec2 ((x + 0.75) / chroma_width, t)).g);" \
+     "}"                                                        \
+     "void main () {"                                           \
+     "  vec2 coord = vec2(" TEX_COORD ");"                      \
+     "  float x = coord.x * chroma_width - 0.5;"                \
+     "  float i = floor (x);"                                   \
+     "  vec2 uv = mix (uv_at (i, coord.y), uv_at (i + 1.0, coord.y), x - i);" \
+     "  float y = texture2D (ytex, coord).g;"                   \
+     "  float u = uv.x;"                                        \
+     "  float v = uv.y;"                                        \
+     "  vec4 color;"                                            \
+     convert                                                    \
+     "  color.a = 1.0;"                                         \
+     "  gl_FragColor = color;"                                  \
+     FRAGMENT_SHADER_END                                        \
+     "}"
+
+/* packed YUV 4:2:2 to RGBA: the frame is uploaded as an RGBA texture of half
+ * the width, each texel holding two pixels. y0, u, y1 and v are the
+ * components of the texel holding those samples. The texel of the pixel is
+ * fetched at its center, so that linear filtering only works vertically */
+#define PACKED_422_TO_RGBA_SHADER(y0, u, y1, v, vars, convert)  \
+     FRAGMENT_SHADER_VARS                                       \
+     vars                                                       \
+     "uniform sampler2D tex;"                                   \
+     "uniform float width;"                                     \
+     "void main () {"                                           \
+     "  vec2 coord = vec2(" TEX_COORD ");"                      \
+     "  float x = floor (coord.x * width);"                     \
+     "  float texel = floor (x * 0.5);"                         \
+     "  vec4 p = texture2D (tex, vec2 ((texel + 0.5) * 2.0 / width, coord.y));" \
+     "  float y = mix (p." y0 ", p." y1 ", x - 2.0 * texel);"  \
+     "  float u = p." u ";"                                     \
+     "  float v = p." v ";"                                     \
+     "  vec4 color;"                                            \
+     convert                                                    \
+     "  color.a = 1.0;"                                         \
+     "  gl_FragColor = color;"                                  \
+     FRAGMENT_SHADER_END                                        \
+     "}"
+
+/* Core shaders: GLSL for GLES2 and GLSL 1.30, built and drawn
+ * without Cogl, see clutter-helix-core-program.c. They use none of the
+ * fixed function built-ins: the vertex shader gets the position and the
+ * texture coordinates as attributes and the transform in the mvp uniform,
+ * the fragment shader gets the opacity in a uniform. Single channel planes
+ * are read from .r, as luminance and red textures both have it. */
+#ifdef HAVE_COGL_GLES2
+
+#define CORE_VERSION              \
+  "#version 100\n"                \
+  "precision mediump float;\n"
+#define CORE_ATTRIBUTE   "attribute "
+#define CORE_VARYING_OUT "varying "
+#define CORE_VARYING_IN  "varying "
+#define CORE_FRAG_VARS   ""
+#define CORE_FRAG_COLOR  "gl_FragColor"
+#define CORE_TEXTURE     "texture2D"
+
+#else /* HAVE_COGL_GLES2 */
+
+#define CORE_VERSION     "#version 130\n"
+#define CORE_ATTRIBUTE   "in "
+#define CORE_VARYING_OUT "out "
+#define CORE_VARYING_IN  "in "
+#define CORE_FRAG_VARS   "out vec4 frag_color;"
+#define CORE_FRAG_COLOR  "frag_color"
+#define CORE_TEXTURE     "texture"
+
+#endif /* HAVE_COGL_GLES2 */
+
+#define CORE_VERTEX_SHADER                                      \
+     CORE_VERSION                                               \
+     "uniform mat4 mvp;"                                        \
+     CORE_ATTRIBUTE "vec2 position;"                            \
+     CORE_ATTRIBUTE "vec2 tex_coord_in;"                        \
+     CORE_VARYING_OUT "vec2 tex_coord;"                         \
+     "void main () {"                                           \
+     "  gl_Position = mvp * vec4 (position, 0.0, 1.0);"         \
+     "  tex_coord = tex_coord_in;"                              \
+     "}"
+
+#define CORE_FRAGMENT_VARS                                      \
+     CORE_VERSION                                               \
+     CORE_VARYING_IN "vec2 tex_coord;"                          \
+     CORE_FRAG_VARS                                             \
+     "uniform float opacity;"
+
+/* the color is premultiplied by the opacity, as the blending expects */
+#define CORE_FRAGMENT_END                                       \
+     "  color.a = 1.0;"                                         \
+     "  " CORE_FRAG_COLOR " = color * opacity;"
+
+/* planar YUV 4:2:0, see YV12_TO_RGBA_SHADER */
+#define YV12_TO_RGBA_CORE_SHADER(vars, convert)                 \
+     CORE_FRAGMENT_VARS                                         \
+     vars                                                       \
+     "uniform sampler2D ytex;"                                  \
+     "uniform sampler2D utex;"                                  \
+     "uniform sampler2D vtex;"                                  \
+     "void main () {"                                           \
+     "  float y = " CORE_TEXTURE " (ytex, tex_coord).r;"        \
+     "  float u = " CORE_TEXTURE " (utex, tex_coord).r;"        \
+     "  float v = " CORE_TEXTURE " (vtex, tex_coord).r;"        \
+     "  vec4 color;"                                            \
+     convert                                                    \
+     CORE_FRAGMENT_END                                          \
+     "}"
+
+/* semi-planar YUV 4:2:0, see NV12_TO_RGBA_SHADER */
+#define NV12_TO_RGBA_CORE_SHADER(vars, convert)                 \
+     CORE_FRAGMENT_VARS                                         \
+     vars                                                       \
+     "uniform sampler2D ytex;"                                  \
+     "uniform sampler2D uvtex;"                                 \
+     "uniform float chroma_width;"                              \
+     "vec2 uv_at (float i, float t) {"                          \
+     "  float x = clamp (i, 0.0, chroma_width - 1.0);"          \
+     "  return vec2 (" CORE_TEXTURE " (uvtex, vec2 ((x + 0.25) / chroma_width, t)).r," \
+     "               " CORE_TEXTURE " (uvtex, vec2 ((x + 0.75) / chroma_width, t)).r);" \
+     "}"                                                        \
+     "void main () {"                                           \
+     "  float x = tex_coord.x * chroma_width - 0.5;"            \
+     "  float i = floor (x);"                                   \
+     "  vec2 uv = mix (uv_at (i, tex_coord.y), uv_at (i + 1.0, tex_coord.y), x - i);" \
+     "  float y = " CORE_TEXTURE " (ytex, tex_coord).r;"        \
+     "  float u = uv.x;"                                        \
+     "  float v = uv.y;"                                        \
+     "  vec4 color;"                                            \
+     convert                                                    \
+     CORE_FRAGMENT_END                                          \
+     "}"
+
 #endif
 
@@ -0,0 +1,682 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:clutter-helix-sync-group
+ * @short_description: Frame locked playback of several media
+ *
+ * #ClutterHelixSyncGroup keeps the #ClutterHelixVideoTexture and
+ * #ClutterHelixAudio added to it on one timeline, for instance the tiles of
+ * a video wall. The timeline follows the master set with
+ * clutter_helix_sync_group_set_master(), or the system clock when there is
+ * none.
+ *
+ * Video frames ahead of the timeline are held until it reaches them, and
+ * repeated meanwhile; late ones are shown at once. Members drifting further
+ * than #ClutterHelixSyncGroup:seek-threshold are paused for a moment when
+ * ahead and moved forward when behind. The spread of the members around the
+ * timeline is reported by #ClutterHelixSyncGroup:skew.
+ *
+ * Holding and seeking are the only corrections: Helix plays at the normal
+ * rate only, so members are neither sped up nor slowed down, and late video
+ * frames are not dropped to catch up. Small drifts, below the seek
+ * threshold, are thus left as they are.
+ */
+
+#include "config.h"
+
+#include "clutter-helix-sync-group.h"
+#include "clutter-helix-video-texture.h"
+#include "clutter-helix-audio.h"
+#include "clutter-helix-private.h"
+
+#include <glib.h>
+
+#define SYNC_TICK_INTERVAL      100 /* ms between drift checks */
+#define SYNC_SEEK_LEAD          100 /* ms to seek past the timeline, to cover
+                                       the time the seek itself takes */
+#define SYNC_SEEK_TIMEOUT       2000 /* ms to wait for a seek to land before
+                                        trying again */
+#define DEFAULT_TOLERANCE       20  /* ms */
+#define DEFAULT_SEEK_THRESHOLD  250 /* ms */
+
+struct _ClutterHelixSyncGroupPrivate
+{
+  GSList       *members;
+  GHashTable   *seeks;      /* member -> ClutterHelixSyncSeek in flight */
+  ClutterMedia *master;
+  gboolean      playing;
+  gint64        base_ms;    /* timeline position at base_time */
+  gint64        base_time;  /* us */
+  guint         tick_id;
+  guint         tolerance;
+  guint         seek_threshold;
+  gdouble       skew;
+};
+
+enum {
+  PROP_0,
+  PROP_MASTER,
+  PROP_PLAYING,
+  PROP_TOLERANCE,
+  PROP_SEEK_THRESHOLD,
+  PROP_SKEW
+};
+
+typedef struct _ClutterHelixSyncSeek
+{
+  gint64 target;  /* ms */
+  gint64 time;    /* when it was asked, in us */
+} ClutterHelixSyncSeek;
+
+G_DEFINE_TYPE (ClutterHelixSyncGroup,
+               clutter_helix_sync_group,
+               G_TYPE_OBJECT);
+
+/*
+ * Members
+ */
+
+static gint64
+clutter_helix_sync_member_get_time (ClutterMedia *media)
+{
+  if (CLUTTER_HELIX_IS_VIDEO_TEXTURE (media))
+    return clutter_helix_video_texture_get_time (CLUTTER_HELIX_VIDEO_TEXTURE (media));
+
+  return clutter_helix_audio_get_time (CLUTTER_HELIX_AUDIO (media));
+}
+
+static void
+clutter_helix_sync_member_seek (ClutterMedia *media,
+                                gint64        position)
+{
+  if (CLUTTER_HELIX_IS_VIDEO_TEXTURE (media))
+    clutter_helix_video_texture_seek (CLUTTER_HELIX_VIDEO_TEXTURE (media),
+                                      position);
+  else
+    clutter_helix_audio_seek (CLUTTER_HELIX_AUDIO (media), position);
+}
+
+/* Seeks @media and remembers it until it reports a position past the
+ * target, so that the tick doesn't seek it again meanwhile */
+static void
+clutter_helix_sync_group_seek_member (ClutterHelixSyncGroup *group,
+                                      ClutterMedia          *media,
+                                      gint64                 position)
+{
+  ClutterHelixSyncSeek *seek;
+
+  seek = g_new0 (ClutterHelixSyncSeek, 1);
+  seek->target = position;
+  seek->time   = clutter_helix_get_time_us ();
+  g_hash_table_insert (group->priv->seeks, media, seek);
+
+  clutter_helix_sync_member_seek (media, position);
+}
+
+/* Whether @media is still on its way to the position it was sent to, given
+ * its current @time */
+static gboolean
+clutter_helix_sync_group_seeking (ClutterHelixSyncGroup *group,
+                                  ClutterMedia          *media,
+                                  gint64                 time)
+{
+  ClutterHelixSyncGroupPrivate *priv = group->priv;
+  ClutterHelixSyncSeek *seek;
+
+  seek = g_hash_table_lookup (priv->seeks, media);
+  if (seek == NULL)
+    return FALSE;
+
+  if (time + priv->seek_threshold >= seek->target ||
+      clutter_helix_get_time_us () - seek->time > SYNC_SEEK_TIMEOUT * 1000)
+    {
+      g_hash_table_remove (priv->seeks, media);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+clutter_helix_sync_member_hold (ClutterMedia *media,
+                                guint         duration)
+{
+  if (CLUTTER_HELIX_IS_VIDEO_TEXTURE (media))
+    clutter_helix_video_texture_hold (CLUTTER_HELIX_VIDEO_TEXTURE (media),
+                                      duration);
+  else
+    clutter_helix_audio_hold (CLUTTER_HELIX_AUDIO (media), duration);
+}
+
+/*
+ * Timeline
+ */
+
+/* Current position of the timeline, in ms */
+gint64
+clutter_helix_sync_group_get_clock (ClutterHelixSyncGroup *group)
+{
+  ClutterHelixSyncGroupPrivate *priv = group->priv;
+
+  if (priv->master)
+    return clutter_helix_sync_member_get_time (priv->master);
+
+  if (!priv->playing)
+    return priv->base_ms;
+
+  return priv->base_ms +
+         (clutter_helix_get_time_us () - priv->base_time) / 1000;
+}
+
+/* How long to hold a video frame stamped @timestamp before showing it */
+guint
+clutter_helix_sync_group_get_delay (ClutterHelixSyncGroup *group,
+                                    gint64                 timestamp)
+{
+  ClutterHelixSyncGroupPrivate *priv = group->priv;
+  gint64 ahead;
+
+  if (!priv->playing)
+    return 0;
+
+  ahead = timestamp - clutter_helix_sync_group_get_clock (group);
+
+  /* further ahead is for the tick to fix, holding would freeze the picture */
+  if (ahead <= priv->tolerance || ahead > priv->seek_threshold)
+    return 0;
+
+  return ahead;
+}
+
+static gboolean
+clutter_helix_sync_group_tick (gpointer data)
+{
+  ClutterHelixSyncGroup *group = CLUTTER_HELIX_SYNC_GROUP (data);
+  ClutterHelixSyncGroupPrivate *priv = group->priv;
+  gint64 clock, time, offset, min = G_MAXINT64, max = G_MININT64;
+  gdouble skew = 0;
+  GSList *l;
+
+  clock = clutter_helix_sync_group_get_clock (group);
+
+  for (l = priv->members; l; l = l->next)
+    {
+      ClutterMedia *media = l->data;
+
+      time = clutter_helix_sync_member_get_time (media);
+      offset = time - clock;
+      min = MIN (min, offset);
+      max = MAX (max, offset);
+
+      if (media == priv->master ||
+          clutter_helix_sync_group_seeking (group, media, time))
+        continue;
+
+      if (offset < -(gint64) priv->seek_threshold)
+        clutter_helix_sync_group_seek_member (group, media,
+                                              clock + SYNC_SEEK_LEAD);
+      else if (offset > priv->seek_threshold)
+        clutter_helix_sync_member_hold (media, offset);
+    }
+
+  if (priv->members && priv->members->next)
+    skew = max - min;
+
+  if (skew != priv->skew)
+    {
+      priv->skew = skew;
+      g_object_notify (G_OBJECT (group), "skew");
+    }
+
+  return TRUE;
+}
+
+/*
+ * GObject
+ */
+
+static void
+clutter_helix_sync_group_set_property (GObject      *object,
+                                       guint         property_id,
+                                       const GValue *value,
+                                       GParamSpec   *pspec)
+{
+  ClutterHelixSyncGroup *group = CLUTTER_HELIX_SYNC_GROUP (object);
+
+  switch (property_id)
+    {
+    case PROP_MASTER:
+      clutter_helix_sync_group_set_master (group, g_value_get_object (value));
+      break;
+    case PROP_PLAYING:
+      clutter_helix_sync_group_set_playing (group, g_value_get_boolean (value));
+      break;
+    case PROP_TOLERANCE:
+      group->priv->tolerance = g_value_get_uint (value);
+      break;
+    case PROP_SEEK_THRESHOLD:
+      group->priv->seek_threshold = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+clutter_helix_sync_group_get_property (GObject    *object,
+                                       guint       property_id,
+                                       GValue     *value,
+                                       GParamSpec *pspec)
+{
+  ClutterHelixSyncGroup *group = CLUTTER_HELIX_SYNC_GROUP (object);
+
+  switch (property_id)
+    {
+    case PROP_MASTER:
+      g_value_set_object (value, group->priv->master);
+      break;
+    case PROP_PLAYING:
+      g_value_set_boolean (value, group->priv->playing);
+      break;
+    case PROP_TOLERANCE:
+      g_value_set_uint (value, group->priv->tolerance);
+      break;
+    case PROP_SEEK_THRESHOLD:
+      g_value_set_uint (value, group->priv->seek_threshold);
+      break;
+    case PROP_SKEW:
+      g_value_set_double (value, group->priv->skew);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+clutter_helix_sync_group_dispose (GObject *object)
+{
+  ClutterHelixSyncGroup *group = CLUTTER_HELIX_SYNC_GROUP (object);
+  ClutterHelixSyncGroupPrivate *priv = group->priv;
+
+  if (priv->tick_id > 0)
+    {
+      g_source_remove (priv->tick_id);
+      priv->tick_id = 0;
+    }
+
+  while (priv->members)
+    clutter_helix_sync_group_remove (group, priv->members->data);
+
+  G_OBJECT_CLASS (clutter_helix_sync_group_parent_class)->dispose (object);
+}
+
+static void
+clutter_helix_sync_group_finalize (GObject *object)
+{
+  ClutterHelixSyncGroup *group = CLUTTER_HELIX_SYNC_GROUP (object);
+
+  g_hash_table_destroy (group->priv->seeks);
+
+  G_OBJECT_CLASS (clutter_helix_sync_group_parent_class)->finalize (object);
+}
+
+static void
+clutter_helix_sync_group_class_init (ClutterHelixSyncGroupClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (ClutterHelixSyncGroupPrivate));
+
+  object_class->dispose      = clutter_helix_sync_group_dispose;
+  object_class->finalize     = clutter_helix_sync_group_finalize;
+  object_class->set_property = clutter_helix_sync_group_set_property;
+  object_class->get_property = clutter_helix_sync_group_get_property;
+
+  /**
+   * ClutterHelixSyncGroup:master:
+   *
+   * The member whose position drives the timeline, usually the one playing
+   * the audio. When %NULL, the timeline follows the system clock.
+   */
+  g_object_class_install_property (object_class, PROP_MASTER,
+      g_param_spec_object ("master",
+                           "Master",
+                           "Member driving the timeline",
+                           CLUTTER_TYPE_MEDIA,
+                           G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixSyncGroup:playing:
+   *
+   * Whether the members are playing.
+   */
+  g_object_class_install_property (object_class, PROP_PLAYING,
+      g_param_spec_boolean ("playing",
+                            "Playing",
+                            "Whether the members are playing",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixSyncGroup:tolerance:
+   *
+   * How far ahead of the timeline, in ms, a video frame may be shown.
+   * Frames further ahead are held until the timeline reaches them.
+   */
+  g_object_class_install_property (object_class, PROP_TOLERANCE,
+      g_param_spec_uint ("tolerance",
+                         "Tolerance",
+                         "Frames further ahead are held, in ms",
+                         0, G_MAXUINT,
+                         DEFAULT_TOLERANCE,
+                         G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixSyncGroup:seek-threshold:
+   *
+   * Drift, in ms, past which a member is corrected: paused for a moment
+   * when ahead of the timeline, moved forward when behind.
+   */
+  g_object_class_install_property (object_class, PROP_SEEK_THRESHOLD,
+      g_param_spec_uint ("seek-threshold",
+                         "Seek threshold",
+                         "Drift corrected by pausing or seeking, in ms",
+                         0, G_MAXUINT,
+                         DEFAULT_SEEK_THRESHOLD,
+                         G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixSyncGroup:skew:
+   *
+   * Distance, in ms, between the members furthest ahead and furthest
+   * behind, updated 10 times a second while playing.
+   */
+  g_object_class_install_property (object_class, PROP_SKEW,
+      g_param_spec_double ("skew",
+                           "Skew",
+                           "Spread of the members positions, in ms",
+                           0, G_MAXDOUBLE,
+                           0,
+                           G_PARAM_READABLE));
+}
+
+static void
+clutter_helix_sync_group_init (ClutterHelixSyncGroup *group)
+{
+  ClutterHelixSyncGroupPrivate *priv;
+
+  group->priv = priv =
+    G_TYPE_INSTANCE_GET_PRIVATE (group,
+                                 CLUTTER_HELIX_TYPE_SYNC_GROUP,
+                                 ClutterHelixSyncGroupPrivate);
+
+  priv->seeks          = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                NULL, g_free);
+  priv->tolerance      = DEFAULT_TOLERANCE;
+  priv->seek_threshold = DEFAULT_SEEK_THRESHOLD;
+}
+
+/**
+ * clutter_helix_sync_group_new:
+ *
+ * Creates an empty sync group, following the system clock.
+ *
+ * Return value: the newly created #ClutterHelixSyncGroup
+ */
+ClutterHelixSyncGroup *
+clutter_helix_sync_group_new (void)
+{
+  return g_object_new (CLUTTER_HELIX_TYPE_SYNC_GROUP, NULL);
+}
+
+/**
+ * clutter_helix_sync_group_add:
+ * @group: a #ClutterHelixSyncGroup
+ * @media: a #ClutterHelixVideoTexture or a #ClutterHelixAudio
+ *
+ * Adds @media to @group. A media can only belong to one group at a time.
+ */
+void
+clutter_helix_sync_group_add (ClutterHelixSyncGroup *group,
+                              ClutterMedia          *media)
+{
+  ClutterHelixSyncGroupPrivate *priv;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group));
+  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (media) ||
+                    CLUTTER_HELIX_IS_AUDIO (media));
+
+  priv = group->priv;
+
+  if (g_slist_find (priv->members, media))
+    return;
+
+  priv->members = g_slist_append (priv->members, g_object_ref (media));
+
+  if (CLUTTER_HELIX_IS_VIDEO_TEXTURE (media))
+    clutter_helix_video_texture_set_sync_group (CLUTTER_HELIX_VIDEO_TEXTURE (media),
+                                                group);
+}
+
+/**
+ * clutter_helix_sync_group_remove:
+ * @group: a #ClutterHelixSyncGroup
+ * @media: a member of @group
+ *
+ * Removes @media from @group, it plays on its own again.
+ */
+void
+clutter_helix_sync_group_remove (ClutterHelixSyncGroup *group,
+                                 ClutterMedia          *media)
+{
+  ClutterHelixSyncGroupPrivate *priv;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group));
+
+  priv = group->priv;
+
+  if (!g_slist_find (priv->members, media))
+    return;
+
+  if (media == priv->master)
+    clutter_helix_sync_group_set_master (group, NULL);
+
+  if (CLUTTER_HELIX_IS_VIDEO_TEXTURE (media))
+    clutter_helix_video_texture_set_sync_group (CLUTTER_HELIX_VIDEO_TEXTURE (media),
+                                                NULL);
+
+  g_hash_table_remove (priv->seeks, media);
+  priv->members = g_slist_remove (priv->members, media);
+  g_object_unref (media);
+}
+
+/**
+ * clutter_helix_sync_group_set_master:
+ * @group: a #ClutterHelixSyncGroup
+ * @master: a member of @group, or %NULL
+ *
+ * Makes the timeline of @group follow @master, or the system clock if
+ * @master is %NULL.
+ */
+void
+clutter_helix_sync_group_set_master (ClutterHelixSyncGroup *group,
+                                     ClutterMedia          *master)
+{
+  ClutterHelixSyncGroupPrivate *priv;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group));
+
+  priv = group->priv;
+
+  if (master && !g_slist_find (priv->members, master))
+    {
+      g_warning ("The master of a sync group has to be one of its members");
+      return;
+    }
+
+  /* carry on from where the master left the timeline */
+  if (priv->master && master == NULL)
+    {
+      priv->base_ms   = clutter_helix_sync_member_get_time (priv->master);
+      priv->base_time = clutter_helix_get_time_us ();
+    }
+
+  priv->master = master;
+
+  g_object_notify (G_OBJECT (group), "master");
+}
+
+/**
+ * clutter_helix_sync_group_get_master:
+ * @group: a #ClutterHelixSyncGroup
+ *
+ * Retrieves the member driving the timeline of @group.
+ *
+ * Return value: the master of @group, or %NULL if it follows the system
+ *   clock
+ */
+ClutterMedia *
+clutter_helix_sync_group_get_master (ClutterHelixSyncGroup *group)
+{
+  g_return_val_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group), NULL);
+
+  return group->priv->master;
+}
+
+/**
+ * clutter_helix_sync_group_set_playing:
+ * @group: a #ClutterHelixSyncGroup
+ * @playing: whether to play
+ *
+ * Starts or pauses all the members of @group at once.
+ */
+void
+clutter_helix_sync_group_set_playing (ClutterHelixSyncGroup *group,
+                                      gboolean               playing)
+{
+  ClutterHelixSyncGroupPrivate *priv;
+  GSList *l;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group));
+
+  priv = group->priv;
+
+  if (priv->playing == playing)
+    return;
+
+  if (playing)
+    priv->base_time = clutter_helix_get_time_us ();
+  else
+    priv->base_ms = clutter_helix_sync_group_get_clock (group);
+
+  priv->playing = playing;
+
+  for (l = priv->members; l; l = l->next)
+    clutter_media_set_playing (l->data, playing);
+
+  if (playing)
+    priv->tick_id = clutter_threads_add_timeout (SYNC_TICK_INTERVAL,
+                                                 clutter_helix_sync_group_tick,
+                                                 group);
+  else if (priv->tick_id > 0)
+    {
+      g_source_remove (priv->tick_id);
+      priv->tick_id = 0;
+    }
+
+  g_object_notify (G_OBJECT (group), "playing");
+}
+
+/**
+ * clutter_helix_sync_group_get_playing:
+ * @group: a #ClutterHelixSyncGroup
+ *
+ * Retrieves whether @group is playing.
+ *
+ * Return value: %TRUE if the members of @group are playing
+ */
+gboolean
+clutter_helix_sync_group_get_playing (ClutterHelixSyncGroup *group)
+{
+  g_return_val_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group), FALSE);
+
+  return group->priv->playing;
+}
+
+/**
+ * clutter_helix_sync_group_set_position:
+ * @group: a #ClutterHelixSyncGroup
+ * @position: the position to seek to, in seconds
+ *
+ * Moves all the members of @group to @position.
+ */
+void
+clutter_helix_sync_group_set_position (ClutterHelixSyncGroup *group,
+                                       gdouble                position)
+{
+  ClutterHelixSyncGroupPrivate *priv;
+  GSList *l;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group));
+
+  priv = group->priv;
+
+  priv->base_ms   = position * 1000;
+  priv->base_time = clutter_helix_get_time_us ();
+
+  for (l = priv->members; l; l = l->next)
+    clutter_helix_sync_group_seek_member (group, l->data, priv->base_ms);
+}
+
+/**
+ * clutter_helix_sync_group_get_position:
+ * @group: a #ClutterHelixSyncGroup
+ *
+ * Retrieves the position of the timeline of @group.
+ *
+ * Return value: the position, in seconds
+ */
+gdouble
+clutter_helix_sync_group_get_position (ClutterHelixSyncGroup *group)
+{
+  g_return_val_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group), 0);
+
+  return clutter_helix_sync_group_get_clock (group) / 1000.0;
+}
+
+/**
+ * clutter_helix_sync_group_get_skew:
+ * @group: a #ClutterHelixSyncGroup
+ *
+ * Retrieves #ClutterHelixSyncGroup:skew.
+ *
+ * Return value: the distance between the members furthest apart, in ms
+ */
+gdouble
+clutter_helix_sync_group_get_skew (ClutterHelixSyncGroup *group)
+{
+  g_return_val_if_fail (CLUTTER_HELIX_IS_SYNC_GROUP (group), 0);
+
+  return group->priv->skew;
+}
@@ -0,0 +1,113 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _HAVE_CLUTTER_HELIX_SYNC_GROUP_H
+#define _HAVE_CLUTTER_HELIX_SYNC_GROUP_H
+
+#include <glib-object.h>
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+#define CLUTTER_HELIX_TYPE_SYNC_GROUP clutter_helix_sync_group_get_type()
+
+#define CLUTTER_HELIX_SYNC_GROUP(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), \
+  CLUTTER_HELIX_TYPE_SYNC_GROUP, ClutterHelixSyncGroup))
+
+#define CLUTTER_HELIX_SYNC_GROUP_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), \
+  CLUTTER_HELIX_TYPE_SYNC_GROUP, ClutterHelixSyncGroupClass))
+
+#define CLUTTER_HELIX_IS_SYNC_GROUP(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), \
+  CLUTTER_HELIX_TYPE_SYNC_GROUP))
+
+#define CLUTTER_HELIX_IS_SYNC_GROUP_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), \
+  CLUTTER_HELIX_TYPE_SYNC_GROUP))
+
+#define CLUTTER_HELIX_SYNC_GROUP_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), \
+  CLUTTER_HELIX_TYPE_SYNC_GROUP, ClutterHelixSyncGroupClass))
+
+typedef struct _ClutterHelixSyncGroup        ClutterHelixSyncGroup;
+typedef struct _ClutterHelixSyncGroupClass   ClutterHelixSyncGroupClass;
+typedef struct _ClutterHelixSyncGroupPrivate ClutterHelixSyncGroupPrivate;
+
+/**
+ * ClutterHelixSyncGroup:
+ *
+ * Keeps several #ClutterHelixVideoTexture and #ClutterHelixAudio playing in
+ * step.
+ *
+ * The #ClutterHelixSyncGroup structure contains only private data and
+ * should not be accessed directly.
+ */
+struct _ClutterHelixSyncGroup
+{
+  /*< private >*/
+  GObject                       parent;
+  ClutterHelixSyncGroupPrivate *priv;
+};
+
+/**
+ * ClutterHelixSyncGroupClass:
+ *
+ * Base class for #ClutterHelixSyncGroup.
+ */
+struct _ClutterHelixSyncGroupClass
+{
+  /*< private >*/
+  GObjectClass parent_class;
+
+  /* Future padding */
+  void (* _clutter_reserved1) (void);
+  void (* _clutter_reserved2) (void);
+  void (* _clutter_reserved3) (void);
+  void (* _clutter_reserved4) (void);
+};
+
+GType                  clutter_helix_sync_group_get_type     (void) G_GNUC_CONST;
+ClutterHelixSyncGroup *clutter_helix_sync_group_new          (void);
+
+void                   clutter_helix_sync_group_add          (ClutterHelixSyncGroup *group,
+                                                              ClutterMedia          *media);
+void                   clutter_helix_sync_group_remove       (ClutterHelixSyncGroup *group,
+                                                              ClutterMedia          *media);
+
+void                   clutter_helix_sync_group_set_master   (ClutterHelixSyncGroup *group,
+                                                              ClutterMedia          *master);
+ClutterMedia          *clutter_helix_sync_group_get_master   (ClutterHelixSyncGroup *group);
+
+void                   clutter_helix_sync_group_set_playing  (ClutterHelixSyncGroup *group,
+                                                              gboolean               playing);
+gboolean               clutter_helix_sync_group_get_playing  (ClutterHelixSyncGroup *group);
+void                   clutter_helix_sync_group_set_position (ClutterHelixSyncGroup *group,
+                                                              gdouble                position);
+gdouble                clutter_helix_sync_group_get_position (ClutterHelixSyncGroup *group);
+
+gdouble                clutter_helix_sync_group_get_skew     (ClutterHelixSyncGroup *group);
+
+G_END_DECLS
+
+#endif
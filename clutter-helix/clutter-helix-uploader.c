@@ -0,0 +1,535 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Upload thread: frames are uploaded from a GL context of its own, sharing
+ * its textures with the context of the stage, so that the clutter thread
+ * only has to swap textures.
+ *
+ * The textures come in 3 sets: the one painted (front), the last one
+ * uploaded (ready) and the one being uploaded. A fence put after the upload
+ * is waited for by the clutter thread, on the GPU, before painting a set.
+ *
+ * GLX only. The thread has an X connection of its own, Xlib isn't thread
+ * safe unless XInitThreads() gets called first thing, which a library
+ * can't do. */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include <clutter/clutter.h>
+
+#include "clutter-helix-private.h"
+
+#ifdef HAVE_UPLOAD_THREAD
+
+#include <clutter/x11/clutter-x11.h>
+#include <GL/glx.h>
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+typedef struct __GLsync *GLsync;
+typedef guint64 GLuint64;
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_TIMEOUT_IGNORED            G_GUINT64_CONSTANT (0xffffffffffffffff)
+#endif
+
+/* GL_ARB_sync */
+typedef GLsync (* FenceSyncFunc)  (GLenum condition, GLbitfield flags);
+typedef void   (* WaitSyncFunc)   (GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void   (* DeleteSyncFunc) (GLsync sync);
+
+#define N_SETS 3
+
+typedef struct _ClutterHelixUploadSet
+{
+  GLuint              textures[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  guint               widths[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  guint               heights[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  guint               bpps[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  guint               n_planes;
+  CoglHandle          handles[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  gboolean            stale;     /* handles to make again, clutter thread */
+  GLsync              fence;
+  gconstpointer       frame;     /* what's in there, to match swaps */
+  gint64              timestamp;
+} ClutterHelixUploadSet;
+
+typedef struct _ClutterHelixUploadJob
+{
+  ClutterHelixFrame       *frame;
+  ClutterHelixUploadPlane  planes[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  guint                    n_planes;
+} ClutterHelixUploadJob;
+
+struct _ClutterHelixUploader
+{
+  GThread                *thread;
+  GMutex                 *lock;
+  GCond                  *cond;
+  gboolean                quit;
+  ClutterHelixUploadJob  *job;       /* next to upload, the newest wins */
+
+  ClutterHelixUploadSet   sets[N_SETS];
+  gint                    front;     /* indices in sets, or -1 */
+  gint                    ready;
+  gint                    writing;
+  gsize                   size;      /* of the textures of all the sets */
+
+  ClutterHelixUploadFunc  done;
+  gpointer                data;
+
+  Display                *display;   /* of the thread */
+  GLXContext              context;
+  GLXPbuffer              pbuffer;
+
+  FenceSyncFunc           fence_sync;
+  WaitSyncFunc            wait_sync;
+  DeleteSyncFunc          delete_sync;
+};
+
+static void
+clutter_helix_upload_job_free (ClutterHelixUploadJob *job)
+{
+  if (job == NULL)
+    return;
+
+  clutter_helix_frame_free (job->frame);
+  g_slice_free (ClutterHelixUploadJob, job);
+}
+
+/* In the upload thread */
+static void
+clutter_helix_upload_set_load (ClutterHelixUploader  *uploader,
+                               ClutterHelixUploadSet *set,
+                               ClutterHelixUploadJob *job)
+{
+  ClutterHelixUploadPlane *plane;
+  GLenum format;
+  guint i;
+
+  for (i = 0; i < job->n_planes; i++)
+    {
+      plane  = &job->planes[i];
+      format = plane->bpp == 4 ? GL_BGRA : GL_LUMINANCE;
+
+      if (set->textures[i] == 0)
+        glGenTextures (1, &set->textures[i]);
+      glBindTexture (GL_TEXTURE_2D, set->textures[i]);
+
+      if (set->widths[i] != plane->tex_width ||
+          set->heights[i] != plane->tex_height ||
+          set->bpps[i] != plane->bpp)
+        {
+          glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+          glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+          glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+          glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+          glTexImage2D (GL_TEXTURE_2D, 0,
+                        plane->bpp == 4 ? GL_RGBA : GL_LUMINANCE,
+                        plane->tex_width, plane->tex_height, 0,
+                        format, GL_UNSIGNED_BYTE, NULL);
+
+          set->widths[i]  = plane->tex_width;
+          set->heights[i] = plane->tex_height;
+          set->bpps[i]    = plane->bpp;
+          set->stale      = TRUE;
+        }
+
+      glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+      glPixelStorei (GL_UNPACK_ROW_LENGTH, plane->stride / plane->bpp);
+      glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, plane->width, plane->height,
+                       format, GL_UNSIGNED_BYTE,
+                       job->frame->data + plane->offset);
+    }
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+
+  if (set->n_planes != job->n_planes)
+    set->stale = TRUE;
+  set->n_planes  = job->n_planes;
+  set->frame     = job->frame;
+  set->timestamp = job->frame->timestamp;
+
+  /* without fences, the clutter thread gets the set once it's all done */
+  if (uploader->fence_sync)
+    {
+      if (set->fence)
+        uploader->delete_sync (set->fence);
+      set->fence = uploader->fence_sync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glFlush ();
+    }
+  else
+    glFinish ();
+}
+
+static gpointer
+clutter_helix_uploader_thread (gpointer data)
+{
+  ClutterHelixUploader *uploader = data;
+  ClutterHelixUploadJob *job;
+  ClutterHelixFrame *frame;
+  gsize size;
+  gint i, j, n;
+
+  glXMakeContextCurrent (uploader->display, uploader->pbuffer,
+                         uploader->pbuffer, uploader->context);
+
+  g_mutex_lock (uploader->lock);
+  for (;;)
+    {
+      while (!uploader->quit && uploader->job == NULL)
+        g_cond_wait (uploader->cond, uploader->lock);
+
+      if (uploader->quit)
+        break;
+
+      job = uploader->job;
+      uploader->job = NULL;
+
+      /* with 3 sets, there's always one neither painted nor ready */
+      for (n = 0; n == uploader->front || n == uploader->ready; n++)
+        ;
+      uploader->writing = n;
+      g_mutex_unlock (uploader->lock);
+
+      clutter_helix_upload_set_load (uploader, &uploader->sets[n], job);
+
+      /* only this thread changes the sizes of the sets */
+      size = 0;
+      for (i = 0; i < N_SETS; i++)
+        for (j = 0; j < CLUTTER_HELIX_UPLOAD_MAX_PLANES; j++)
+          size += uploader->sets[i].widths[j] * uploader->sets[i].heights[j] *
+                  uploader->sets[i].bpps[j];
+
+      g_mutex_lock (uploader->lock);
+      uploader->writing = -1;
+      uploader->ready   = n;
+      uploader->size    = size;
+      g_mutex_unlock (uploader->lock);
+
+      /* the frame goes on to the clutter thread, to be shown */
+      frame = job->frame;
+      job->frame = NULL;
+      clutter_helix_upload_job_free (job);
+      uploader->done (frame, uploader->data);
+
+      g_mutex_lock (uploader->lock);
+    }
+  g_mutex_unlock (uploader->lock);
+
+  for (i = 0; i < N_SETS; i++)
+    {
+      glDeleteTextures (CLUTTER_HELIX_UPLOAD_MAX_PLANES,
+                        uploader->sets[i].textures);
+      if (uploader->sets[i].fence)
+        uploader->delete_sync (uploader->sets[i].fence);
+    }
+
+  glXMakeContextCurrent (uploader->display, None, None, NULL);
+
+  return NULL;
+}
+
+/* Has to be called in the clutter thread, with the context of the stage
+ * current. Returns NULL if the stage context can't be shared. */
+ClutterHelixUploader *
+clutter_helix_uploader_new (ClutterHelixUploadFunc done,
+                            gpointer               data)
+{
+  ClutterHelixUploader *uploader;
+  Display *stage_display;
+  GLXContext stage_context;
+  GLXFBConfig *configs;
+  const gchar *extensions;
+  int attribs[] = { GLX_FBCONFIG_ID, 0, None };
+  int pbuffer_attribs[] = { GLX_PBUFFER_WIDTH, 1, GLX_PBUFFER_HEIGHT, 1, None };
+  int screen, n_configs;
+
+  stage_display = clutter_x11_get_default_display ();
+  stage_context = glXGetCurrentContext ();
+  if (stage_display == NULL || stage_context == NULL)
+    return NULL;
+
+  if (!glXIsDirect (stage_display, stage_context))
+    {
+      g_warning ("No upload thread with indirect rendering");
+      return NULL;
+    }
+
+  glXQueryContext (stage_display, stage_context, GLX_FBCONFIG_ID, &attribs[1]);
+  glXQueryContext (stage_display, stage_context, GLX_SCREEN, &screen);
+
+  uploader = g_slice_new0 (ClutterHelixUploader);
+  uploader->front   = -1;
+  uploader->ready   = -1;
+  uploader->writing = -1;
+  uploader->done    = done;
+  uploader->data    = data;
+
+  uploader->display = XOpenDisplay (DisplayString (stage_display));
+  if (uploader->display == NULL)
+    goto fail;
+
+  configs = glXChooseFBConfig (uploader->display, screen, attribs, &n_configs);
+  if (configs == NULL || n_configs < 1)
+    goto fail;
+
+  clutter_x11_trap_x_errors ();
+  uploader->context = glXCreateNewContext (uploader->display, configs[0],
+                                           GLX_RGBA_TYPE, stage_context, True);
+  if (uploader->context)
+    uploader->pbuffer = glXCreatePbuffer (uploader->display, configs[0],
+                                          pbuffer_attribs);
+  XSync (uploader->display, False);
+  if (clutter_x11_untrap_x_errors () || !uploader->pbuffer)
+    {
+      XFree (configs);
+      goto fail;
+    }
+  XFree (configs);
+
+  extensions = (const gchar *) glGetString (GL_EXTENSIONS);
+  if (extensions && strstr (extensions, "GL_ARB_sync"))
+    {
+      uploader->fence_sync  = (FenceSyncFunc)
+        cogl_get_proc_address ("glFenceSync");
+      uploader->wait_sync   = (WaitSyncFunc)
+        cogl_get_proc_address ("glWaitSync");
+      uploader->delete_sync = (DeleteSyncFunc)
+        cogl_get_proc_address ("glDeleteSync");
+
+      if (!uploader->fence_sync || !uploader->wait_sync ||
+          !uploader->delete_sync)
+        uploader->fence_sync = NULL;
+    }
+
+  uploader->lock = g_mutex_new ();
+  uploader->cond = g_cond_new ();
+
+  uploader->thread = g_thread_create (clutter_helix_uploader_thread,
+                                      uploader, TRUE, NULL);
+  if (uploader->thread == NULL)
+    {
+      g_mutex_free (uploader->lock);
+      g_cond_free (uploader->cond);
+      goto fail;
+    }
+
+  return uploader;
+
+fail:
+  g_warning ("Could not share the GL context of the stage, "
+             "uploading from the clutter thread");
+
+  if (uploader->pbuffer)
+    glXDestroyPbuffer (uploader->display, uploader->pbuffer);
+  if (uploader->context)
+    glXDestroyContext (uploader->display, uploader->context);
+  if (uploader->display)
+    XCloseDisplay (uploader->display);
+  g_slice_free (ClutterHelixUploader, uploader);
+
+  return NULL;
+}
+
+/* In the clutter thread. The textures handed by
+ * clutter_helix_uploader_swap() are gone. */
+void
+clutter_helix_uploader_free (ClutterHelixUploader *uploader)
+{
+  guint i, j;
+
+  if (uploader == NULL)
+    return;
+
+  g_mutex_lock (uploader->lock);
+  uploader->quit = TRUE;
+  g_cond_signal (uploader->cond);
+  g_mutex_unlock (uploader->lock);
+
+  g_thread_join (uploader->thread);
+
+  clutter_helix_upload_job_free (uploader->job);
+
+  for (i = 0; i < N_SETS; i++)
+    for (j = 0; j < CLUTTER_HELIX_UPLOAD_MAX_PLANES; j++)
+      if (uploader->sets[i].handles[j])
+        cogl_texture_unref (uploader->sets[i].handles[j]);
+
+  glXDestroyPbuffer (uploader->display, uploader->pbuffer);
+  glXDestroyContext (uploader->display, uploader->context);
+  XCloseDisplay (uploader->display);
+
+  g_mutex_free (uploader->lock);
+  g_cond_free (uploader->cond);
+  g_slice_free (ClutterHelixUploader, uploader);
+}
+
+/* From any thread, takes ownership of @frame. Returns the frame pushed
+ * before if it wasn't uploaded yet, it won't be. */
+ClutterHelixFrame *
+clutter_helix_uploader_push (ClutterHelixUploader          *uploader,
+                             ClutterHelixFrame             *frame,
+                             const ClutterHelixUploadPlane *planes,
+                             guint                          n_planes)
+{
+  ClutterHelixUploadJob *job, *old;
+
+  g_return_val_if_fail (n_planes <= CLUTTER_HELIX_UPLOAD_MAX_PLANES, frame);
+
+  job = g_slice_new (ClutterHelixUploadJob);
+  job->frame    = frame;
+  job->n_planes = n_planes;
+  memcpy (job->planes, planes, n_planes * sizeof (ClutterHelixUploadPlane));
+
+  g_mutex_lock (uploader->lock);
+  old = uploader->job;
+  uploader->job = job;
+  g_cond_signal (uploader->cond);
+  g_mutex_unlock (uploader->lock);
+
+  if (old == NULL)
+    return NULL;
+
+  frame = old->frame;
+  old->frame = NULL;
+  clutter_helix_upload_job_free (old);
+
+  return frame;
+}
+
+/* In the clutter thread. If @frame is the last one uploaded, makes its set
+ * the one painted and returns its textures in @textures, owned by the
+ * uploader. Returns FALSE otherwise. */
+gboolean
+clutter_helix_uploader_swap (ClutterHelixUploader    *uploader,
+                             const ClutterHelixFrame *frame,
+                             CoglHandle              *textures,
+                             guint                   *n_textures)
+{
+  ClutterHelixUploadSet *set;
+  guint i;
+
+  g_mutex_lock (uploader->lock);
+  if (uploader->ready < 0 ||
+      uploader->sets[uploader->ready].frame != (gconstpointer) frame ||
+      uploader->sets[uploader->ready].timestamp != frame->timestamp)
+    {
+      g_mutex_unlock (uploader->lock);
+      return FALSE;
+    }
+
+  uploader->front = uploader->ready;
+  uploader->ready = -1;
+  g_mutex_unlock (uploader->lock);
+
+  set = &uploader->sets[uploader->front];
+
+  /* the GPU waits for the upload before painting, not us */
+  if (set->fence)
+    {
+      uploader->wait_sync (set->fence, 0, GL_TIMEOUT_IGNORED);
+      uploader->delete_sync (set->fence);
+      set->fence = NULL;
+    }
+
+  if (set->stale)
+    {
+      for (i = 0; i < CLUTTER_HELIX_UPLOAD_MAX_PLANES; i++)
+        {
+          if (set->handles[i])
+            cogl_texture_unref (set->handles[i]);
+          set->handles[i] = COGL_INVALID_HANDLE;
+        }
+
+      for (i = 0; i < set->n_planes; i++)
+        set->handles[i] =
+          cogl_texture_new_from_foreign (set->textures[i], GL_TEXTURE_2D,
+                                         set->widths[i], set->heights[i],
+                                         0, 0,
+                                         set->bpps[i] == 4 ?
+                                         COGL_PIXEL_FORMAT_RGBA_8888 :
+                                         COGL_PIXEL_FORMAT_G_8);
+      set->stale = FALSE;
+    }
+
+  for (i = 0; i < set->n_planes; i++)
+    textures[i] = set->handles[i];
+  *n_textures = set->n_planes;
+
+  return TRUE;
+}
+
+/* From any thread, the texture memory held by the sets, all of them
+ * allocated once the thread is busy */
+gsize
+clutter_helix_uploader_get_size (ClutterHelixUploader *uploader)
+{
+  gsize size;
+
+  g_mutex_lock (uploader->lock);
+  size = uploader->size;
+  g_mutex_unlock (uploader->lock);
+
+  return size;
+}
+
+#else /* HAVE_UPLOAD_THREAD */
+
+ClutterHelixUploader *
+clutter_helix_uploader_new (ClutterHelixUploadFunc done,
+                            gpointer               data)
+{
+  g_warning ("Clutter-Helix was built without the upload thread");
+
+  return NULL;
+}
+
+void
+clutter_helix_uploader_free (ClutterHelixUploader *uploader)
+{
+}
+
+ClutterHelixFrame *
+clutter_helix_uploader_push (ClutterHelixUploader          *uploader,
+                             ClutterHelixFrame             *frame,
+                             const ClutterHelixUploadPlane *planes,
+                             guint                          n_planes)
+{
+  return frame;
+}
+
+gboolean
+clutter_helix_uploader_swap (ClutterHelixUploader    *uploader,
+                             const ClutterHelixFrame *frame,
+                             CoglHandle              *textures,
+                             guint                   *n_textures)
+{
+  return FALSE;
+}
+
+gsize
+clutter_helix_uploader_get_size (ClutterHelixUploader *uploader)
+{
+  return 0;
+}
+
+#endif /* HAVE_UPLOAD_THREAD */
@@ -32,6 +32,7 @@
  */
 
 #include "clutter-helix-util.h"
+#include "clutter-helix-private.h"
 
 /**
  * SECTION:clutter-helix-util
@@ -69,3 +70,235 @@ clutter_helix_init (int *argc, char ***argv)
 
   return retval;
 }
+
+/*
+ * Texture budget
+ */
+
+typedef struct _ClutterHelixBudgetEntry
+{
+  gpointer              owner;
+  ClutterHelixEvictFunc evict;
+  gsize                 bytes;
+  guint64               last_paint;
+} ClutterHelixBudgetEntry;
+
+G_LOCK_DEFINE_STATIC (budget);
+static GSList   *budget_entries = NULL;
+static gsize     budget_max = 0;
+static gsize     budget_usage = 0;
+static guint64   budget_clock = 0;
+static gboolean  budget_evicting = FALSE;
+
+static ClutterHelixBudgetEntry *
+clutter_helix_texture_budget_lookup (gpointer owner)
+{
+  GSList *l;
+
+  for (l = budget_entries; l; l = l->next)
+    if (((ClutterHelixBudgetEntry *) l->data)->owner == owner)
+      return l->data;
+
+  return NULL;
+}
+
+static gint
+compare_last_paint (gconstpointer a,
+                    gconstpointer b)
+{
+  const ClutterHelixBudgetEntry *ea = a, *eb = b;
+
+  return ea->last_paint < eb->last_paint ? -1 :
+         ea->last_paint > eb->last_paint ? 1 : 0;
+}
+
+/* Asks the least recently painted owners to give memory back until the
+ * budget is met, or until none of them can. */
+static void
+clutter_helix_texture_budget_enforce (void)
+{
+  GSList *candidates = NULL, *l;
+  gpointer owner = NULL;
+  ClutterHelixEvictFunc evict = NULL;
+
+  G_LOCK (budget);
+  if (budget_evicting || budget_max == 0 || budget_usage <= budget_max)
+    {
+      G_UNLOCK (budget);
+      return;
+    }
+  budget_evicting = TRUE;
+  for (l = budget_entries; l; l = l->next)
+    candidates = g_slist_prepend (candidates, l->data);
+  candidates = g_slist_sort (candidates, compare_last_paint);
+  G_UNLOCK (budget);
+
+  for (l = candidates; l; l = l->next)
+    {
+      ClutterHelixBudgetEntry *entry = l->data;
+      gboolean over, alive;
+
+      /* an owner may give memory back several times, halving its textures
+       * each time */
+      do
+        {
+          G_LOCK (budget);
+          over  = budget_usage > budget_max;
+          /* a previous evict function may have removed this owner */
+          alive = g_slist_find (budget_entries, entry) != NULL;
+          if (alive)
+            {
+              owner = entry->owner;
+              evict = entry->evict;
+            }
+          G_UNLOCK (budget);
+        }
+      while (over && alive && evict (owner));
+
+      if (!over)
+        break;
+    }
+
+  g_slist_free (candidates);
+
+  G_LOCK (budget);
+  budget_evicting = FALSE;
+  G_UNLOCK (budget);
+}
+
+void
+clutter_helix_texture_budget_add (gpointer              owner,
+                                  ClutterHelixEvictFunc evict)
+{
+  ClutterHelixBudgetEntry *entry;
+
+  entry = g_slice_new0 (ClutterHelixBudgetEntry);
+  entry->owner      = owner;
+  entry->evict      = evict;
+
+  G_LOCK (budget);
+  entry->last_paint = ++budget_clock;
+  budget_entries = g_slist_prepend (budget_entries, entry);
+  G_UNLOCK (budget);
+}
+
+void
+clutter_helix_texture_budget_remove (gpointer owner)
+{
+  ClutterHelixBudgetEntry *entry;
+
+  G_LOCK (budget);
+  entry = clutter_helix_texture_budget_lookup (owner);
+  if (entry)
+    {
+      budget_usage -= entry->bytes;
+      budget_entries = g_slist_remove (budget_entries, entry);
+      g_slice_free (ClutterHelixBudgetEntry, entry);
+    }
+  G_UNLOCK (budget);
+}
+
+/* Records that @owner now has @bytes of textures, evicting others if that
+ * goes over the budget. */
+void
+clutter_helix_texture_budget_update (gpointer owner,
+                                     gsize    bytes)
+{
+  ClutterHelixBudgetEntry *entry;
+
+  G_LOCK (budget);
+  entry = clutter_helix_texture_budget_lookup (owner);
+  if (entry)
+    {
+      budget_usage -= entry->bytes;
+      budget_usage += bytes;
+      entry->bytes  = bytes;
+    }
+  G_UNLOCK (budget);
+
+  clutter_helix_texture_budget_enforce ();
+}
+
+void
+clutter_helix_texture_budget_touch (gpointer owner)
+{
+  ClutterHelixBudgetEntry *entry;
+
+  G_LOCK (budget);
+  entry = clutter_helix_texture_budget_lookup (owner);
+  if (entry)
+    entry->last_paint = ++budget_clock;
+  G_UNLOCK (budget);
+}
+
+/* Whether @extra_bytes more would still be within the budget */
+gboolean
+clutter_helix_texture_budget_fits (gsize extra_bytes)
+{
+  gboolean fits;
+
+  G_LOCK (budget);
+  fits = budget_max == 0 || budget_usage + extra_bytes <= budget_max;
+  G_UNLOCK (budget);
+
+  return fits;
+}
+
+/**
+ * clutter_helix_set_texture_budget:
+ * @bytes: the maximum amount of texture memory, in bytes, or 0 for no limit
+ *
+ * Sets the amount of texture memory all the #ClutterHelixVideoTexture of the
+ * process may use together. When over budget, the textures of the least
+ * recently painted video textures are released if they are not mapped, and
+ * downscaled otherwise.
+ */
+void
+clutter_helix_set_texture_budget (gsize bytes)
+{
+  G_LOCK (budget);
+  budget_max = bytes;
+  G_UNLOCK (budget);
+
+  clutter_helix_texture_budget_enforce ();
+}
+
+/**
+ * clutter_helix_get_texture_budget:
+ *
+ * Retrieves the budget set with clutter_helix_set_texture_budget().
+ *
+ * Return value: the texture budget, in bytes, 0 if there is none
+ */
+gsize
+clutter_helix_get_texture_budget (void)
+{
+  gsize bytes;
+
+  G_LOCK (budget);
+  bytes = budget_max;
+  G_UNLOCK (budget);
+
+  return bytes;
+}
+
+/**
+ * clutter_helix_get_texture_usage:
+ *
+ * Retrieves the amount of texture memory used by all the
+ * #ClutterHelixVideoTexture of the process. See also
+ * #ClutterHelixVideoTexture:texture-bytes.
+ *
+ * Return value: the texture memory in use, in bytes
+ */
+gsize
+clutter_helix_get_texture_usage (void)
+{
+  gsize bytes;
+
+  G_LOCK (budget);
+  bytes = budget_usage;
+  G_UNLOCK (budget);
+
+  return bytes;
+}
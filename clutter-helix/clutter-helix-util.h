@@ -40,6 +40,10 @@ G_BEGIN_DECLS
 
 ClutterInitError clutter_helix_init (int *argc, char ***argv);
 
+void             clutter_helix_set_texture_budget (gsize bytes);
+gsize            clutter_helix_get_texture_budget (void);
+gsize            clutter_helix_get_texture_usage  (void);
+
 G_END_DECLS
 
 #endif
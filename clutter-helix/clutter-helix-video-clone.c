@@ -0,0 +1,318 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:clutter-helix-video-clone
+ * @short_description: Actor showing the video of a video texture
+ *
+ * #ClutterHelixVideoClone paints the video of a #ClutterHelixVideoTexture
+ * with the textures and the shader the source already uses. The stream is
+ * decoded and uploaded once however many clones show it, which makes it
+ * suitable for picture-in-picture, reflections or multi-view layouts.
+ *
+ * The clone follows the renderer and the resolution of its source.
+ */
+
+#include "config.h"
+
+#include "clutter-helix-video-clone.h"
+#include "clutter-helix-private.h"
+
+#include <glib.h>
+
+struct _ClutterHelixVideoClonePrivate
+{
+  ClutterHelixVideoTexture *source;
+  gulong                    size_change_id;
+  gulong                    pixbuf_change_id;
+  gulong                    destroy_id;
+};
+
+enum {
+  PROP_0,
+  PROP_SOURCE
+};
+
+G_DEFINE_TYPE (ClutterHelixVideoClone,
+               clutter_helix_video_clone,
+               CLUTTER_TYPE_ACTOR);
+
+static void
+on_source_size_change (ClutterTexture         *texture,
+                       gint                    width,
+                       gint                    height,
+                       ClutterHelixVideoClone *clone)
+{
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (clone));
+}
+
+static void
+on_source_pixbuf_change (ClutterTexture         *texture,
+                         ClutterHelixVideoClone *clone)
+{
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (clone));
+}
+
+static void
+on_source_destroy (ClutterActor           *source,
+                   ClutterHelixVideoClone *clone)
+{
+  clutter_helix_video_clone_set_source (clone, NULL);
+}
+
+static void
+clutter_helix_video_clone_paint (ClutterActor *actor)
+{
+  ClutterHelixVideoClone *clone = CLUTTER_HELIX_VIDEO_CLONE (actor);
+  ClutterHelixVideoClonePrivate *priv = clone->priv;
+  ClutterActorBox box;
+
+  if (priv->source == NULL)
+    return;
+
+  clutter_helix_video_texture_painted (priv->source, actor);
+
+  /* the source may have stopped uploading while only we are visible */
+  clutter_helix_video_texture_queue_flush_hidden (priv->source);
+
+  clutter_actor_get_allocation_box (actor, &box);
+
+  clutter_helix_video_texture_paint_frame (priv->source,
+                                           0, 0,
+                                           box.x2 - box.x1,
+                                           box.y2 - box.y1,
+                                           clutter_actor_get_paint_opacity (actor));
+}
+
+static void
+clutter_helix_video_clone_get_preferred_width (ClutterActor *actor,
+                                               gfloat        for_height,
+                                               gfloat       *min_width_p,
+                                               gfloat       *natural_width_p)
+{
+  ClutterHelixVideoClonePrivate *priv = CLUTTER_HELIX_VIDEO_CLONE (actor)->priv;
+
+  if (priv->source == NULL)
+    {
+      if (min_width_p)
+        *min_width_p = 0;
+      if (natural_width_p)
+        *natural_width_p = 0;
+      return;
+    }
+
+  clutter_actor_get_preferred_width (CLUTTER_ACTOR (priv->source),
+                                     for_height,
+                                     min_width_p,
+                                     natural_width_p);
+}
+
+static void
+clutter_helix_video_clone_get_preferred_height (ClutterActor *actor,
+                                                gfloat        for_width,
+                                                gfloat       *min_height_p,
+                                                gfloat       *natural_height_p)
+{
+  ClutterHelixVideoClonePrivate *priv = CLUTTER_HELIX_VIDEO_CLONE (actor)->priv;
+
+  if (priv->source == NULL)
+    {
+      if (min_height_p)
+        *min_height_p = 0;
+      if (natural_height_p)
+        *natural_height_p = 0;
+      return;
+    }
+
+  clutter_actor_get_preferred_height (CLUTTER_ACTOR (priv->source),
+                                      for_width,
+                                      min_height_p,
+                                      natural_height_p);
+}
+
+static void
+clutter_helix_video_clone_set_property (GObject      *object,
+                                        guint         property_id,
+                                        const GValue *value,
+                                        GParamSpec   *pspec)
+{
+  ClutterHelixVideoClone *clone = CLUTTER_HELIX_VIDEO_CLONE (object);
+
+  switch (property_id)
+    {
+    case PROP_SOURCE:
+      clutter_helix_video_clone_set_source (clone, g_value_get_object (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+clutter_helix_video_clone_get_property (GObject    *object,
+                                        guint       property_id,
+                                        GValue     *value,
+                                        GParamSpec *pspec)
+{
+  ClutterHelixVideoClone *clone = CLUTTER_HELIX_VIDEO_CLONE (object);
+
+  switch (property_id)
+    {
+    case PROP_SOURCE:
+      g_value_set_object (value, clone->priv->source);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+clutter_helix_video_clone_dispose (GObject *object)
+{
+  clutter_helix_video_clone_set_source (CLUTTER_HELIX_VIDEO_CLONE (object),
+                                        NULL);
+
+  G_OBJECT_CLASS (clutter_helix_video_clone_parent_class)->dispose (object);
+}
+
+static void
+clutter_helix_video_clone_class_init (ClutterHelixVideoCloneClass *klass)
+{
+  GObjectClass      *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class  = CLUTTER_ACTOR_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (ClutterHelixVideoClonePrivate));
+
+  object_class->dispose      = clutter_helix_video_clone_dispose;
+  object_class->set_property = clutter_helix_video_clone_set_property;
+  object_class->get_property = clutter_helix_video_clone_get_property;
+
+  actor_class->paint                = clutter_helix_video_clone_paint;
+  actor_class->get_preferred_width  = clutter_helix_video_clone_get_preferred_width;
+  actor_class->get_preferred_height = clutter_helix_video_clone_get_preferred_height;
+
+  /**
+   * ClutterHelixVideoClone:source:
+   *
+   * The #ClutterHelixVideoTexture whose video is shown.
+   */
+  g_object_class_install_property
+    (object_class, PROP_SOURCE,
+     g_param_spec_object ("source",
+                          "Source",
+                          "The video texture to clone",
+                          CLUTTER_HELIX_TYPE_VIDEO_TEXTURE,
+                          G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+}
+
+static void
+clutter_helix_video_clone_init (ClutterHelixVideoClone *clone)
+{
+  clone->priv = G_TYPE_INSTANCE_GET_PRIVATE (clone,
+                                             CLUTTER_HELIX_TYPE_VIDEO_CLONE,
+                                             ClutterHelixVideoClonePrivate);
+}
+
+/**
+ * clutter_helix_video_clone_new:
+ * @source: a #ClutterHelixVideoTexture, or %NULL
+ *
+ * Creates an actor showing the video of @source.
+ *
+ * Return value: the newly created #ClutterHelixVideoClone actor
+ */
+ClutterActor *
+clutter_helix_video_clone_new (ClutterHelixVideoTexture *source)
+{
+  return g_object_new (CLUTTER_HELIX_TYPE_VIDEO_CLONE,
+                       "source", source,
+                       NULL);
+}
+
+/**
+ * clutter_helix_video_clone_set_source:
+ * @clone: a #ClutterHelixVideoClone
+ * @source: a #ClutterHelixVideoTexture, or %NULL
+ *
+ * Sets the video texture whose video @clone shows.
+ */
+void
+clutter_helix_video_clone_set_source (ClutterHelixVideoClone   *clone,
+                                      ClutterHelixVideoTexture *source)
+{
+  ClutterHelixVideoClonePrivate *priv;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_CLONE (clone));
+  g_return_if_fail (source == NULL || CLUTTER_HELIX_IS_VIDEO_TEXTURE (source));
+
+  priv = clone->priv;
+
+  if (priv->source == source)
+    return;
+
+  if (priv->source)
+    {
+      g_signal_handler_disconnect (priv->source, priv->size_change_id);
+      g_signal_handler_disconnect (priv->source, priv->pixbuf_change_id);
+      g_signal_handler_disconnect (priv->source, priv->destroy_id);
+      clutter_helix_video_texture_remove_clone (priv->source,
+                                                CLUTTER_ACTOR (clone));
+      g_object_unref (priv->source);
+      priv->source = NULL;
+    }
+
+  if (source)
+    {
+      priv->source = g_object_ref (source);
+      clutter_helix_video_texture_add_clone (source, CLUTTER_ACTOR (clone));
+
+      priv->size_change_id =
+        g_signal_connect (source, "size-change",
+                          G_CALLBACK (on_source_size_change), clone);
+      priv->pixbuf_change_id =
+        g_signal_connect (source, "pixbuf-change",
+                          G_CALLBACK (on_source_pixbuf_change), clone);
+      priv->destroy_id =
+        g_signal_connect (source, "destroy",
+                          G_CALLBACK (on_source_destroy), clone);
+    }
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (clone));
+  g_object_notify (G_OBJECT (clone), "source");
+}
+
+/**
+ * clutter_helix_video_clone_get_source:
+ * @clone: a #ClutterHelixVideoClone
+ *
+ * Retrieves the video texture shown by @clone.
+ *
+ * Return value: the source #ClutterHelixVideoTexture, or %NULL
+ */
+ClutterHelixVideoTexture *
+clutter_helix_video_clone_get_source (ClutterHelixVideoClone *clone)
+{
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_CLONE (clone), NULL);
+
+  return clone->priv->source;
+}
@@ -0,0 +1,101 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _HAVE_CLUTTER_HELIX_VIDEO_CLONE_H
+#define _HAVE_CLUTTER_HELIX_VIDEO_CLONE_H
+
+#include <glib-object.h>
+#include <clutter/clutter.h>
+
+#include "clutter-helix-video-texture.h"
+
+G_BEGIN_DECLS
+#define CLUTTER_HELIX_TYPE_VIDEO_CLONE clutter_helix_video_clone_get_type()
+
+#define CLUTTER_HELIX_VIDEO_CLONE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), \
+  CLUTTER_HELIX_TYPE_VIDEO_CLONE, ClutterHelixVideoClone))
+
+#define CLUTTER_HELIX_VIDEO_CLONE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), \
+  CLUTTER_HELIX_TYPE_VIDEO_CLONE, ClutterHelixVideoCloneClass))
+
+#define CLUTTER_HELIX_IS_VIDEO_CLONE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), \
+  CLUTTER_HELIX_TYPE_VIDEO_CLONE))
+
+#define CLUTTER_HELIX_IS_VIDEO_CLONE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), \
+  CLUTTER_HELIX_TYPE_VIDEO_CLONE))
+
+#define CLUTTER_HELIX_VIDEO_CLONE_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), \
+  CLUTTER_HELIX_TYPE_VIDEO_CLONE, ClutterHelixVideoCloneClass))
+
+typedef struct _ClutterHelixVideoClone        ClutterHelixVideoClone;
+typedef struct _ClutterHelixVideoCloneClass   ClutterHelixVideoCloneClass;
+typedef struct _ClutterHelixVideoClonePrivate ClutterHelixVideoClonePrivate;
+
+/**
+ * ClutterHelixVideoClone:
+ *
+ * An actor showing the video of a #ClutterHelixVideoTexture without decoding
+ * or uploading it a second time.
+ *
+ * The #ClutterHelixVideoClone structure contains only private data and
+ * should not be accessed directly.
+ */
+struct _ClutterHelixVideoClone
+{
+  /*< private >*/
+  ClutterActor                   parent;
+  ClutterHelixVideoClonePrivate *priv;
+};
+
+/**
+ * ClutterHelixVideoCloneClass:
+ *
+ * Base class for #ClutterHelixVideoClone.
+ */
+struct _ClutterHelixVideoCloneClass
+{
+  /*< private >*/
+  ClutterActorClass parent_class;
+
+  /* Future padding */
+  void (* _clutter_reserved1) (void);
+  void (* _clutter_reserved2) (void);
+  void (* _clutter_reserved3) (void);
+  void (* _clutter_reserved4) (void);
+};
+
+GType                     clutter_helix_video_clone_get_type   (void) G_GNUC_CONST;
+ClutterActor             *clutter_helix_video_clone_new        (ClutterHelixVideoTexture *source);
+
+void                      clutter_helix_video_clone_set_source (ClutterHelixVideoClone   *clone,
+                                                                ClutterHelixVideoTexture *source);
+ClutterHelixVideoTexture *clutter_helix_video_clone_get_source (ClutterHelixVideoClone   *clone);
+
+G_END_DECLS
+
+#endif
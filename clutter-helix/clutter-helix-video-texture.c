@@ -45,6 +45,11 @@
  * @short_description: Actor for playback of video files.
  *
  * #ClutterHelixVideoTexture is a #ClutterTexture that plays video files.
+ *
+ * The frames are converted to RGB on the GPU by the best renderer the GL
+ * offers. The CLUTTER_HELIX_RENDERER environment variable, a comma
+ * separated list of renderer names such as "I420 core,RGB 32", restricts
+ * the choice to those, to compare them.
  */
 
 #include "config.h"
@@ -54,6 +59,7 @@
 
 #include "clutter-helix-video-texture.h"
 #include "clutter-helix-shaders.h"
+#include "clutter-helix-private.h"
 #include "player.h"
 
 
@@ -68,16 +74,93 @@ enum
   PROP_AUDIO_VOLUME,
   PROP_CAN_SEEK,
   PROP_BUFFER_FILL,
-  PROP_DURATION
+  PROP_DURATION,
+
+  PROP_NEXT_URI,
+  PROP_LOOP,
+  PROP_LOOP_CACHE_FRAMES,
+  PROP_LOOP_CACHE_SIZE,
+  PROP_STEP_CACHE_SIZE,
+  PROP_DROP_HIDDEN_FRAMES,
+  PROP_SKIPPED_UPLOADS,
+  PROP_TEXTURE_BYTES,
+  PROP_AUTO_DOWNSCALE,
+  PROP_USE_ATLAS,
+  PROP_RATE,
+  PROP_MUTE_TRICK_PLAY,
+  PROP_VIDEO_FORMAT,
+  PROP_PREFERRED_VIDEO_FORMAT,
+  PROP_DIRTY_TILES,
+  PROP_BYTES_SAVED,
+  PROP_UPLOAD_THREAD,
+  PROP_RGBA_CACHE,
+  PROP_COLOR_MATRIX,
+  PROP_FULL_RANGE,
+  PROP_BRIGHTNESS,
+  PROP_CONTRAST,
+  PROP_SATURATION,
+  PROP_DEINTERLACE,
+  PROP_FIELD_ORDER
 };
 
+#define DEFAULT_LOOP_CACHE_FRAMES 50
+#define DEFAULT_LOOP_CACHE_SIZE   (32 * 1024 * 1024)
+#define DEFAULT_FRAME_INTERVAL    40 /* ms */
+#define DEFAULT_STEP_CACHE_SIZE   (16 * 1024 * 1024)
+#define STEP_SPAN_FRAMES          12 /* frames decoded around a step target */
+#define MAX_BUDGET_SHIFT          3  /* downscale by 8 at most to meet budget */
+#define MAX_DISPLAY_SHIFT         4  /* downscale by 16 at most for small actors */
+#define DISPLAY_SHRINK_DELAY      15 /* uploads before shrinking the textures */
+#define MIN_RATE                  0.25
+#define MAX_RATE                  16.0
+#define TRICK_SEEK_INTERVAL       100  /* ms between two seeks at high rates */
+#define TRICK_SEEK_TIMEOUT        1000 /* ms before giving up on a seek */
+#define MAX_PLANES                4    /* Y, U, V and alpha */
+
 typedef enum _ClutterHelixVideoFormat
 {
   CLUTTER_HELIX_NOFORMAT,
   CLUTTER_HELIX_RGB32,
   CLUTTER_HELIX_I420,
+  CLUTTER_HELIX_NV12,
+  CLUTTER_HELIX_YUY2,
+  CLUTTER_HELIX_UYVY,
+  CLUTTER_HELIX_I420_10,
+  CLUTTER_HELIX_YUVA,
 } ClutterHelixVideoFormat;
 
+/*
+ * formats: what Helix can hand us, cheapest to move around first.
+ */
+typedef struct _ClutterHelixFormatInfo
+{
+  gint                     cid;
+  ClutterHelixVideoFormat  format;
+  guint                    bits;     /* per pixel, as decoded */
+  const char              *name;
+} ClutterHelixFormatInfo;
+
+static const ClutterHelixFormatInfo formats[] =
+{
+  { CID_I420,   CLUTTER_HELIX_I420,  12, "I420"  },
+#ifdef CID_NV12
+  { CID_NV12,   CLUTTER_HELIX_NV12,  12, "NV12"  },
+#endif
+#ifdef CID_YUY2
+  { CID_YUY2,   CLUTTER_HELIX_YUY2,  16, "YUY2"  },
+#endif
+#ifdef CID_UYVY
+  { CID_UYVY,   CLUTTER_HELIX_UYVY,  16, "UYVY"  },
+#endif
+#ifdef CID_YUVA
+  { CID_YUVA,   CLUTTER_HELIX_YUVA,  20, "YUVA"  },
+#endif
+#ifdef CID_I420_10
+  { CID_I420_10, CLUTTER_HELIX_I420_10, 24, "I420-10" },
+#endif
+  { CID_ARGB32, CLUTTER_HELIX_RGB32, 32, "RGB32" },
+};
+
 /* GL_ARB_fragment_program */
 typedef void (APIENTRYP GLGENPROGRAMSPROC)(GLsizei n, GLuint *programs);
 typedef void (APIENTRYP GLBINDPROGRAMPROC)(GLenum target, GLint program);
@@ -92,16 +175,6 @@ typedef struct _ClutterHelixSymbols
   GLPROGRAMSTRINGPROC glProgramStringARB;
 } ClutterHelixSymbols;
 
-/*
- * features: what does the underlaying video card supports ?
- */
-typedef enum _ClutterHelixFeatures
-{
-  CLUTTER_HELIX_FP             = 0x1, /* fragment programs (ARB fp1.0) */
-  CLUTTER_HELIX_GLSL           = 0x2, /* GLSL */
-  CLUTTER_HELIX_MULTI_TEXTURE  = 0x4, /* multi-texturing */
-} ClutterHelixFeatures;
-
  
 /*
  * renderer: abstracts a backend to render a frame.
@@ -119,8 +192,36 @@ typedef struct _ClutterHelixRenderer
   void (*deinit)     (ClutterHelixVideoTexture *video_texture);
   void (*upload)     (ClutterHelixVideoTexture *video_texture,
                       guchar                   *buffer);
+  /* paints the frame itself, NULL to paint the material of the actor */
+  void (*paint)      (ClutterHelixVideoTexture *video_texture,
+                      gfloat                    x_1,
+                      gfloat                    y_1,
+                      gfloat                    x_2,
+                      gfloat                    y_2,
+                      guint8                    opacity);
 } ClutterHelixRenderer;
 
+/*
+ * color matrices: how the YUV renderers go to RGB, see
+ * clutter_helix_video_texture_update_colors() and ClutterHelixColorMatrix
+ */
+#define HD_HEIGHT 720 /* streams this high or more are BT.709 in auto */
+
+/* shader variants of the YUV renderers, by cost */
+enum
+{
+  COLOR_VARIANT_FIXED,  /* BT.601 limited range as constants */
+  COLOR_VARIANT_MATRIX, /* color_matrix and color_offset uniforms */
+  N_COLOR_VARIANTS
+};
+
+/*
+ * deinterlacing, done by the shader of the planar YUV renderers, see
+ * ClutterHelixDeinterlace. The field order comes with each frame, see
+ * ClutterHelixFrameFlags.
+ */
+#define N_DEINTERLACE_MODES (CLUTTER_HELIX_DEINTERLACE_BLEND + 1)
+
 typedef enum _ClutterHelixRendererState
 {
   CLUTTER_HELIX_RENDERER_STOPPED,
@@ -128,10 +229,72 @@ typedef enum _ClutterHelixRendererState
   CLUTTER_HELIX_RENDERER_NEED_GC,
 } ClutterHelixRendererState;
 
+/*
+ * tile: part of an I420 frame too large for single textures, see
+ * clutter_helix_video_texture_make_tiles(). Sizes are in luma pixels.
+ */
+#define TILE_BORDER 2 /* shared with the neighbours, for filtering */
+
+typedef struct _ClutterHelixTile
+{
+  guint      x, y;                  /* part painted */
+  guint      width, height;
+  guint      tex_x, tex_y;          /* part held by the textures */
+  guint      tex_width, tex_height;
+  CoglHandle planes[3];             /* by layer, see clutter_helix_yv12_upload() */
+} ClutterHelixTile;
+
+/*
+ * dirty map: hashes of the blocks of a plane as last uploaded, to upload
+ * only the blocks that changed, see clutter_helix_upload_dirty_blocks()
+ */
+#define DIRTY_BLOCK 64 /* texels */
+
+typedef struct _ClutterHelixDirtyMap
+{
+  guint     columns;
+  guint     rows;
+  guint64  *hashes;
+  gsize     saved;    /* bytes not uploaded, since the last frame */
+  gboolean  changed;  /* some block was uploaded */
+} ClutterHelixDirtyMap;
+
 struct _ClutterHelixVideoTexturePrivate
 {
   void                      *player;
   char                      *uri;
+  ClutterHelixPlayerSlot     slots[2];
+  ClutterHelixPlayerSlot    *active;        /* slot playing priv->uri */
+  ClutterHelixPlayerSlot    *preroll;       /* slot opening priv->next_uri */
+  char                      *next_uri;
+  ClutterHelixFrame         *next_frame;    /* first frame of next_uri */
+  guint                      preroll_id;
+  guint                      eos_id;
+  gboolean                   loop;
+  guint                      loop_cache_frames;
+  guint                      loop_cache_size;
+  GQueue                    *head_frames;   /* first frames of the stream */
+  guint                      head_bytes;
+  gboolean                   head_complete; /* no more frames to cache */
+  GList                     *replay;        /* next head frame to show */
+  guint                      replay_id;
+  guint                      loop_shown;    /* since the rewind, from memory */
+  guint                      loop_decoded;  /* since the rewind */
+  gint64                     pos_ms;        /* last position from Helix */
+  gint64                     pos_time;      /* when it was reported */
+  gint64                     last_timestamp;
+  gint                       frame_interval;
+  gint64                     shown_timestamp;
+  ClutterHelixFrame         *last_frame;    /* the last one uploaded */
+  ClutterHelixFrameCache    *step_cache;    /* recently decoded frames */
+  guint                      step_cache_size;
+  gboolean                   step_cache_used;
+  gint64                     step_target;
+  gint64                     step_end;      /* -1 unless decoding for a step */
+  gboolean                   step_reached;
+  gboolean                   step_shown;
+  gboolean                   stepped;
+  guint                      step_id;
   gboolean                   can_seek;
   int                        buffer_percent;
   int                        duration;
@@ -141,1029 +304,5714 @@ struct _ClutterHelixVideoTexturePrivate
   unsigned int               y;
   unsigned int               width;
   unsigned int               height;
+  guint                      strides[MAX_PLANES]; /* layout of the frame uploaded */
+  guint                      offsets[MAX_PLANES];
   gint                       cid;
   gboolean                   shaders_init;
+  CoglHandle                 y_tex;         /* also the texture of the actor */
   CoglHandle                 u_tex;
   CoglHandle                 v_tex;
+  CoglHandle                 a_tex;         /* straight alpha, YUVA only */
   CoglHandle                 program;
   CoglHandle                 shader;
+  int                        chroma_width_location;
+  int                        width_location;
+  GHashTable                *programs;      /* linked, by shader source */
+  GHashTable                *core_programs; /* the same for core renderers */
+  ClutterHelixCoreProgram   *core_program;  /* in use, in core_programs */
+  gint                       color_variant; /* of program, -1 if not YUV */
+  int                        color_matrix_location;
+  int                        color_offset_location;
+  gint                       program_deinterlace; /* -1 if it can't */
+  int                        luma_height_location;
+  int                        field_location;
+  ClutterHelixDeinterlace    deinterlace;
+  gboolean                   bottom_first;  /* for the frames decoded */
+  guint                      frame_flags;   /* of the frame uploaded */
+  gboolean                   second_field;  /* shown, in bob mode */
+  guint                      field_id;
+  ClutterHelixColorMatrix    color_matrix;
+  gboolean                   full_range;
+  gdouble                    brightness;
+  gdouble                    contrast;
+  gdouble                    saturation;
+  gfloat                     color_values[12]; /* matrix, column major, */
+                                               /* then offset */
+  GLuint                     gl_textures[3]; /* not managed by cogl */
   gboolean                   use_shaders;
   ClutterHelixSymbols        syms;          /* extra OpenGL functions */
   GLuint                     fp;
   GSList                    *renderers;
+  gint                       atlas_features; /* 0 if the atlas is unwanted */
   ClutterHelixRendererState  renderer_state;
   ClutterHelixRenderer      *renderer;
   guint                      idle_id;
   GMutex                    *id_lock;
-  guchar                    *buffer;
+  ClutterHelixFrame         *frame;
+  gulong                     paint_id;
+  gulong                     post_paint_id;
+  ClutterHelixRendererPaint     *paint_func;
+  ClutterHelixRendererPostPaint *post_paint_func;
+  GSList                    *clones;
+  gboolean                   hidden;        /* nothing showed the last frame */
+  gboolean                   drop_hidden;
+  ClutterHelixFrame         *hidden_frame;  /* newest frame not uploaded */
+  guint                      flush_id;
+  guint                      skipped_uploads;
+  unsigned int               stream_width;  /* before any downscaling */
+  unsigned int               stream_height;
+  guint                      cap_width;     /* size the textures can hold, */
+  guint                      cap_height;    /* the frame is at their corner */
+  gfloat                     tex_s;         /* texture coordinates of the */
+  gfloat                     tex_t;         /* bottom right of the frame */
+  gboolean                   size_changed;  /* lets size-change through */
+  GLint                      max_texture_size;
+  gboolean                   too_large;     /* warned about an untiled frame */
+  ClutterHelixTile          *tiles;         /* replace y/u/v_tex if not NULL */
+  guint                      n_tiles;
+  gboolean                   dirty_tiles;
+  ClutterHelixDirtyMap       dirty_maps[MAX_PLANES]; /* by plane */
+  guint64                    bytes_saved;
+  gboolean                   upload_thread;
+  ClutterHelixUploader      *uploader;
+  gboolean                   uploader_failed;
+  gboolean                   uploader_ok;     /* frames can go to it */
+  gboolean                   uploaded_planes; /* y/u/v_tex are its own */
+  gboolean                   rgba_cache;
+  gboolean                   rgba_failed;   /* no FBO, shaders every paint */
+  gboolean                   rgba_dirty;    /* a new frame to convert */
+  CoglHandle                 rgba_tex;      /* the frame converted, as is */
+  CoglHandle                 rgba_fbo;
+  CoglHandle                 rgba_material;
+  guint                      budget_shift;  /* halvings to meet the budget */
+  gsize                      texture_bytes;
+  gboolean                   auto_downscale;
+  gfloat                     painted_width;  /* largest on screen size since */
+  gfloat                     painted_height; /* the last upload */
+  guint                      display_shift;  /* halvings for the painted size */
+  guint                      shrink_count;
+  guint                      regrow_id;
+  gboolean                   use_atlas;
+  ClutterHelixAtlasSlot     *atlas_slot;
+  ClutterHelixSyncGroup     *sync_group;
+  guint                      hold_id;
+  gdouble                    rate;
+  gboolean                   mute_trick_play;
+  gint                       trick_volume;  /* -1 unless muted for a rate */
+  guint                      trick_id;
+  gboolean                   trick_fast;    /* seeking from frame to frame */
+  gboolean                   trick_pending; /* waiting for the seek's frame */
+  gint64                     trick_pos;     /* ms, where the rate got us */
+  gint64                     trick_time;
+  gint64                     trick_seek_time;
+  guint                      trick_pause_id;
+  const ClutterHelixFormatInfo *format_info;    /* of the frames decoded */
+  const ClutterHelixFormatInfo *preferred_info; /* see negotiate_format() */
 };
 
 
+static void
+_renderer_disconnect_signals (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (priv->paint_id)
+    g_signal_handler_disconnect (video_texture, priv->paint_id);
+  if (priv->post_paint_id)
+    g_signal_handler_disconnect (video_texture, priv->post_paint_id);
+  priv->paint_id = priv->post_paint_id = 0;
+
+  priv->paint_func      = NULL;
+  priv->post_paint_func = NULL;
+}
+
 static void
 _renderer_connect_signals (ClutterHelixVideoTexture     *video_texture,
                            ClutterHelixRendererPaint     paint_func,
                            ClutterHelixRendererPostPaint post_paint_func)
 {
-  gulong handler_id;
   ClutterHelixVideoTexturePrivate *priv; 
 
   g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
 
   priv = video_texture->priv;
 
-  handler_id =
+  /* renderers get initialized again after a pause */
+  _renderer_disconnect_signals (video_texture);
+
+  priv->paint_id =
     g_signal_connect (video_texture, "paint", G_CALLBACK (paint_func), NULL);
 
-  handler_id = g_signal_connect_after (video_texture,
+  priv->post_paint_id = g_signal_connect_after (video_texture,
       "paint",
       G_CALLBACK (post_paint_func),
       NULL);
-}
 
-static gchar *dummy_shader = \
-     FRAGMENT_SHADER_VARS
-     "void main () {"
-     "}";
+  /* kept to paint clones, see clutter_helix_video_texture_paint_frame() */
+  priv->paint_func      = paint_func;
+  priv->post_paint_func = post_paint_func;
+}
 
-static gchar *yv12_to_rgba_shader = \
-     FRAGMENT_SHADER_VARS
-	   "uniform sampler2D ytex;"
-	   "uniform sampler2D utex;"
-	   "uniform sampler2D vtex;"
-	   "void main () {"
-	   "  vec2 coord = vec2(" TEX_COORD ");"
-	   "  float y = 1.1640625 * (texture2D (ytex, coord).g - 0.0625);"
-	   "  float u = texture2D (utex, coord).g - 0.5;"
-	   "  float v = texture2D (vtex, coord).g - 0.5;"
-	   "  vec4 color;"
-	   "  color.r = y + 1.59765625 * v;"
-	   "  color.g = y - 0.390625 * u - 0.8125 * v;"
-	   "  color.b = y + 2.015625 * u;"
-	   "  color.a = 1.0;"
-	   "  gl_FragColor = color;"
-	   FRAGMENT_SHADER_END
-	   "}";
+/*
+ * Colors
+ *
+ * The YUV renderers have a shader with the BT.601 limited range conversion
+ * as constants, the common case and as cheap as it gets, and one taking a
+ * matrix and offset, for anything else.
+ */
 
-/* some renderers don't need all the ClutterHelixRenderer vtable */
-static void
-clutter_helix_dummy_init (ClutterHelixVideoTexture *v)
+GType
+clutter_helix_color_matrix_get_type (void)
 {
+  static GType type = 0;
+
+  if (G_UNLIKELY (type == 0))
+    {
+      static const GEnumValue values[] =
+      {
+        { CLUTTER_HELIX_COLOR_AUTO, "CLUTTER_HELIX_COLOR_AUTO", "auto" },
+        { CLUTTER_HELIX_COLOR_BT601, "CLUTTER_HELIX_COLOR_BT601", "bt601" },
+        { CLUTTER_HELIX_COLOR_BT709, "CLUTTER_HELIX_COLOR_BT709", "bt709" },
+        { 0, NULL, NULL }
+      };
+
+      type = g_enum_register_static ("ClutterHelixColorMatrix", values);
+    }
+
+  return type;
 }
 
-static void
-clutter_helix_dummy_deinit (ClutterHelixVideoTexture *v)
+GType
+clutter_helix_deinterlace_get_type (void)
 {
+  static GType type = 0;
+
+  if (G_UNLIKELY (type == 0))
+    {
+      static const GEnumValue values[] =
+      {
+        { CLUTTER_HELIX_DEINTERLACE_NONE, "CLUTTER_HELIX_DEINTERLACE_NONE", "none" },
+        { CLUTTER_HELIX_DEINTERLACE_BOB, "CLUTTER_HELIX_DEINTERLACE_BOB", "bob" },
+        { CLUTTER_HELIX_DEINTERLACE_BLEND, "CLUTTER_HELIX_DEINTERLACE_BLEND", "blend" },
+        { 0, NULL, NULL }
+      };
+
+      type = g_enum_register_static ("ClutterHelixDeinterlace", values);
+    }
+
+  return type;
 }
 
-/*
- * RGBA / BGRA 8888
- */
+GType
+clutter_helix_field_order_get_type (void)
+{
+  static GType type = 0;
 
-static void
-clutter_helix_rgb32_upload (ClutterHelixVideoTexture *video_texture,
-                            guchar                    *buffer)
+  if (G_UNLIKELY (type == 0))
+    {
+      static const GEnumValue values[] =
+      {
+        { CLUTTER_HELIX_FIELD_ORDER_TOP_FIRST,
+          "CLUTTER_HELIX_FIELD_ORDER_TOP_FIRST", "top-first" },
+        { CLUTTER_HELIX_FIELD_ORDER_BOTTOM_FIRST,
+          "CLUTTER_HELIX_FIELD_ORDER_BOTTOM_FIRST", "bottom-first" },
+        { 0, NULL, NULL }
+      };
+
+      type = g_enum_register_static ("ClutterHelixFieldOrder", values);
+    }
+
+  return type;
+}
+
+static ClutterHelixColorMatrix
+clutter_helix_video_texture_get_color_matrix (ClutterHelixVideoTexture *video_texture)
 {
-  ClutterHelixVideoTexturePrivate *priv= video_texture->priv;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  clutter_texture_set_from_rgb_data (CLUTTER_TEXTURE (video_texture),
-      buffer,
-      TRUE,
-      priv->width,
-      priv->height,
-      (4 * priv->width),
-      4,
-      CLUTTER_TEXTURE_RGB_FLAG_BGR,
-      NULL);
+  if (priv->color_matrix != CLUTTER_HELIX_COLOR_AUTO)
+    return priv->color_matrix;
+
+  /* Helix doesn't tell, HD streams are 709 by convention */
+  return priv->stream_height >= HD_HEIGHT ? CLUTTER_HELIX_COLOR_BT709
+                                          : CLUTTER_HELIX_COLOR_BT601;
 }
 
-static ClutterHelixRenderer rgb32_renderer =
+static gint
+clutter_helix_video_texture_color_variant (ClutterHelixVideoTexture *video_texture)
 {
-  "RGB 32",
-  CLUTTER_HELIX_RGB32,
-  0,
-  clutter_helix_dummy_init,
-  clutter_helix_dummy_deinit,
-  clutter_helix_rgb32_upload,
-};
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (clutter_helix_video_texture_get_color_matrix (video_texture) ==
+        CLUTTER_HELIX_COLOR_BT601 &&
+      !priv->full_range &&
+      priv->brightness == 0.0 &&
+      priv->contrast == 1.0 &&
+      priv->saturation == 1.0)
+    return COLOR_VARIANT_FIXED;
+
+  return COLOR_VARIANT_MATRIX;
+}
 
+/* Computes priv->color_values, see clutter_helix_yuv_matrix() */
 static void
-clutter_helix_video_sink_set_glsl_shader (ClutterHelixVideoTexture *video_texture,
-                                          const gchar              *shader_src)
+clutter_helix_video_texture_compute_colors (ClutterHelixVideoTexture *video_texture)
 {
   ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  if (video_texture)
-    clutter_actor_set_shader (CLUTTER_ACTOR (video_texture), NULL);
-
-  if (priv->program)
-    {
-      cogl_program_unref (priv->program);
-      priv->program = NULL;
-    }
+  clutter_helix_yuv_matrix (clutter_helix_video_texture_get_color_matrix (video_texture) ==
+                              CLUTTER_HELIX_COLOR_BT709,
+                            priv->full_range,
+                            priv->brightness,
+                            priv->contrast,
+                            priv->saturation,
+                            priv->color_values);
+}
 
-  if (priv->shader)
-    {
-      cogl_shader_unref (priv->shader);
-      priv->shader = NULL;
-    }
+/* The deinterlacing done, tiles have a luma texture each and aren't */
+static ClutterHelixDeinterlace
+clutter_helix_video_texture_get_deinterlace (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  if (shader_src)
-    {
-      ClutterShader *shader;
+  return priv->tiles ? CLUTTER_HELIX_DEINTERLACE_NONE : priv->deinterlace;
+}
 
-      /* Set a dummy shader so we don't interfere with the shader stack */
-      shader = clutter_shader_new ();
-      clutter_shader_set_fragment_source (shader, dummy_shader, -1);
-      clutter_actor_set_shader (CLUTTER_ACTOR (video_texture), shader);
-      g_object_unref (shader);
+static ClutterHelixRenderer *
+clutter_helix_find_renderer_by_format (ClutterHelixVideoTexture *video_texture,
+                                       ClutterHelixVideoFormat   format);
+static gboolean regrow_idle_func (gpointer data);
+static ClutterHelixRenderer i420_atlas_renderer;
 
-      /* Create shader through COGL - necessary as we need to be able to set
-      * integer uniform variables for multi-texturing.
-      */
+/* Initializes the renderer again if it needs another shader variant. A
+ * renderer that can't draw the settings at all gets replaced: the last frame
+ * is uploaded again, which picks the renderer anew. */
+static void
+clutter_helix_video_texture_update_shader (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-      priv->shader = cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
-      cogl_shader_source (priv->shader, shader_src);
-      cogl_shader_compile (priv->shader);
+  if (priv->renderer_state != CLUTTER_HELIX_RENDERER_RUNNING)
+    return;
 
-      priv->program = cogl_create_program ();
-      cogl_program_attach_shader (priv->program, priv->shader);
-      cogl_program_link (priv->program);
+  if (priv->renderer != &i420_atlas_renderer &&
+      priv->renderer != clutter_helix_find_renderer_by_format (video_texture,
+                                                               priv->renderer->format))
+    {
+      if (priv->last_frame && priv->regrow_id == 0)
+        priv->regrow_id = clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                                         regrow_idle_func,
+                                                         video_texture,
+                                                         NULL);
+      return;
     }
+
+  if (priv->color_variant < 0)
+    return;
+
+  if (priv->color_variant !=
+        clutter_helix_video_texture_color_variant (video_texture) ||
+      (priv->program_deinterlace >= 0 &&
+       priv->program_deinterlace !=
+         (gint) clutter_helix_video_texture_get_deinterlace (video_texture)))
+    priv->renderer->init (video_texture);
 }
 
+/* To be called when anything the colors depend on changes */
 static void
-clutter_helix_yv12_glsl_paint (ClutterHelixVideoTexture *video_texture,
-                               void                     *dummy)
+clutter_helix_video_texture_update_colors (ClutterHelixVideoTexture *video_texture)
 {
   ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
-  CoglHandle material;
-
-  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
 
-  /* bind the shader */
-  cogl_program_use (priv->program);
+  clutter_helix_video_texture_compute_colors (video_texture);
+  clutter_helix_video_texture_update_shader (video_texture);
 
-  /* Bind the U and V textures in layers 1 and 2 */
-  if (priv->u_tex)
-    cogl_material_set_layer (material, 1, priv->u_tex);
-  if (priv->v_tex)
-    cogl_material_set_layer (material, 2, priv->v_tex);
+  priv->rgba_dirty = TRUE;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (video_texture));
 }
 
-static void
-clutter_helix_yv12_glsl_post_paint (ClutterHelixVideoTexture *video_texture,
-                                     void                    *dummy)
+static gchar *dummy_shader = \
+     FRAGMENT_SHADER_VARS
+     "void main () {"
+     "}";
+
+/* by color variant, for each deinterlacing mode */
+static gchar *yv12_to_rgba_shaders[] =
 {
-  CoglHandle material;
+  YV12_TO_RGBA_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  YV12_TO_RGBA_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB),
+  YV12_FIELDS_TO_RGBA_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB,
+                              LUMA_FIELD_VARS, LUMA_BOB),
+  YV12_FIELDS_TO_RGBA_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB,
+                              LUMA_FIELD_VARS, LUMA_BOB),
+  YV12_FIELDS_TO_RGBA_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB,
+                              LUMA_FIELD_VARS, LUMA_BLEND),
+  YV12_FIELDS_TO_RGBA_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB,
+                              LUMA_FIELD_VARS, LUMA_BLEND)
+};
 
-  /* Remove the extra layers */
-  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
-  cogl_material_remove_layer (material, 1);
-  cogl_material_remove_layer (material, 2);
+/* some renderers don't need all the ClutterHelixRenderer vtable */
+static void
+clutter_helix_dummy_init (ClutterHelixVideoTexture *v)
+{
+}
 
-  /* disable the shader */
-  cogl_program_use (COGL_INVALID_HANDLE);
+static void
+clutter_helix_dummy_deinit (ClutterHelixVideoTexture *v)
+{
 }
 
 /*
- * I420
+ * Plane textures
  *
- * 8 bit Y plane followed by 8 bit 2x2 subsampled U and V planes.
- * Basically the same as YV12, but with the 2 chroma planes switched.
+ * The textures are allocated at priv->cap_width x priv->cap_height, see
+ * clutter_helix_video_texture_upload_frame(), and the frame goes to their top
+ * left corner. Streams changing resolution reuse them as long as they fit.
  */
 
+/* Uploads the blocks of the @width x @height plane at @data that changed
+ * since the last call with @map, or all of them if @all. */
 static void
-clutter_helix_i420_glsl_init (ClutterHelixVideoTexture *video_texture)
+clutter_helix_upload_dirty_blocks (CoglHandle            tex,
+                                   ClutterHelixDirtyMap *map,
+                                   gboolean              all,
+                                   guint                 width,
+                                   guint                 height,
+                                   CoglPixelFormat       format,
+                                   guint                 stride,
+                                   const guchar         *data)
 {
-  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
-  GLint location;
+  guint bpp = format == COGL_PIXEL_FORMAT_G_8 ||
+              format == COGL_PIXEL_FORMAT_A_8 ? 1 : 4;
+  guint columns, rows, i, j, first, x, y, w, h;
+  guint64 hash, *hashes;
+  gboolean dirty;
 
-  clutter_helix_video_sink_set_glsl_shader (video_texture, yv12_to_rgba_shader);
+  columns = (width + DIRTY_BLOCK - 1) / DIRTY_BLOCK;
+  rows    = (height + DIRTY_BLOCK - 1) / DIRTY_BLOCK;
 
-  cogl_program_use (priv->program);
-  location = cogl_program_get_uniform_location (priv->program, "ytex");
-  cogl_program_uniform_1i (location, 0);
-  location = cogl_program_get_uniform_location (priv->program, "vtex");
-  cogl_program_uniform_1i (location, 1);
-  location = cogl_program_get_uniform_location (priv->program, "utex");
-  cogl_program_uniform_1i (location, 2);
-  cogl_program_use (COGL_INVALID_HANDLE);
+  if (columns != map->columns || rows != map->rows)
+    {
+      g_free (map->hashes);
+      map->hashes  = g_new (guint64, columns * rows);
+      map->columns = columns;
+      map->rows    = rows;
+      all = TRUE;
+    }
 
-  _renderer_connect_signals (video_texture,
-                             clutter_helix_yv12_glsl_paint,
-                             clutter_helix_yv12_glsl_post_paint);
+  for (j = 0; j < rows; j++)
+    {
+      y      = j * DIRTY_BLOCK;
+      h      = MIN (DIRTY_BLOCK, height - y);
+      hashes = map->hashes + j * columns;
+
+      /* neighbouring dirty blocks go in one upload, the extra iteration
+       * flushes the last ones */
+      for (i = 0, first = G_MAXUINT; i <= columns; i++)
+        {
+          dirty = FALSE;
+
+          if (i < columns)
+            {
+              x = i * DIRTY_BLOCK;
+              w = MIN (DIRTY_BLOCK, width - x);
+
+              hash = clutter_helix_hash_block (data + y * stride + x * bpp,
+                                               stride, w * bpp, h);
+              dirty = all || hash != hashes[i];
+              hashes[i] = hash;
+
+              if (!dirty)
+                map->saved += w * h * bpp;
+            }
+
+          if (dirty && first == G_MAXUINT)
+            first = i;
+          else if (!dirty && first != G_MAXUINT)
+            {
+              x = first * DIRTY_BLOCK;
+              w = MIN (i * DIRTY_BLOCK, width) - x;
+              cogl_texture_set_region (tex, x, y, x, y, w, h, width, height,
+                                       format, stride, data);
+              map->changed = TRUE;
+              first = G_MAXUINT;
+            }
+        }
+    }
 }
 
 static void
-clutter_helix_yv12_glsl_deinit (ClutterHelixVideoTexture *video_texture)
+clutter_helix_dirty_map_clear (ClutterHelixDirtyMap *map)
 {
-  clutter_helix_video_sink_set_glsl_shader (video_texture, NULL);
+  g_free (map->hashes);
+  memset (map, 0, sizeof (ClutterHelixDirtyMap));
 }
 
-static void
-clutter_helix_yv12_upload (ClutterHelixVideoTexture *video_texture,
-                           guchar                    *buffer)
+/* Uploads a @width x @height plane to *@tex, replacing it first if it isn't
+ * @cap_width x @cap_height. Only the blocks that changed are uploaded if
+ * there is a @map. Returns TRUE if the texture was replaced. */
+static gboolean
+clutter_helix_upload_plane (CoglHandle           *tex,
+                            guint                 cap_width,
+                            guint                 cap_height,
+                            guint                 width,
+                            guint                 height,
+                            CoglPixelFormat       format,
+                            CoglTextureFlags      flags,
+                            guint                 stride,
+                            const guchar         *data,
+                            ClutterHelixDirtyMap *map)
 {
-  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
-  CoglHandle y_tex = cogl_texture_new_from_data (priv->width,
-      priv->height,
-      COGL_TEXTURE_NO_SLICING,
-      COGL_PIXEL_FORMAT_G_8,
-      COGL_PIXEL_FORMAT_G_8,
-      priv->width,
-      buffer);
+  gboolean replace;
 
-  clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (video_texture), y_tex);
-  cogl_texture_unref (y_tex);
+  replace = *tex == COGL_INVALID_HANDLE ||
+            cogl_texture_get_width (*tex) != cap_width ||
+            cogl_texture_get_height (*tex) != cap_height;
 
-  if (priv->u_tex)
-    cogl_texture_unref (priv->u_tex);
+  if (replace)
+    {
+      if (*tex)
+        cogl_texture_unref (*tex);
+      *tex = cogl_texture_new_with_size (cap_width, cap_height, flags, format);
+    }
 
-  if (priv->v_tex)
-    cogl_texture_unref (priv->v_tex);
+  if (map)
+    clutter_helix_upload_dirty_blocks (*tex, map, replace, width, height,
+                                       format, stride, data);
+  else
+    cogl_texture_set_region (*tex, 0, 0, 0, 0, width, height, width, height,
+                             format, stride, data);
 
-  priv->v_tex = cogl_texture_new_from_data (priv->width / 2,
-      priv->height / 2,
-      COGL_TEXTURE_NO_SLICING,
-      COGL_PIXEL_FORMAT_G_8,
-      COGL_PIXEL_FORMAT_G_8,
-      priv->width / 2,
-      buffer +
-      (priv->width * priv->height));
-  priv->u_tex = cogl_texture_new_from_data (priv->width / 2,
-      priv->height / 2,
-      COGL_TEXTURE_NO_SLICING,
-      COGL_PIXEL_FORMAT_G_8,
-      COGL_PIXEL_FORMAT_G_8,
-      priv->width / 2,
-      buffer
-      + (priv->width * priv->height)
-      + (priv->width / 2 * priv->height / 2));
+  return replace;
 }
 
-static ClutterHelixRenderer i420_glsl_renderer =
+/* The dirty map of @plane of the frame, NULL to upload it all */
+static ClutterHelixDirtyMap *
+clutter_helix_video_texture_dirty_map (ClutterHelixVideoTexture *video_texture,
+                                       guint                     plane)
 {
-  "I420 glsl",
-  CLUTTER_HELIX_I420,
-  CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE,
-  clutter_helix_i420_glsl_init,
-  clutter_helix_yv12_glsl_deinit,
-  clutter_helix_yv12_upload,
-};
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-/*
- * I420 (fragment program version)
- *
- * 8 bit Y plane followed by 8 bit 2x2 subsampled U and V planes.
- * Basically the same as YV12, but with the 2 chroma planes switched.
- */
+  return priv->dirty_tiles ? &priv->dirty_maps[plane] : NULL;
+}
 
-#ifdef CLUTTER_COGL_HAS_GL
+/* Makes priv->y_tex, holding a @width x @height frame, the texture of the
+ * actor. Only a new texture has to be set, the others are just redrawn,
+ * unless identical to the last frame. */
 static void
-clutter_helix_video_sink_set_fp_shader (ClutterHelixVideoTexture *video_texture,
-                                        const gchar              *shader_src,
-                                        const int                 size)
+clutter_helix_video_texture_show_plane (ClutterHelixVideoTexture *video_texture,
+                                        gboolean                  replaced,
+                                        guint                     width,
+                                        guint                     height)
 {
   ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean changed = replaced;
+  guint i;
 
-  /* FIXME: implement freeing the shader */
-  if (!shader_src)
-    return;
-
-  priv->syms.glGenProgramsARB (1, &priv->fp);
-  priv->syms.glBindProgramARB (GL_FRAGMENT_PROGRAM_ARB, priv->fp);
-  priv->syms.glProgramStringARB (GL_FRAGMENT_PROGRAM_ARB,
-                                 GL_PROGRAM_FORMAT_ASCII_ARB,
-                                 size,
-                                 (const GLbyte *)shader_src);
-}
-
-static void
-clutter_helix_yv12_fp_paint (ClutterHelixVideoTexture *video_texture,
-                             void                     *dummy)
-{
-  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
-  CoglHandle material;
+  if (priv->dirty_tiles)
+    {
+      for (i = 0; i < G_N_ELEMENTS (priv->dirty_maps); i++)
+        {
+          changed |= priv->dirty_maps[i].changed;
+          priv->bytes_saved += priv->dirty_maps[i].saved;
+          priv->dirty_maps[i].changed = FALSE;
+          priv->dirty_maps[i].saved   = 0;
+        }
 
-  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+      if (!changed)
+        return;
+    }
 
-  /* Bind the U and V textures in layers 1 and 2 */
-  if (priv->u_tex)
-    cogl_material_set_layer (material, 1, priv->u_tex);
-  if (priv->v_tex)
-    cogl_material_set_layer (material, 2, priv->v_tex);
+  priv->rgba_dirty = TRUE;
 
-  /* Cogl doesn't support changing OpenGL state to modify how Cogl primitives
-   * work, but it also doesn't support ARBfp which we currently depend on. For
-   * now we at least ask Cogl to flush any batched primitives so we avoid
-   * binding our shader across the wrong geometry, but there is a risk that
-   * Cogl may start to use ARBfp internally which will conflict with us. */
-  cogl_flush ();
+  if (replaced)
+    clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (video_texture),
+                                      priv->y_tex);
+  else
+    {
+      /* what clutter_texture_set_cogl_texture() does */
+      clutter_actor_queue_redraw (CLUTTER_ACTOR (video_texture));
+      g_signal_emit_by_name (video_texture, "pixbuf-change");
+    }
 
-  /* bind the shader */
-  glEnable (GL_FRAGMENT_PROGRAM_ARB);
-  priv->syms.glBindProgramARB (GL_FRAGMENT_PROGRAM_ARB, priv->fp);
+  priv->tex_s = (gfloat) width / cogl_texture_get_width (priv->y_tex);
+  priv->tex_t = (gfloat) height / cogl_texture_get_height (priv->y_tex);
 }
 
 static void
-clutter_helix_yv12_fp_post_paint (ClutterHelixVideoTexture        *video_texture,
-                                  void                            *dummy)
+clutter_helix_video_texture_free_tiles (ClutterHelixVideoTexture *video_texture)
 {
-  CoglHandle material;
-
-  /* Cogl doesn't support changing OpenGL state to modify how Cogl primitives
-   * work, but it also doesn't support ARBfp which we currently depend on. For
-   * now we at least ask Cogl to flush any batched primitives so we avoid
-   * binding our shader across the wrong geometry, but there is a risk that
-   * Cogl may start to use ARBfp internally which will conflict with us. */
-  cogl_flush ();
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint i, layer;
 
-  /* Remove the extra layers */
-  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
-  cogl_material_remove_layer (material, 1);
-  cogl_material_remove_layer (material, 2);
+  for (i = 0; i < priv->n_tiles; i++)
+    for (layer = 0; layer < 3; layer++)
+      cogl_texture_unref (priv->tiles[i].planes[layer]);
 
-  /* Disable the shader */
-  glDisable (GL_FRAGMENT_PROGRAM_ARB);
+  g_free (priv->tiles);
+  priv->tiles = NULL;
+  priv->n_tiles = 0;
 }
 
-#define I420_FP_SZ    526
-
-static const char *I420_fp[] =
-{ 
-  "!!ARBfp1.0\n",
-  "PARAM c[2] = { { 1, 1.1640625, 0.0625, 2.015625 },\n",
-  "{ 0.5, 0.390625, 0.8125, 1.5976562 } };\n",
-  "TEMP R0;\n",
-  "TEX R0.y, fragment.texcoord[0], texture[0], 2D;\n",
-  "ADD R0.x, R0.y, -c[0].z;\n",
-  "TEX R0.y, fragment.texcoord[0], texture[2], 2D;\n",
-  "ADD R0.z, R0.y, -c[1].x;\n",
-  "MUL R0.x, R0, c[0].y;\n",
-  "MAD result.color.z, R0, c[0].w, R0.x;\n",
-  "TEX R0.y, fragment.texcoord[0], texture[1], 2D;\n",
-  "ADD R0.y, R0, -c[1].x;\n",
-  "MAD R0.z, -R0, c[1].y, R0.x;\n",
-  "MAD result.color.y, -R0, c[1].z, R0.z;\n",
-  "MAD result.color.x, R0.y, c[1].w, R0;\n",
-  "MOV result.color.w, c[0].x;\n",
-  "END\n",
-  NULL
-};
-
 /*
- * Small helpers
+ * RGBA cache
+ *
+ * With the "rgba-cache" property, the shader of the renderer converts each
+ * new frame once, into an RGBA texture through an FBO, and paints are plain
+ * texturing from there. Worth it when frames get painted more than once.
  */
 
 static void
-_string_array_to_char_array (char       *dst,
-                             const char *src[])
+clutter_helix_video_texture_free_rgba (ClutterHelixVideoTexture *video_texture)
 {
-  int i, n;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  for (i = 0; src[i]; i++)
+  if (priv->rgba_fbo)
     {
-      n = strlen (src[i]);
-      memcpy (dst, src[i], n);
-      dst += n;
+      cogl_offscreen_unref (priv->rgba_fbo);
+      priv->rgba_fbo = COGL_INVALID_HANDLE;
+    }
+  if (priv->rgba_tex)
+    {
+      cogl_texture_unref (priv->rgba_tex);
+      priv->rgba_tex = COGL_INVALID_HANDLE;
+    }
+  if (priv->rgba_material)
+    {
+      cogl_material_unref (priv->rgba_material);
+      priv->rgba_material = COGL_INVALID_HANDLE;
     }
-  *dst = '\0';
 }
 
-static void
-clutter_helix_i420_fp_init (ClutterHelixVideoTexture *video_texture)
+/* Converts the frame if it changed, returns FALSE if the cache can't be used
+ * and the frame has to be painted with the renderer's shader */
+static gboolean
+clutter_helix_video_texture_convert_rgba (ClutterHelixVideoTexture *video_texture)
 {
-  gchar *shader;
-
-  shader = g_malloc (I420_FP_SZ + 1);
-  _string_array_to_char_array (shader, I420_fp);
-
-  /* the size given to glProgramStringARB is without the trailing '\0', which
-   * is precisely I420_FP_SZ */
-  clutter_helix_video_sink_set_fp_shader (video_texture, shader, I420_FP_SZ);
-  g_free (shader);
-
-  _renderer_connect_signals (video_texture,
-                             clutter_helix_yv12_fp_paint,
-                             clutter_helix_yv12_fp_post_paint);
-}
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglColor transparent;
+  CoglHandle material;
 
-static void
-clutter_helix_yv12_fp_deinit (ClutterHelixVideoTexture *video_texture)
-{
-  clutter_helix_video_sink_set_fp_shader (video_texture, NULL, 0);
-}
+  /* frames needing no conversion, RGB ones, have no paint functions; the
+   * fp renderers have no Cogl program but convert all the same */
+  if (!priv->rgba_cache || priv->rgba_failed ||
+      priv->renderer_state != CLUTTER_HELIX_RENDERER_RUNNING ||
+      priv->paint_func == NULL || priv->post_paint_func == NULL ||
+      priv->tiles || priv->atlas_slot || priv->y_tex == COGL_INVALID_HANDLE)
+    return FALSE;
 
+  if (!priv->rgba_dirty)
+    return TRUE;
 
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+  if (material == COGL_INVALID_HANDLE)
+    return FALSE;
 
-static ClutterHelixRenderer i420_fp_renderer =
-{
-  "I420 fp",
-  CLUTTER_HELIX_I420,
-  CLUTTER_HELIX_FP | CLUTTER_HELIX_MULTI_TEXTURE,
-  clutter_helix_i420_fp_init,
-  clutter_helix_yv12_fp_deinit,
-  clutter_helix_yv12_upload,
-};
-#endif
+  if (priv->rgba_tex == COGL_INVALID_HANDLE ||
+      cogl_texture_get_width (priv->rgba_tex) != priv->width ||
+      cogl_texture_get_height (priv->rgba_tex) != priv->height)
+    {
+      clutter_helix_video_texture_free_rgba (video_texture);
 
+      if (!cogl_features_available (COGL_FEATURE_OFFSCREEN))
+        {
+          priv->rgba_failed = TRUE;
+          return FALSE;
+        }
 
+      priv->rgba_tex = cogl_texture_new_with_size (priv->width, priv->height,
+                                                   COGL_TEXTURE_NO_SLICING,
+                                                   COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (priv->rgba_tex)
+        priv->rgba_fbo = cogl_offscreen_new_to_texture (priv->rgba_tex);
+      if (priv->rgba_fbo == COGL_INVALID_HANDLE)
+        {
+          g_warning ("Could not create an FBO, the frames will be converted "
+                     "on every paint");
+          clutter_helix_video_texture_free_rgba (video_texture);
+          priv->rgba_failed = TRUE;
+          return FALSE;
+        }
 
-#define TICK_TIMEOUT 0.5
+      priv->rgba_material = cogl_material_new ();
+      cogl_material_set_layer (priv->rgba_material, 0, priv->rgba_tex);
+    }
 
-static void clutter_media_init (ClutterMediaIface *iface);
+  /* drawing to the FBO is in pixels from its bottom left corner, the first
+   * row of the frame ends up as the first row of the texture */
+  cogl_push_draw_buffer ();
+  cogl_set_draw_buffer (COGL_OFFSCREEN_BUFFER, priv->rgba_fbo);
+  cogl_color_set_from_4ub (&transparent, 0, 0, 0, 0);
 
-static gboolean tick_timeout (ClutterHelixVideoTexture *video_texture);
+  /* frames with alpha would blend over the previous one */
+  cogl_clear (&transparent, COGL_BUFFER_BIT_COLOR);
 
+  if (priv->paint_func)
+    priv->paint_func (video_texture, NULL);
 
-G_DEFINE_TYPE_WITH_CODE (ClutterHelixVideoTexture,
-                         clutter_helix_video_texture,
-                         CLUTTER_TYPE_TEXTURE,
-                         G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_MEDIA,
-                                                clutter_media_init));
+  cogl_material_set_color4ub (material, 0xff, 0xff, 0xff, 0xff);
+  cogl_set_source (material);
+  cogl_rectangle_with_texture_coords (0, 0, priv->width, priv->height,
+                                      0, 0, priv->tex_s, priv->tex_t);
 
-static void on_buffering_cb (unsigned int   flags,
-                             unsigned short percentage,
-			                       void          *context);
+  if (priv->post_paint_func)
+    priv->post_paint_func (video_texture, NULL);
 
-static void on_pos_length_cb (unsigned int pos,
-                              unsigned int ulLength, 
-                              void        *context);
+  cogl_pop_draw_buffer ();
 
-static void on_state_change_cb (unsigned short old_state, 
-                                unsigned short new_state, 
-                                void          *context);
+  priv->rgba_dirty = FALSE;
 
-static void on_new_frame_cb (unsigned char *p, 
-			                       unsigned int   size, 
-			                       PlayerImgInfo *Info, 
-			                       void          *context);
+  return TRUE;
+}
 
-static void on_error_cb (unsigned long code,
-                         char         *message,
-                         void         *context);
+/* Paints the converted frame, if clutter_helix_video_texture_convert_rgba()
+ * said so. Any shader bound for the frame gets unbound. */
+static void
+clutter_helix_video_texture_paint_rgba (ClutterHelixVideoTexture *video_texture,
+                                        gfloat                    x_1,
+                                        gfloat                    y_1,
+                                        gfloat                    x_2,
+                                        gfloat                    y_2,
+                                        guint8                    opacity)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-static gboolean get_playing (ClutterMedia *media);
+  cogl_program_use (COGL_INVALID_HANDLE);
 
-static void set_playing (ClutterMedia *media,
-                         gboolean      playing);
+  cogl_material_set_color4ub (priv->rgba_material,
+                              opacity, opacity, opacity, opacity);
+  cogl_set_source (priv->rgba_material);
+  cogl_rectangle (x_1, y_1, x_2, y_2);
+}
 
-/* Interface implementation */
 static void
-set_uri (ClutterMedia    *media,
-         const char      *uri)
+clutter_helix_video_texture_drop_planes (ClutterHelixVideoTexture *video_texture)
 {
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE(media);
-  ClutterHelixVideoTexturePrivate *priv; 
-  gboolean is_playing = FALSE;
-
-  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
-
-  priv = video_texture->priv;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  if (!priv->player)
-    return;
+  clutter_helix_video_texture_free_tiles (video_texture);
+  clutter_helix_video_texture_free_rgba (video_texture);
 
-  if (priv->uri)
+  if (priv->y_tex)
     {
-      is_playing = get_playing (media);
-      player_stop (priv->player);
-      g_free (priv->uri);
+      cogl_texture_unref (priv->y_tex);
+      priv->y_tex = NULL;
     }
-
-  if (uri) 
+  if (priv->u_tex)
     {
-      priv->uri = g_strdup (uri);
-    
-      /**
-       * Ensure the tick timeout is installed.
-       * 
-       * We also have it installed in PAUSED state, because
-       * seeks etc may have a delayed effect on the position.
-       **/
-      if (priv->tick_timeout_id == 0)
-        {
-          priv->tick_timeout_id = g_timeout_add (TICK_TIMEOUT * 1000,
-						 (GSourceFunc) tick_timeout,
-						 video_texture);
-        }
-      player_openurl (priv->player, priv->uri);
-      if (is_playing)
-        player_begin (priv->player);
-    } 
-  else 
+      cogl_texture_unref (priv->u_tex);
+      priv->u_tex = NULL;
+    }
+  if (priv->v_tex)
     {
-      priv->uri = NULL;
-    
-      if (priv->tick_timeout_id > 0) 
-	      {
-	        g_source_remove (priv->tick_timeout_id);
-	        priv->tick_timeout_id = 0;
-	      }
+      cogl_texture_unref (priv->v_tex);
+      priv->v_tex = NULL;
+    }
+  if (priv->a_tex)
+    {
+      cogl_texture_unref (priv->a_tex);
+      priv->a_tex = NULL;
     }
-  
-  priv->can_seek = FALSE;
-  priv->duration = 0;
 
-  
-  /*
-   * Emit notififications for all these to make sure UI is not showing
-   * any properties of the old URI.
-   */
-  g_object_notify (G_OBJECT (video_texture), "uri");
-  g_object_notify (G_OBJECT (video_texture), "can-seek");
-  g_object_notify (G_OBJECT (video_texture), "duration");
-  g_object_notify (G_OBJECT (video_texture), "progress");
+  priv->cap_width = priv->cap_height = 0;
+  priv->tex_s = priv->tex_t = 1.0;
 }
 
-static const char *
-get_uri (ClutterMedia *media)
-{
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
-  ClutterHelixVideoTexturePrivate *priv; 
+/*
+ * Tiles
+ *
+ * Planes larger than GL_MAX_TEXTURE_SIZE are split into a grid of tiles,
+ * each with textures for the 3 planes, painted one after the other with the
+ * shader of the renderer. Cogl can slice single textures itself, that's
+ * enough for RGB32, but not for the layers of a material.
+ */
 
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), NULL);
+static gboolean
+clutter_helix_video_texture_needs_tiles (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  priv = video_texture->priv;
+  if (priv->max_texture_size == 0)
+    glGetIntegerv (GL_MAX_TEXTURE_SIZE, &priv->max_texture_size);
 
-  return priv->uri;
+  return priv->cap_width > (guint) priv->max_texture_size ||
+         priv->cap_height > (guint) priv->max_texture_size;
 }
 
+/* Splits the priv->cap_width x priv->cap_height planes into tiles, unless
+ * already done. Returns TRUE if the tiles are new. */
 static gboolean
-get_playing (ClutterMedia *media)
+clutter_helix_video_texture_make_tiles (ClutterHelixVideoTexture *video_texture)
 {
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
-  ClutterHelixVideoTexturePrivate *priv; 
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixTile *tile;
+  guint cap_width, cap_height, step, columns, rows, i, j, layer, sub;
 
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), FALSE);
+  if (priv->n_tiles > 0)
+    {
+      tile = &priv->tiles[priv->n_tiles - 1];
+      if (tile->x + tile->width == priv->cap_width &&
+          tile->y + tile->height == priv->cap_height)
+        return FALSE;
+    }
 
-  priv = video_texture->priv;
+  /* the tiles replace the plane textures */
+  cap_width  = priv->cap_width;
+  cap_height = priv->cap_height;
+  clutter_helix_video_texture_drop_planes (video_texture);
+  priv->cap_width  = cap_width;
+  priv->cap_height = cap_height;
 
-  if (!priv->player)
-    return FALSE;
+  /* even, so that the chroma tiles hold exactly half */
+  step = (priv->max_texture_size - 2 * TILE_BORDER) & ~1;
+  columns = (priv->cap_width + step - 1) / step;
+  rows    = (priv->cap_height + step - 1) / step;
+
+  priv->n_tiles = columns * rows;
+  priv->tiles   = g_new0 (ClutterHelixTile, priv->n_tiles);
+
+  for (j = 0; j < rows; j++)
+    for (i = 0; i < columns; i++)
+      {
+        tile = &priv->tiles[j * columns + i];
+
+        tile->x      = i * step;
+        tile->y      = j * step;
+        tile->width  = MIN (step, priv->cap_width - tile->x);
+        tile->height = MIN (step, priv->cap_height - tile->y);
+
+        tile->tex_x      = tile->x > 0 ? tile->x - TILE_BORDER : 0;
+        tile->tex_y      = tile->y > 0 ? tile->y - TILE_BORDER : 0;
+        tile->tex_width  = MIN (tile->x + tile->width + TILE_BORDER,
+                                priv->cap_width) - tile->tex_x;
+        tile->tex_height = MIN (tile->y + tile->height + TILE_BORDER,
+                                priv->cap_height) - tile->tex_y;
+
+        for (layer = 0; layer < 3; layer++)
+          {
+            sub = layer > 0 ? 2 : 1;
+            tile->planes[layer] =
+              cogl_texture_new_with_size (tile->tex_width / sub,
+                                          tile->tex_height / sub,
+                                          COGL_TEXTURE_NO_SLICING,
+                                          COGL_PIXEL_FORMAT_G_8);
+          }
+      }
 
-  return (priv->state == PLAYER_STATE_PLAYING);
+  return TRUE;
 }
 
+/* Same as clutter_helix_yv12_upload(), to the tiles */
 static void
-set_playing (ClutterMedia *media,
-	           gboolean      playing)
+clutter_helix_video_texture_upload_tiles (ClutterHelixVideoTexture *video_texture,
+                                          const guchar             *buffer)
 {
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
-  ClutterHelixVideoTexturePrivate *priv; 
-
-  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+  static const guint layer_plane[3] = { 0, 2, 1 };
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixTile *tile;
+  guint i, layer, plane, sub, width, height, x, y;
+  gboolean replaced;
 
-  priv = video_texture->priv;
+  replaced = clutter_helix_video_texture_make_tiles (video_texture);
 
-  if (!priv->player)
-    return;
-        
-  if (priv->uri) 
+  for (i = 0; i < priv->n_tiles; i++)
     {
-      if (playing && !get_playing (media))
-        {
-          player_begin (priv->player);
-        }
-      else if (!playing && get_playing (media))
+      tile = &priv->tiles[i];
+
+      for (layer = 0; layer < 3; layer++)
         {
-          priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
-          player_pause(priv->player);
+          plane  = layer_plane[layer];
+          sub    = plane > 0 ? 2 : 1;
+          width  = (priv->width + sub - 1) / sub;
+          height = (priv->height + sub - 1) / sub;
+          x      = tile->tex_x / sub;
+          y      = tile->tex_y / sub;
+
+          if (x >= width || y >= height)
+            continue;
+
+          cogl_texture_set_region (tile->planes[layer], x, y, 0, 0,
+                                   MIN (tile->tex_width / sub, width - x),
+                                   MIN (tile->tex_height / sub, height - y),
+                                   width, height,
+                                   COGL_PIXEL_FORMAT_G_8,
+                                   priv->strides[plane],
+                                   buffer + priv->offsets[plane]);
         }
-    } 
-  else 
+    }
+
+  if (replaced)
+    clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (video_texture),
+                                      priv->tiles[0].planes[0]);
+  else
     {
-      if (playing)
-        g_warning ("Tried to play, but no URI is loaded.");
+      clutter_actor_queue_redraw (CLUTTER_ACTOR (video_texture));
+      g_signal_emit_by_name (video_texture, "pixbuf-change");
     }
-  
-  g_object_notify (G_OBJECT (video_texture), "playing");
-  g_object_notify (G_OBJECT (video_texture), "progress");
 }
-static void
-set_position (ClutterMedia *media,
-	            gdouble       position) /* seconds */
+
+/* Where @tile goes when painting the frame from (@x_1, @y_1) to (@x_2, @y_2):
+ * @coords gets the rectangle then its texture coordinates, as x_1, y_1, x_2,
+ * y_2, s_1, t_1, s_2, t_2. Returns FALSE if the tile is out of the frame. */
+static gboolean
+clutter_helix_video_texture_tile_coords (ClutterHelixVideoTexture *video_texture,
+                                         ClutterHelixTile         *tile,
+                                         gfloat                    x_1,
+                                         gfloat                    y_1,
+                                         gfloat                    x_2,
+                                         gfloat                    y_2,
+                                         gfloat                   *coords)
 {
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
-  ClutterHelixVideoTexturePrivate *priv; 
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gfloat x_scale, y_scale;
+  guint right, bottom;
 
-  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+  if (tile->x >= priv->width || tile->y >= priv->height)
+    return FALSE;
 
-  priv = video_texture->priv;
+  x_scale = (x_2 - x_1) / priv->width;
+  y_scale = (y_2 - y_1) / priv->height;
+  right   = MIN (tile->x + tile->width, priv->width);
+  bottom  = MIN (tile->y + tile->height, priv->height);
 
-  if (!priv->player)
-    return;
+  coords[0] = x_1 + tile->x * x_scale;
+  coords[1] = y_1 + tile->y * y_scale;
+  coords[2] = x_1 + right * x_scale;
+  coords[3] = y_1 + bottom * y_scale;
+  coords[4] = (gfloat) (tile->x - tile->tex_x) / tile->tex_width;
+  coords[5] = (gfloat) (tile->y - tile->tex_y) / tile->tex_height;
+  coords[6] = (gfloat) (right - tile->tex_x) / tile->tex_width;
+  coords[7] = (gfloat) (bottom - tile->tex_y) / tile->tex_height;
 
-  player_seek (priv->player, position * 1000);
+  return TRUE;
 }
 
+/* Paints the priv->width x priv->height frame held by the tiles in
+ * (@x_1, @y_1) - (@x_2, @y_2), with @material as the source */
 static void
-set_progress (ClutterMedia *media,
-	            gdouble       progress)
+clutter_helix_video_texture_paint_tiles (ClutterHelixVideoTexture *video_texture,
+                                         CoglHandle                material,
+                                         gfloat                    x_1,
+                                         gfloat                    y_1,
+                                         gfloat                    x_2,
+                                         gfloat                    y_2)
 {
-  if (progress >= 0 && progress <= 1.0) {
-    ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
-    ClutterHelixVideoTexturePrivate *priv; 
-
-    g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixTile *tile;
+  gfloat coords[8];
+  guint i, layer;
 
-    priv = video_texture->priv;
-    
-    gdouble position = 0;
-    if (priv->duration > 0)
-      {
-        position = (gint)(progress * (gdouble)priv->duration);
-      }
-    set_position (media, position);
-    g_object_notify (G_OBJECT (video_texture), "progress");
-  }
-}
+  for (i = 0; i < priv->n_tiles; i++)
+    {
+      tile = &priv->tiles[i];
 
-static int
-get_position (ClutterMedia *media)
-{
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
-  ClutterHelixVideoTexturePrivate *priv; 
-  gint32 position;
+      if (!clutter_helix_video_texture_tile_coords (video_texture, tile,
+                                                    x_1, y_1, x_2, y_2,
+                                                    coords))
+        continue;
 
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
+      for (layer = 0; layer < 3; layer++)
+        cogl_material_set_layer (material, layer, tile->planes[layer]);
 
-  priv = video_texture->priv;
+      cogl_set_source (material);
+      cogl_rectangle_with_texture_coords (coords[0], coords[1],
+                                          coords[2], coords[3],
+                                          coords[4], coords[5],
+                                          coords[6], coords[7]);
+    }
 
-  if (!priv->player)
-    return -1;
-  
-  position = get_curr_playtime (priv->player);
-  return (position / 1000);
+  /* back to the texture ClutterTexture knows about */
+  cogl_material_set_layer (material, 0, priv->tiles[0].planes[0]);
 }
 
-static gdouble get_progress (ClutterMedia *media)
-{
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE(media);
-  ClutterHelixVideoTexturePrivate *priv; 
-  gint32 position;
-  gdouble progress = 0.0;
-
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
+/*
+ * RGBA / BGRA 8888
+ */
 
-  priv = video_texture->priv;
+static void
+clutter_helix_rgb32_upload (ClutterHelixVideoTexture *video_texture,
+                            guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv= video_texture->priv;
+  gboolean replaced;
 
-  if (!priv->player)
-    return 0;
-  
-  position = get_position (media);
-  if (priv->duration > 0)
-    progress = (gdouble)position/(gdouble)priv->duration;
+  /* sliced by Cogl if larger than GL allows */
+  replaced = clutter_helix_upload_plane (&priv->y_tex,
+      priv->cap_width,
+      priv->cap_height,
+      priv->width,
+      priv->height,
+      COGL_PIXEL_FORMAT_BGRA_8888,
+      COGL_TEXTURE_NO_AUTO_MIPMAP,
+      priv->strides[0],
+      buffer,
+      clutter_helix_video_texture_dirty_map (video_texture, 0));
 
-  return progress;
+  clutter_helix_video_texture_show_plane (video_texture, replaced,
+                                          priv->width, priv->height);
 }
 
+static ClutterHelixRenderer rgb32_renderer =
+{
+  "RGB 32",
+  CLUTTER_HELIX_RGB32,
+  0,
+  clutter_helix_dummy_init,
+  clutter_helix_dummy_deinit,
+  clutter_helix_rgb32_upload,
+};
+
 static void
-set_volume (ClutterMedia *media,
-	          double        volume)
+clutter_helix_video_sink_set_glsl_shader (ClutterHelixVideoTexture *video_texture,
+                                          const gchar              *shader_src)
 {
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
-  ClutterHelixVideoTexturePrivate *priv; 
-  unsigned short volume_in_u16;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+  if (video_texture)
+    clutter_actor_set_shader (CLUTTER_ACTOR (video_texture), NULL);
 
-  priv = video_texture->priv;
-  
-  if (!priv->player)
-    return;
+  priv->color_variant       = -1;
+  priv->program_deinterlace = -1;
 
-  if (volume >= 1.0)
-    volume_in_u16 = 100;
-  else if (volume <= 0.0)
-    volume_in_u16 = 0;
-  else
-    volume_in_u16 = (int)(volume * (100.0));
+  if (priv->program)
+    {
+      cogl_program_unref (priv->program);
+      priv->program = NULL;
+    }
 
-  player_setvolume (priv->player, volume_in_u16);  
-  g_object_notify (G_OBJECT (video_texture), "audio-volume");
-}
+  if (priv->shader)
+    {
+      cogl_shader_unref (priv->shader);
+      priv->shader = NULL;
+    }
 
-static double
-get_volume (ClutterMedia *media)
-{
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE(media);
-  ClutterHelixVideoTexturePrivate *priv; 
+  if (shader_src)
+    {
+      ClutterShader *shader;
 
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), 0.0);
+      /* Set a dummy shader so we don't interfere with the shader stack */
+      shader = clutter_shader_new ();
+      clutter_shader_set_fragment_source (shader, dummy_shader, -1);
+      clutter_actor_set_shader (CLUTTER_ACTOR (video_texture), shader);
+      g_object_unref (shader);
 
-  priv = video_texture->priv;
-  
-  if (!priv->player)
-    return 0.0;
+      /* programs are kept, renderers get initialized again on pauses and
+       * when switching shader variants */
+      priv->program = g_hash_table_lookup (priv->programs, shader_src);
+      if (priv->program)
+        {
+          priv->program = cogl_program_ref (priv->program);
+          return;
+        }
 
-  int ret;
-  ret = player_getvolume (priv->player);
-  if (ret < 0)
-    ret = 0;
-  
-  return (double)((double)ret/(double)100);
+      /* Create shader through COGL - necessary as we need to be able to set
+      * integer uniform variables for multi-texturing.
+      */
+
+      priv->shader = cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
+      cogl_shader_source (priv->shader, shader_src);
+      cogl_shader_compile (priv->shader);
+
+      priv->program = cogl_create_program ();
+      cogl_program_attach_shader (priv->program, priv->shader);
+      cogl_program_link (priv->program);
+
+      g_hash_table_insert (priv->programs, (gpointer) shader_src,
+                           cogl_program_ref (priv->program));
+    }
 }
 
-static gboolean
-can_seek (ClutterMedia *media)
+/* Binds the variant of @shader_srcs the color and deinterlacing settings
+ * need, see clutter_helix_video_texture_update_shader(). @shader_srcs are by
+ * color variant, for each deinterlacing mode if there are @n_srcs for it. */
+static void
+clutter_helix_video_sink_set_yuv_shader (ClutterHelixVideoTexture *video_texture,
+                                         gchar                   **shader_srcs,
+                                         guint                     n_srcs)
 {
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gint variant, deinterlace = -1;
 
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), FALSE);
-  
-  return video_texture->priv->can_seek;
+  variant = clutter_helix_video_texture_color_variant (video_texture);
+  if (n_srcs >= N_COLOR_VARIANTS * N_DEINTERLACE_MODES)
+    deinterlace = clutter_helix_video_texture_get_deinterlace (video_texture);
+
+  clutter_helix_video_sink_set_glsl_shader (video_texture,
+    shader_srcs[variant + N_COLOR_VARIANTS * MAX (deinterlace, 0)]);
+  priv->color_variant       = variant;
+  priv->program_deinterlace = deinterlace;
+
+  if (deinterlace > CLUTTER_HELIX_DEINTERLACE_NONE)
+    {
+      priv->luma_height_location =
+        cogl_program_get_uniform_location (priv->program, "luma_height");
+      priv->field_location =
+        cogl_program_get_uniform_location (priv->program, "field");
+    }
+
+  if (variant == COLOR_VARIANT_MATRIX)
+    {
+      priv->color_matrix_location =
+        cogl_program_get_uniform_location (priv->program, "color_matrix");
+      priv->color_offset_location =
+        cogl_program_get_uniform_location (priv->program, "color_offset");
+    }
 }
 
-static int
-get_buffer_percent (ClutterMedia *media)
+/* with the program of the renderer in use */
+static void
+clutter_helix_video_texture_color_uniforms (ClutterHelixVideoTexture *video_texture)
 {
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
 
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
-  
-  return video_texture->priv->buffer_percent;
+  if (priv->color_variant != COLOR_VARIANT_MATRIX)
+    return;
+
+  cogl_program_uniform_matrix (priv->color_matrix_location, 3, 1, FALSE,
+                               priv->color_values);
+  cogl_program_uniform_float (priv->color_offset_location, 3, 1,
+                              priv->color_values + 9);
 }
 
-static int
-get_duration(ClutterMedia *media)
+/* with the program of the renderer in use */
+static void
+clutter_helix_video_texture_field_uniforms (ClutterHelixVideoTexture *video_texture)
 {
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean bottom;
 
-  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  if (priv->program_deinterlace <= CLUTTER_HELIX_DEINTERLACE_NONE)
+    return;
 
-  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
-  
-  return video_texture->priv->duration;
+  /* the field shown: the first one in order, then the other one in bob */
+  bottom = (priv->frame_flags & CLUTTER_HELIX_FRAME_BOTTOM_FIRST) != 0;
+  if (priv->second_field)
+    bottom = !bottom;
+
+  cogl_program_uniform_1f (priv->luma_height_location, priv->cap_height);
+  cogl_program_uniform_1f (priv->field_location, bottom ? 1.0 : 0.0);
 }
 
 static void
-clutter_media_init (ClutterMediaIface *iface)
+clutter_helix_yv12_glsl_paint (ClutterHelixVideoTexture *video_texture,
+                               void                     *dummy)
 {
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle material;
+
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+
+  /* bind the shader */
+  cogl_program_use (priv->program);
+  clutter_helix_video_texture_color_uniforms (video_texture);
+  clutter_helix_video_texture_field_uniforms (video_texture);
 
+  /* Bind the U and V textures in layers 1 and 2 */
+  if (priv->u_tex)
+    cogl_material_set_layer (material, 1, priv->u_tex);
+  if (priv->v_tex)
+    cogl_material_set_layer (material, 2, priv->v_tex);
 }
 
 static void
-clutter_helix_video_texture_dispose (GObject *object)
+clutter_helix_yv12_glsl_post_paint (ClutterHelixVideoTexture *video_texture,
+                                     void                    *dummy)
 {
-  ClutterHelixVideoTexture        *self;
-  ClutterHelixVideoTexturePrivate *priv; 
+  CoglHandle material;
 
-  self = CLUTTER_HELIX_VIDEO_TEXTURE (object); 
-  priv = self->priv;
+  /* Remove the extra layers */
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+  cogl_material_remove_layer (material, 1);
+  cogl_material_remove_layer (material, 2);
 
-  if (priv->player) 
+  /* disable the shader */
+  cogl_program_use (COGL_INVALID_HANDLE);
+}
+
+/*
+ * I420
+ *
+ * 8 bit Y plane followed by 8 bit 2x2 subsampled U and V planes.
+ * Basically the same as YV12, but with the 2 chroma planes switched.
+ */
+
+static void
+clutter_helix_i420_glsl_init (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  GLint location;
+
+  clutter_helix_video_sink_set_yuv_shader (video_texture, yv12_to_rgba_shaders,
+                                           G_N_ELEMENTS (yv12_to_rgba_shaders));
+
+  cogl_program_use (priv->program);
+  location = cogl_program_get_uniform_location (priv->program, "ytex");
+  cogl_program_uniform_1i (location, 0);
+  location = cogl_program_get_uniform_location (priv->program, "vtex");
+  cogl_program_uniform_1i (location, 1);
+  location = cogl_program_get_uniform_location (priv->program, "utex");
+  cogl_program_uniform_1i (location, 2);
+  cogl_program_use (COGL_INVALID_HANDLE);
+
+  _renderer_connect_signals (video_texture,
+                             clutter_helix_yv12_glsl_paint,
+                             clutter_helix_yv12_glsl_post_paint);
+}
+
+static void
+clutter_helix_yv12_glsl_deinit (ClutterHelixVideoTexture *video_texture)
+{
+  clutter_helix_video_sink_set_glsl_shader (video_texture, NULL);
+}
+
+static void
+clutter_helix_yv12_upload (ClutterHelixVideoTexture *video_texture,
+                           guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint cw = (priv->width + 1) / 2, ch = (priv->height + 1) / 2;
+  gboolean replaced;
+
+  if (clutter_helix_video_texture_needs_tiles (video_texture))
+    {
+      clutter_helix_video_texture_upload_tiles (video_texture, buffer);
+      return;
+    }
+  clutter_helix_video_texture_free_tiles (video_texture);
+
+  replaced = clutter_helix_upload_plane (&priv->y_tex,
+      priv->cap_width,
+      priv->cap_height,
+      priv->width,
+      priv->height,
+      COGL_PIXEL_FORMAT_G_8,
+      COGL_TEXTURE_NO_SLICING,
+      priv->strides[0],
+      buffer + priv->offsets[0],
+      clutter_helix_video_texture_dirty_map (video_texture, 0));
+
+  clutter_helix_upload_plane (&priv->v_tex,
+      priv->cap_width / 2,
+      priv->cap_height / 2,
+      cw,
+      ch,
+      COGL_PIXEL_FORMAT_G_8,
+      COGL_TEXTURE_NO_SLICING,
+      priv->strides[1],
+      buffer + priv->offsets[1],
+      clutter_helix_video_texture_dirty_map (video_texture, 1));
+  clutter_helix_upload_plane (&priv->u_tex,
+      priv->cap_width / 2,
+      priv->cap_height / 2,
+      cw,
+      ch,
+      COGL_PIXEL_FORMAT_G_8,
+      COGL_TEXTURE_NO_SLICING,
+      priv->strides[2],
+      buffer + priv->offsets[2],
+      clutter_helix_video_texture_dirty_map (video_texture, 2));
+
+  clutter_helix_video_texture_show_plane (video_texture, replaced,
+                                          priv->width, priv->height);
+}
+
+static ClutterHelixRenderer i420_glsl_renderer =
+{
+  "I420 glsl",
+  CLUTTER_HELIX_I420,
+  CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE,
+  clutter_helix_i420_glsl_init,
+  clutter_helix_yv12_glsl_deinit,
+  clutter_helix_yv12_upload,
+};
+
+/*
+ * I420 (fragment program version)
+ *
+ * 8 bit Y plane followed by 8 bit 2x2 subsampled U and V planes.
+ * Basically the same as YV12, but with the 2 chroma planes switched.
+ */
+
+#ifdef CLUTTER_COGL_HAS_GL
+static void
+clutter_helix_video_sink_set_fp_shader (ClutterHelixVideoTexture *video_texture,
+                                        const gchar              *shader_src,
+                                        const int                 size)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  /* FIXME: implement freeing the shader */
+  if (!shader_src)
+    return;
+
+  priv->syms.glGenProgramsARB (1, &priv->fp);
+  priv->syms.glBindProgramARB (GL_FRAGMENT_PROGRAM_ARB, priv->fp);
+  priv->syms.glProgramStringARB (GL_FRAGMENT_PROGRAM_ARB,
+                                 GL_PROGRAM_FORMAT_ASCII_ARB,
+                                 size,
+                                 (const GLbyte *)shader_src);
+}
+
+static void
+clutter_helix_yv12_fp_paint (ClutterHelixVideoTexture *video_texture,
+                             void                     *dummy)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle material;
+
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+
+  /* Bind the U and V textures in layers 1 and 2 */
+  if (priv->u_tex)
+    cogl_material_set_layer (material, 1, priv->u_tex);
+  if (priv->v_tex)
+    cogl_material_set_layer (material, 2, priv->v_tex);
+
+  /* Cogl doesn't support changing OpenGL state to modify how Cogl primitives
+   * work, but it also doesn't support ARBfp which we currently depend on. For
+   * now we at least ask Cogl to flush any batched primitives so we avoid
+   * binding our shader across the wrong geometry, but there is a risk that
+   * Cogl may start to use ARBfp internally which will conflict with us. */
+  cogl_flush ();
+
+  /* bind the shader */
+  glEnable (GL_FRAGMENT_PROGRAM_ARB);
+  priv->syms.glBindProgramARB (GL_FRAGMENT_PROGRAM_ARB, priv->fp);
+}
+
+static void
+clutter_helix_yv12_fp_post_paint (ClutterHelixVideoTexture        *video_texture,
+                                  void                            *dummy)
+{
+  CoglHandle material;
+
+  /* Cogl doesn't support changing OpenGL state to modify how Cogl primitives
+   * work, but it also doesn't support ARBfp which we currently depend on. For
+   * now we at least ask Cogl to flush any batched primitives so we avoid
+   * binding our shader across the wrong geometry, but there is a risk that
+   * Cogl may start to use ARBfp internally which will conflict with us. */
+  cogl_flush ();
+
+  /* Remove the extra layers */
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+  cogl_material_remove_layer (material, 1);
+  cogl_material_remove_layer (material, 2);
+
+  /* Disable the shader */
+  glDisable (GL_FRAGMENT_PROGRAM_ARB);
+}
+
+#define I420_FP_SZ    526
+
+static const char *I420_fp[] =
+{ 
+  "!!ARBfp1.0\n",
+  "PARAM c[2] = { { 1, 1.1640625, 0.0625, 2.015625 },\n",
+  "{ 0.5, 0.390625, 0.8125, 1.5976562 } };\n",
+  "TEMP R0;\n",
+  "TEX R0.y, fragment.texcoord[0], texture[0], 2D;\n",
+  "ADD R0.x, R0.y, -c[0].z;\n",
+  "TEX R0.y, fragment.texcoord[0], texture[2], 2D;\n",
+  "ADD R0.z, R0.y, -c[1].x;\n",
+  "MUL R0.x, R0, c[0].y;\n",
+  "MAD result.color.z, R0, c[0].w, R0.x;\n",
+  "TEX R0.y, fragment.texcoord[0], texture[1], 2D;\n",
+  "ADD R0.y, R0, -c[1].x;\n",
+  "MAD R0.z, -R0, c[1].y, R0.x;\n",
+  "MAD result.color.y, -R0, c[1].z, R0.z;\n",
+  "MAD result.color.x, R0.y, c[1].w, R0;\n",
+  "MOV result.color.w, c[0].x;\n",
+  "END\n",
+  NULL
+};
+
+/*
+ * Small helpers
+ */
+
+static void
+_string_array_to_char_array (char       *dst,
+                             const char *src[])
+{
+  int i, n;
+
+  for (i = 0; src[i]; i++)
+    {
+      n = strlen (src[i]);
+      memcpy (dst, src[i], n);
+      dst += n;
+    }
+  *dst = '\0';
+}
+
+static void
+clutter_helix_i420_fp_init (ClutterHelixVideoTexture *video_texture)
+{
+  gchar *shader;
+
+  shader = g_malloc (I420_FP_SZ + 1);
+  _string_array_to_char_array (shader, I420_fp);
+
+  /* the size given to glProgramStringARB is without the trailing '\0', which
+   * is precisely I420_FP_SZ */
+  clutter_helix_video_sink_set_fp_shader (video_texture, shader, I420_FP_SZ);
+  g_free (shader);
+
+  _renderer_connect_signals (video_texture,
+                             clutter_helix_yv12_fp_paint,
+                             clutter_helix_yv12_fp_post_paint);
+}
+
+static void
+clutter_helix_yv12_fp_deinit (ClutterHelixVideoTexture *video_texture)
+{
+  clutter_helix_video_sink_set_fp_shader (video_texture, NULL, 0);
+}
+
+
+
+static ClutterHelixRenderer i420_fp_renderer =
+{
+  "I420 fp",
+  CLUTTER_HELIX_I420,
+  CLUTTER_HELIX_FP | CLUTTER_HELIX_MULTI_TEXTURE,
+  clutter_helix_i420_fp_init,
+  clutter_helix_yv12_fp_deinit,
+  clutter_helix_yv12_upload,
+};
+#endif
+
+/*
+ * NV12
+ *
+ * 8 bit Y plane followed by an 8 bit 2x2 subsampled plane of interleaved U
+ * and V samples. The UV plane goes as is to a single channel texture, the
+ * shader picks the samples apart.
+ */
+
+#ifdef CID_NV12
+static gchar *nv12_to_rgba_shaders[] =
+{
+  NV12_TO_RGBA_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  NV12_TO_RGBA_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB)
+};
+
+static void
+clutter_helix_nv12_glsl_paint (ClutterHelixVideoTexture *video_texture,
+                               void                     *dummy)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle material;
+
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+
+  /* bind the shader */
+  cogl_program_use (priv->program);
+  clutter_helix_video_texture_color_uniforms (video_texture);
+  cogl_program_uniform_1f (priv->chroma_width_location, priv->cap_width / 2);
+
+  /* Bind the UV texture in layer 1 */
+  if (priv->u_tex)
+    cogl_material_set_layer (material, 1, priv->u_tex);
+}
+
+static void
+clutter_helix_nv12_glsl_post_paint (ClutterHelixVideoTexture *video_texture,
+                                    void                     *dummy)
+{
+  CoglHandle material;
+
+  /* Remove the extra layer */
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+  cogl_material_remove_layer (material, 1);
+
+  /* disable the shader */
+  cogl_program_use (COGL_INVALID_HANDLE);
+}
+
+static void
+clutter_helix_nv12_glsl_init (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  GLint location;
+
+  clutter_helix_video_sink_set_yuv_shader (video_texture, nv12_to_rgba_shaders,
+                                           G_N_ELEMENTS (nv12_to_rgba_shaders));
+
+  cogl_program_use (priv->program);
+  location = cogl_program_get_uniform_location (priv->program, "ytex");
+  cogl_program_uniform_1i (location, 0);
+  location = cogl_program_get_uniform_location (priv->program, "uvtex");
+  cogl_program_uniform_1i (location, 1);
+  priv->chroma_width_location =
+    cogl_program_get_uniform_location (priv->program, "chroma_width");
+  cogl_program_use (COGL_INVALID_HANDLE);
+
+  _renderer_connect_signals (video_texture,
+                             clutter_helix_nv12_glsl_paint,
+                             clutter_helix_nv12_glsl_post_paint);
+}
+
+static void
+clutter_helix_nv12_upload (ClutterHelixVideoTexture *video_texture,
+                           guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean replaced;
+
+  replaced = clutter_helix_upload_plane (&priv->y_tex,
+      priv->cap_width,
+      priv->cap_height,
+      priv->width,
+      priv->height,
+      COGL_PIXEL_FORMAT_G_8,
+      COGL_TEXTURE_NO_SLICING,
+      priv->strides[0],
+      buffer + priv->offsets[0],
+      clutter_helix_video_texture_dirty_map (video_texture, 0));
+
+  /* cap_width / 2 UV pairs */
+  clutter_helix_upload_plane (&priv->u_tex,
+      priv->cap_width,
+      priv->cap_height / 2,
+      (priv->width + 1) / 2 * 2,
+      (priv->height + 1) / 2,
+      COGL_PIXEL_FORMAT_G_8,
+      COGL_TEXTURE_NO_SLICING,
+      priv->strides[1],
+      buffer + priv->offsets[1],
+      clutter_helix_video_texture_dirty_map (video_texture, 1));
+
+  clutter_helix_video_texture_show_plane (video_texture, replaced,
+                                          priv->width, priv->height);
+}
+
+static ClutterHelixRenderer nv12_glsl_renderer =
+{
+  "NV12 glsl",
+  CLUTTER_HELIX_NV12,
+  CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE,
+  clutter_helix_nv12_glsl_init,
+  clutter_helix_yv12_glsl_deinit,
+  clutter_helix_nv12_upload,
+};
+#endif
+
+/*
+ * YUY2 / UYVY
+ *
+ * 8 bit packed 4:2:2, Y0 U Y1 V and U Y0 V Y1 respectively. Each pair of
+ * pixels is uploaded as one RGBA texel and unpacked by the shader, that's
+ * half the bytes of RGB32.
+ */
+
+#if defined (CID_YUY2) || defined (CID_UYVY)
+static void
+clutter_helix_packed_422_glsl_paint (ClutterHelixVideoTexture *video_texture,
+                                     void                     *dummy)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  /* bind the shader */
+  cogl_program_use (priv->program);
+  clutter_helix_video_texture_color_uniforms (video_texture);
+  /* the width covered by the texels */
+  cogl_program_uniform_1f (priv->width_location, priv->cap_width);
+}
+
+static void
+clutter_helix_packed_422_glsl_post_paint (ClutterHelixVideoTexture *video_texture,
+                                          void                     *dummy)
+{
+  /* disable the shader */
+  cogl_program_use (COGL_INVALID_HANDLE);
+}
+
+static void
+clutter_helix_packed_422_glsl_init (ClutterHelixVideoTexture *video_texture,
+                                    gchar                   **shader_srcs)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  GLint location;
+
+  clutter_helix_video_sink_set_yuv_shader (video_texture, shader_srcs,
+                                           N_COLOR_VARIANTS);
+
+  cogl_program_use (priv->program);
+  location = cogl_program_get_uniform_location (priv->program, "tex");
+  cogl_program_uniform_1i (location, 0);
+  priv->width_location =
+    cogl_program_get_uniform_location (priv->program, "width");
+  cogl_program_use (COGL_INVALID_HANDLE);
+
+  _renderer_connect_signals (video_texture,
+                             clutter_helix_packed_422_glsl_paint,
+                             clutter_helix_packed_422_glsl_post_paint);
+}
+
+static void
+clutter_helix_packed_422_upload (ClutterHelixVideoTexture *video_texture,
+                                 guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint texels = (priv->width + 1) / 2;
+  gboolean replaced;
+
+  replaced = clutter_helix_upload_plane (&priv->y_tex,
+      priv->cap_width / 2,
+      priv->cap_height,
+      texels,
+      priv->height,
+      COGL_PIXEL_FORMAT_RGBA_8888,
+      COGL_TEXTURE_NO_SLICING,
+      priv->strides[0],
+      buffer,
+      clutter_helix_video_texture_dirty_map (video_texture, 0));
+
+  clutter_helix_video_texture_show_plane (video_texture, replaced,
+                                          texels, priv->height);
+}
+#endif
+
+#ifdef CID_YUY2
+static gchar *yuy2_to_rgba_shaders[] =
+{
+  PACKED_422_TO_RGBA_SHADER ("r", "g", "b", "a",
+                             YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  PACKED_422_TO_RGBA_SHADER ("r", "g", "b", "a",
+                             YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB)
+};
+
+static void
+clutter_helix_yuy2_glsl_init (ClutterHelixVideoTexture *video_texture)
+{
+  clutter_helix_packed_422_glsl_init (video_texture, yuy2_to_rgba_shaders);
+}
+
+static ClutterHelixRenderer yuy2_glsl_renderer =
+{
+  "YUY2 glsl",
+  CLUTTER_HELIX_YUY2,
+  CLUTTER_HELIX_GLSL,
+  clutter_helix_yuy2_glsl_init,
+  clutter_helix_yv12_glsl_deinit,
+  clutter_helix_packed_422_upload,
+};
+#endif
+
+#ifdef CID_UYVY
+static gchar *uyvy_to_rgba_shaders[] =
+{
+  PACKED_422_TO_RGBA_SHADER ("g", "r", "a", "b",
+                             YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  PACKED_422_TO_RGBA_SHADER ("g", "r", "a", "b",
+                             YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB)
+};
+
+static void
+clutter_helix_uyvy_glsl_init (ClutterHelixVideoTexture *video_texture)
+{
+  clutter_helix_packed_422_glsl_init (video_texture, uyvy_to_rgba_shaders);
+}
+
+static ClutterHelixRenderer uyvy_glsl_renderer =
+{
+  "UYVY glsl",
+  CLUTTER_HELIX_UYVY,
+  CLUTTER_HELIX_GLSL,
+  clutter_helix_uyvy_glsl_init,
+  clutter_helix_yv12_glsl_deinit,
+  clutter_helix_packed_422_upload,
+};
+#endif
+
+/*
+ * YUVA
+ *
+ * I420 followed by a full resolution 8 bit plane of straight alpha, in a
+ * fourth layer. The shader premultiplies, so that the frame composites over
+ * what's behind the actor, with its opacity on top.
+ */
+
+#ifdef CID_YUVA
+/* by color variant */
+static gchar *yuva_to_rgba_shaders[] =
+{
+  YUVA_TO_RGBA_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  YUVA_TO_RGBA_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB)
+};
+
+static void
+clutter_helix_yuva_glsl_paint (ClutterHelixVideoTexture *video_texture,
+                               void                     *dummy)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle material;
+
+  clutter_helix_yv12_glsl_paint (video_texture, dummy);
+
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+  if (priv->a_tex)
+    cogl_material_set_layer (material, 3, priv->a_tex);
+}
+
+static void
+clutter_helix_yuva_glsl_post_paint (ClutterHelixVideoTexture *video_texture,
+                                    void                     *dummy)
+{
+  CoglHandle material;
+
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+  cogl_material_remove_layer (material, 3);
+
+  clutter_helix_yv12_glsl_post_paint (video_texture, dummy);
+}
+
+static void
+clutter_helix_yuva_glsl_init (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  GLint location;
+
+  clutter_helix_video_sink_set_yuv_shader (video_texture, yuva_to_rgba_shaders,
+                                           G_N_ELEMENTS (yuva_to_rgba_shaders));
+
+  cogl_program_use (priv->program);
+  location = cogl_program_get_uniform_location (priv->program, "ytex");
+  cogl_program_uniform_1i (location, 0);
+  location = cogl_program_get_uniform_location (priv->program, "vtex");
+  cogl_program_uniform_1i (location, 1);
+  location = cogl_program_get_uniform_location (priv->program, "utex");
+  cogl_program_uniform_1i (location, 2);
+  location = cogl_program_get_uniform_location (priv->program, "atex");
+  cogl_program_uniform_1i (location, 3);
+  cogl_program_use (COGL_INVALID_HANDLE);
+
+  _renderer_connect_signals (video_texture,
+                             clutter_helix_yuva_glsl_paint,
+                             clutter_helix_yuva_glsl_post_paint);
+}
+
+static void
+clutter_helix_yuva_upload (ClutterHelixVideoTexture *video_texture,
+                           guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  /* tiles have no alpha layer, the frame would paint opaque. Frames get
+   * halved to fit, see clutter_helix_video_texture_fit_shift(), unless
+   * that's not enough */
+  if (clutter_helix_video_texture_needs_tiles (video_texture))
+    {
+      if (!priv->too_large)
+        g_warning ("YUVA frames of %ux%u are too large for the textures",
+                   priv->width, priv->height);
+      priv->too_large = TRUE;
+
+      g_mutex_lock (priv->id_lock);
+      priv->skipped_uploads++;
+      g_mutex_unlock (priv->id_lock);
+      return;
+    }
+
+  /* an alpha format, so that Cogl turns blending on for the material */
+  clutter_helix_upload_plane (&priv->a_tex,
+      priv->cap_width,
+      priv->cap_height,
+      priv->width,
+      priv->height,
+      COGL_PIXEL_FORMAT_A_8,
+      COGL_TEXTURE_NO_SLICING,
+      priv->strides[3],
+      buffer + priv->offsets[3],
+      clutter_helix_video_texture_dirty_map (video_texture, 3));
+
+  clutter_helix_yv12_upload (video_texture, buffer);
+}
+
+static ClutterHelixRenderer yuva_glsl_renderer =
+{
+  "YUVA glsl",
+  CLUTTER_HELIX_YUVA,
+  CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE_4,
+  clutter_helix_yuva_glsl_init,
+  clutter_helix_yv12_glsl_deinit,
+  clutter_helix_yuva_upload,
+};
+#endif
+
+/*
+ * Core renderers
+ *
+ * The planar and semi-planar renderers again, written for GLES2 and GLSL
+ * 1.30 without the fixed function built-ins: the frame is drawn by a program
+ * of our own, see clutter-helix-core-program.c, instead of the material of
+ * the actor with a Cogl program on top. The uploads are the ones of the GLSL renderers.
+ * Progressive only, the GLSL renderers take over while deinterlacing.
+ */
+
+/* by color variant */
+static gchar *yv12_to_rgba_core_shaders[] =
+{
+  YV12_TO_RGBA_CORE_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  YV12_TO_RGBA_CORE_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB)
+};
+
+/* by texture unit, the planes go to the same units as the material layers */
+static const gchar *yv12_core_samplers[] = { "ytex", "vtex", "utex" };
+
+/* Makes the variant of @shader_srcs the color settings need the program
+ * painting the frames. @shader_srcs are by color variant. */
+static void
+clutter_helix_video_texture_set_core_program (ClutterHelixVideoTexture *video_texture,
+                                              gchar                   **shader_srcs,
+                                              const gchar * const      *samplers,
+                                              guint                     n_samplers)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixCoreProgram *program;
+  gint variant;
+
+  /* nothing of the Cogl GLSL path */
+  clutter_helix_video_sink_set_glsl_shader (video_texture, NULL);
+  _renderer_disconnect_signals (video_texture);
+
+  variant = clutter_helix_video_texture_color_variant (video_texture);
+
+  program = g_hash_table_lookup (priv->core_programs, shader_srcs[variant]);
+  if (program == NULL)
+    {
+      program = clutter_helix_core_program_new (shader_srcs[variant],
+                                                samplers, n_samplers);
+      if (program == NULL)
+        {
+          priv->core_program = NULL;
+          return;
+        }
+      g_hash_table_insert (priv->core_programs, shader_srcs[variant], program);
+    }
+
+  priv->core_program  = program;
+  priv->color_variant = variant;
+
+  if (variant == COLOR_VARIANT_MATRIX)
+    {
+      priv->color_matrix_location =
+        clutter_helix_core_program_get_uniform (program, "color_matrix");
+      priv->color_offset_location =
+        clutter_helix_core_program_get_uniform (program, "color_offset");
+    }
+}
+
+/* between clutter_helix_core_program_begin() and _end() */
+static void
+clutter_helix_video_texture_core_color_uniforms (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (priv->color_variant != COLOR_VARIANT_MATRIX)
+    return;
+
+  clutter_helix_core_program_uniform (priv->core_program,
+                                      priv->color_matrix_location,
+                                      9, priv->color_values);
+  clutter_helix_core_program_uniform (priv->core_program,
+                                      priv->color_offset_location,
+                                      3, priv->color_values + 9);
+}
+
+static void
+clutter_helix_core_deinit (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  priv->core_program  = NULL;
+  priv->color_variant = -1;
+}
+
+static void
+clutter_helix_yv12_core_init (ClutterHelixVideoTexture *video_texture)
+{
+  clutter_helix_video_texture_set_core_program (video_texture,
+                                                yv12_to_rgba_core_shaders,
+                                                yv12_core_samplers,
+                                                G_N_ELEMENTS (yv12_core_samplers));
+}
+
+static void
+clutter_helix_yv12_core_paint (ClutterHelixVideoTexture *video_texture,
+                               gfloat                    x_1,
+                               gfloat                    y_1,
+                               gfloat                    x_2,
+                               gfloat                    y_2,
+                               guint8                    opacity)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle planes[] = { priv->y_tex, priv->u_tex, priv->v_tex };
+  gfloat coords[8];
+  guint i;
+
+  if (priv->core_program == NULL)
+    return;
+
+  /* draw the primitives Cogl has batched before we change the GL state under
+   * it, as the fp renderers do */
+  cogl_flush ();
+
+  clutter_helix_core_program_begin (priv->core_program);
+  clutter_helix_video_texture_core_color_uniforms (video_texture);
+
+  if (priv->tiles)
+    {
+      for (i = 0; i < priv->n_tiles; i++)
+        if (clutter_helix_video_texture_tile_coords (video_texture,
+                                                     &priv->tiles[i],
+                                                     x_1, y_1, x_2, y_2,
+                                                     coords))
+          clutter_helix_core_program_draw (priv->core_program,
+                                           priv->tiles[i].planes,
+                                           coords[0], coords[1],
+                                           coords[2], coords[3],
+                                           coords[4], coords[5],
+                                           coords[6], coords[7],
+                                           opacity);
+    }
+  else
+    clutter_helix_core_program_draw (priv->core_program, planes,
+                                     x_1, y_1, x_2, y_2,
+                                     0, 0, priv->tex_s, priv->tex_t,
+                                     opacity);
+
+  clutter_helix_core_program_end (priv->core_program);
+}
+
+static ClutterHelixRenderer i420_core_renderer =
+{
+  "I420 core",
+  CLUTTER_HELIX_I420,
+  CLUTTER_HELIX_GL_CORE | CLUTTER_HELIX_MULTI_TEXTURE,
+  clutter_helix_yv12_core_init,
+  clutter_helix_core_deinit,
+  clutter_helix_yv12_upload,
+  clutter_helix_yv12_core_paint,
+};
+
+#ifdef CID_NV12
+/* by color variant */
+static gchar *nv12_to_rgba_core_shaders[] =
+{
+  NV12_TO_RGBA_CORE_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  NV12_TO_RGBA_CORE_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB)
+};
+
+static const gchar *nv12_core_samplers[] = { "ytex", "uvtex" };
+
+static void
+clutter_helix_nv12_core_init (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  clutter_helix_video_texture_set_core_program (video_texture,
+                                                nv12_to_rgba_core_shaders,
+                                                nv12_core_samplers,
+                                                G_N_ELEMENTS (nv12_core_samplers));
+  if (priv->core_program)
+    priv->chroma_width_location =
+      clutter_helix_core_program_get_uniform (priv->core_program,
+                                              "chroma_width");
+}
+
+static void
+clutter_helix_nv12_core_paint (ClutterHelixVideoTexture *video_texture,
+                               gfloat                    x_1,
+                               gfloat                    y_1,
+                               gfloat                    x_2,
+                               gfloat                    y_2,
+                               guint8                    opacity)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle planes[] = { priv->y_tex, priv->u_tex };
+  gfloat chroma_width = priv->cap_width / 2;
+
+  if (priv->core_program == NULL)
+    return;
+
+  /* draw the primitives Cogl has batched before we change the GL state under
+   * it, as the fp renderers do */
+  cogl_flush ();
+
+  clutter_helix_core_program_begin (priv->core_program);
+  clutter_helix_video_texture_core_color_uniforms (video_texture);
+  clutter_helix_core_program_uniform (priv->core_program,
+                                      priv->chroma_width_location,
+                                      1, &chroma_width);
+  clutter_helix_core_program_draw (priv->core_program, planes,
+                                   x_1, y_1, x_2, y_2,
+                                   0, 0, priv->tex_s, priv->tex_t,
+                                   opacity);
+  clutter_helix_core_program_end (priv->core_program);
+}
+
+static ClutterHelixRenderer nv12_core_renderer =
+{
+  "NV12 core",
+  CLUTTER_HELIX_NV12,
+  CLUTTER_HELIX_GL_CORE | CLUTTER_HELIX_MULTI_TEXTURE,
+  clutter_helix_nv12_core_init,
+  clutter_helix_core_deinit,
+  clutter_helix_nv12_upload,
+  clutter_helix_nv12_core_paint,
+};
+#endif
+
+/*
+ * I420 10 bit
+ *
+ * I420 with each sample in the low 10 bits of a 16 bit word. The planes go
+ * to 16 bit textures where GL has them, the shader scales the samples back.
+ * Otherwise they get narrowed to 8 bit on the CPU and take the I420 path.
+ */
+
+#ifdef CID_I420_10
+#define I420_10_DEPTH 10
+
+static void
+clutter_helix_i420_10_narrow_upload (ClutterHelixVideoTexture *video_texture,
+                                     guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint strides[MAX_PLANES], offsets[MAX_PLANES], i;
+  guchar *narrow;
+  gsize n_samples;
+
+  /* narrowing the whole buffer keeps the layout, at half the byte counts */
+  n_samples = (priv->offsets[2] + priv->strides[2] * ((priv->height + 1) / 2)) / 2;
+  narrow = g_malloc (n_samples);
+  clutter_helix_narrow_plane ((const guint16 *) buffer, n_samples,
+                              I420_10_DEPTH, narrow);
+
+  memcpy (strides, priv->strides, sizeof (strides));
+  memcpy (offsets, priv->offsets, sizeof (offsets));
+  for (i = 0; i < 3; i++)
+    {
+      priv->strides[i] /= 2;
+      priv->offsets[i] /= 2;
+    }
+
+  clutter_helix_yv12_upload (video_texture, narrow);
+
+  memcpy (priv->strides, strides, sizeof (strides));
+  memcpy (priv->offsets, offsets, sizeof (offsets));
+  g_free (narrow);
+}
+
+static ClutterHelixRenderer i420_10_narrow_renderer =
+{
+  "I420 10 bit glsl (8 bit textures)",
+  CLUTTER_HELIX_I420_10,
+  CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE,
+  clutter_helix_i420_glsl_init,
+  clutter_helix_yv12_glsl_deinit,
+  clutter_helix_i420_10_narrow_upload,
+};
+
+#ifdef CLUTTER_COGL_HAS_GL
+static gchar *yv12_16_to_rgba_shaders[] =
+{
+  YV12_16_TO_RGBA_SHADER (YUV_FIXED_VARS, YUV_FIXED_TO_RGB),
+  YV12_16_TO_RGBA_SHADER (YUV_MATRIX_VARS, YUV_MATRIX_TO_RGB)
+};
+
+/* Cogl has no 16 bit format, the textures are made with GL and wrapped. The
+ * GL names are reused from frame to frame and deleted by the deinit. Same as
+ * clutter_helix_upload_plane() otherwise. Cogl keeps track of the texture
+ * bound and of the unpack alignment, both are put back as they were. */
+static gboolean
+clutter_helix_upload_plane_16 (CoglHandle   *tex,
+                               GLuint       *name,
+                               guint         cap_width,
+                               guint         cap_height,
+                               guint         width,
+                               guint         height,
+                               guint         stride,
+                               const guchar *data)
+{
+  GLint bound, alignment, row_length;
+  gboolean replace;
+
+  replace = *tex == COGL_INVALID_HANDLE ||
+            cogl_texture_get_width (*tex) != cap_width ||
+            cogl_texture_get_height (*tex) != cap_height;
+
+  glGetIntegerv (GL_TEXTURE_BINDING_2D, &bound);
+  glGetIntegerv (GL_UNPACK_ALIGNMENT, &alignment);
+  glGetIntegerv (GL_UNPACK_ROW_LENGTH, &row_length);
+
+  if (*name == 0)
+    glGenTextures (1, name);
+
+  glBindTexture (GL_TEXTURE_2D, *name);
+  if (replace)
+    {
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexImage2D (GL_TEXTURE_2D, 0, GL_LUMINANCE16, cap_width, cap_height, 0,
+                    GL_LUMINANCE, GL_UNSIGNED_SHORT, NULL);
+    }
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 2);
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, stride / 2);
+  glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, width, height,
+                   GL_LUMINANCE, GL_UNSIGNED_SHORT, data);
+
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, row_length);
+  glPixelStorei (GL_UNPACK_ALIGNMENT, alignment);
+  glBindTexture (GL_TEXTURE_2D, bound);
+
+  if (replace)
+    {
+      if (*tex)
+        cogl_texture_unref (*tex);
+      *tex = cogl_texture_new_from_foreign (*name, GL_TEXTURE_2D,
+                                            cap_width, cap_height,
+                                            0, 0, COGL_PIXEL_FORMAT_G_8);
+    }
+
+  return replace;
+}
+
+static void
+clutter_helix_i420_16_glsl_init (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  GLint location;
+
+  clutter_helix_video_sink_set_yuv_shader (video_texture,
+                                           yv12_16_to_rgba_shaders,
+                                           G_N_ELEMENTS (yv12_16_to_rgba_shaders));
+
+  cogl_program_use (priv->program);
+  location = cogl_program_get_uniform_location (priv->program, "ytex");
+  cogl_program_uniform_1i (location, 0);
+  location = cogl_program_get_uniform_location (priv->program, "vtex");
+  cogl_program_uniform_1i (location, 1);
+  location = cogl_program_get_uniform_location (priv->program, "utex");
+  cogl_program_uniform_1i (location, 2);
+  location = cogl_program_get_uniform_location (priv->program, "scale");
+  cogl_program_uniform_1f (location, 65535.0 / ((1 << I420_10_DEPTH) - 1));
+  cogl_program_use (COGL_INVALID_HANDLE);
+
+  _renderer_connect_signals (video_texture,
+                             clutter_helix_yv12_glsl_paint,
+                             clutter_helix_yv12_glsl_post_paint);
+}
+
+static void
+clutter_helix_i420_16_glsl_deinit (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  clutter_helix_video_sink_set_glsl_shader (video_texture, NULL);
+
+  glDeleteTextures (G_N_ELEMENTS (priv->gl_textures), priv->gl_textures);
+  memset (priv->gl_textures, 0, sizeof (priv->gl_textures));
+  clutter_helix_video_texture_drop_planes (video_texture);
+}
+
+static void
+clutter_helix_i420_16_upload (ClutterHelixVideoTexture *video_texture,
+                              guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint cw = (priv->width + 1) / 2, ch = (priv->height + 1) / 2;
+  gboolean replaced;
+
+  replaced = clutter_helix_upload_plane_16 (&priv->y_tex,
+                                            &priv->gl_textures[0],
+                                            priv->cap_width, priv->cap_height,
+                                            priv->width, priv->height,
+                                            priv->strides[0],
+                                            buffer + priv->offsets[0]);
+  clutter_helix_upload_plane_16 (&priv->v_tex, &priv->gl_textures[1],
+                                 priv->cap_width / 2, priv->cap_height / 2,
+                                 cw, ch,
+                                 priv->strides[1],
+                                 buffer + priv->offsets[1]);
+  clutter_helix_upload_plane_16 (&priv->u_tex, &priv->gl_textures[2],
+                                 priv->cap_width / 2, priv->cap_height / 2,
+                                 cw, ch,
+                                 priv->strides[2],
+                                 buffer + priv->offsets[2]);
+
+  clutter_helix_video_texture_show_plane (video_texture, replaced,
+                                          priv->width, priv->height);
+}
+
+static ClutterHelixRenderer i420_16_glsl_renderer =
+{
+  "I420 10 bit glsl",
+  CLUTTER_HELIX_I420_10,
+  CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE | CLUTTER_HELIX_TEXTURE_16,
+  clutter_helix_i420_16_glsl_init,
+  clutter_helix_i420_16_glsl_deinit,
+  clutter_helix_i420_16_upload,
+};
+#endif
+#endif
+
+/*
+ * I420 (atlas version)
+ *
+ * The planes go to a slot of the atlas shared by the small streams, see
+ * clutter-helix-atlas.c. The slot is picked by
+ * clutter_helix_video_texture_choose_atlas() and painting goes through
+ * clutter_helix_atlas_slot_paint(), not through the texture of the actor.
+ */
+
+static void
+clutter_helix_i420_atlas_deinit (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  clutter_helix_atlas_slot_free (priv->atlas_slot);
+  priv->atlas_slot = NULL;
+}
+
+static void
+clutter_helix_i420_atlas_upload (ClutterHelixVideoTexture *video_texture,
+                                 guchar                    *buffer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  clutter_helix_atlas_slot_upload (priv->atlas_slot, buffer,
+                                   priv->strides, priv->offsets);
+
+  /* what clutter_texture_set_cogl_texture() does for the other renderers */
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (video_texture));
+  g_signal_emit_by_name (video_texture, "pixbuf-change");
+}
+
+static ClutterHelixRenderer i420_atlas_renderer =
+{
+  "I420 atlas",
+  CLUTTER_HELIX_I420,
+  CLUTTER_HELIX_GLSL | CLUTTER_HELIX_MULTI_TEXTURE,
+  clutter_helix_dummy_init,
+  clutter_helix_i420_atlas_deinit,
+  clutter_helix_i420_atlas_upload,
+};
+
+/* Switches between the atlas and the renderers of its own, for the
+ * priv->width x priv->height frame about to be uploaded */
+static void
+clutter_helix_video_texture_choose_atlas (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixRenderer *renderer = priv->renderer;
+  gboolean want_atlas;
+  guint width, height;
+
+  want_atlas = priv->use_atlas &&
+               renderer->format == CLUTTER_HELIX_I420 &&
+               clutter_helix_video_texture_color_variant (video_texture) ==
+                 COLOR_VARIANT_FIXED &&
+               priv->deinterlace == CLUTTER_HELIX_DEINTERLACE_NONE &&
+               clutter_helix_atlas_accepts (priv->atlas_features,
+                                            priv->width, priv->height);
+
+  if (want_atlas && priv->atlas_slot)
+    {
+      clutter_helix_atlas_slot_get_size (priv->atlas_slot, &width, &height);
+      if (width != priv->width || height != priv->height)
+        {
+          clutter_helix_atlas_slot_free (priv->atlas_slot);
+          priv->atlas_slot = NULL;
+        }
+    }
+
+  if (want_atlas && priv->atlas_slot == NULL)
+    {
+      priv->atlas_slot = clutter_helix_atlas_slot_new (priv->width,
+                                                       priv->height);
+      /* full, fall back to textures of our own */
+      if (priv->atlas_slot == NULL)
+        want_atlas = FALSE;
+    }
+
+  if (!want_atlas && priv->atlas_slot)
+    {
+      clutter_helix_atlas_slot_free (priv->atlas_slot);
+      priv->atlas_slot = NULL;
+    }
+
+  /* the color settings may want another renderer too */
+  if (want_atlas)
+    renderer = &i420_atlas_renderer;
+  else
+    renderer = clutter_helix_find_renderer_by_format (video_texture,
+                                                      renderer->format);
+
+  if (renderer == priv->renderer)
+    return;
+
+  if (priv->renderer_state != CLUTTER_HELIX_RENDERER_STOPPED)
+    {
+      priv->renderer->deinit (video_texture);
+      _renderer_disconnect_signals (video_texture);
+    }
+  clutter_helix_video_texture_drop_planes (video_texture);
+  priv->renderer       = renderer;
+  priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+}
+
+
+
+/*
+ * Clones
+ *
+ * ClutterHelixVideoClone paints the textures and shader of its source
+ * through clutter_helix_video_texture_paint_frame(), nothing gets decoded or
+ * uploaded twice.
+ */
+
+void
+clutter_helix_video_texture_paint_frame (ClutterHelixVideoTexture *video_texture,
+                                         gfloat                    x_1,
+                                         gfloat                    y_1,
+                                         gfloat                    x_2,
+                                         gfloat                    y_2,
+                                         guint8                    opacity)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle material;
+
+  if (priv->renderer_state != CLUTTER_HELIX_RENDERER_RUNNING)
+    return;
+
+  if (priv->atlas_slot)
+    {
+      clutter_helix_atlas_slot_paint (priv->atlas_slot,
+                                      x_1, y_1, x_2, y_2, opacity);
+      return;
+    }
+
+  if (priv->renderer->paint)
+    {
+      priv->renderer->paint (video_texture, x_1, y_1, x_2, y_2, opacity);
+      return;
+    }
+
+  if (clutter_helix_video_texture_convert_rgba (video_texture))
+    {
+      clutter_helix_video_texture_paint_rgba (video_texture,
+                                              x_1, y_1, x_2, y_2, opacity);
+      return;
+    }
+
+  material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (video_texture));
+  if (material == COGL_INVALID_HANDLE)
+    return;
+
+  if (priv->paint_func)
+    priv->paint_func (video_texture, NULL);
+
+  cogl_material_set_color4ub (material, opacity, opacity, opacity, opacity);
+  if (priv->tiles)
+    clutter_helix_video_texture_paint_tiles (video_texture, material,
+                                             x_1, y_1, x_2, y_2);
+  else
+    {
+      cogl_set_source (material);
+      cogl_rectangle_with_texture_coords (x_1, y_1, x_2, y_2,
+                                          0, 0, priv->tex_s, priv->tex_t);
+    }
+
+  if (priv->post_paint_func)
+    priv->post_paint_func (video_texture, NULL);
+}
+
+void
+clutter_helix_video_texture_add_clone (ClutterHelixVideoTexture *video_texture,
+                                       ClutterActor             *clone)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  priv->clones = g_slist_prepend (priv->clones, clone);
+}
+
+void
+clutter_helix_video_texture_remove_clone (ClutterHelixVideoTexture *video_texture,
+                                          ClutterActor             *clone)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  priv->clones = g_slist_remove (priv->clones, clone);
+}
+
+#define TICK_TIMEOUT 0.5
+
+static void clutter_media_init (ClutterMediaIface *iface);
+
+static gboolean tick_timeout (ClutterHelixVideoTexture *video_texture);
+
+static gboolean clutter_helix_video_render_idle_func (gpointer data);
+static void clutter_helix_video_texture_paint (ClutterActor *actor);
+static guint clutter_helix_video_texture_display_shift (ClutterHelixVideoTexture *video_texture);
+static void clutter_helix_video_texture_choose_atlas (ClutterHelixVideoTexture *video_texture);
+static void clutter_helix_video_texture_get_preferred_width (ClutterActor *actor,
+                                                             gfloat        for_height,
+                                                             gfloat       *min_width_p,
+                                                             gfloat       *natural_width_p);
+static void clutter_helix_video_texture_get_preferred_height (ClutterActor *actor,
+                                                              gfloat        for_width,
+                                                              gfloat       *min_height_p,
+                                                              gfloat       *natural_height_p);
+
+static gboolean
+clutter_helix_video_texture_upload_frame (ClutterHelixVideoTexture *video_texture,
+                                          ClutterHelixFrame        *frame);
+
+static void
+clutter_helix_video_texture_clear_head (ClutterHelixVideoTexture *video_texture);
+
+static void
+clutter_helix_video_texture_cancel_step (ClutterHelixVideoTexture *video_texture);
+
+static void
+clutter_helix_video_texture_start_trick (ClutterHelixVideoTexture *video_texture);
+
+static void
+clutter_helix_video_texture_stop_trick (ClutterHelixVideoTexture *video_texture);
+
+static void
+set_upload_thread (ClutterHelixVideoTexture *video_texture,
+                   gboolean                  upload_thread);
+
+
+G_DEFINE_TYPE_WITH_CODE (ClutterHelixVideoTexture,
+                         clutter_helix_video_texture,
+                         CLUTTER_TYPE_TEXTURE,
+                         G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_MEDIA,
+                                                clutter_media_init));
+
+static void on_buffering_cb (unsigned int   flags,
+                             unsigned short percentage,
+			                       void          *context);
+
+static void on_pos_length_cb (unsigned int pos,
+                              unsigned int ulLength, 
+                              void        *context);
+
+static void on_state_change_cb (unsigned short old_state, 
+                                unsigned short new_state, 
+                                void          *context);
+
+static void on_new_frame_cb (unsigned char *p, 
+			                       unsigned int   size, 
+			                       PlayerImgInfo *Info, 
+			                       void          *context);
+
+static void on_error_cb (unsigned long code,
+                         char         *message,
+                         void         *context);
+
+static gboolean get_playing (ClutterMedia *media);
+
+static void set_playing (ClutterMedia *media,
+                         gboolean      playing);
+
+/* Drops what was kept about the current item: cached head and step frames,
+ * the hidden frame and the stepping state */
+static void
+clutter_helix_video_texture_forget_item (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  clutter_helix_video_texture_clear_head (video_texture);
+  clutter_helix_video_texture_cancel_step (video_texture);
+  clutter_helix_frame_cache_clear (priv->step_cache);
+  g_mutex_lock (priv->id_lock);
+  clutter_helix_frame_free (priv->hidden_frame);
+  priv->hidden_frame = NULL;
+  g_mutex_unlock (priv->id_lock);
+  priv->shown_timestamp = 0;
+  priv->stepped = FALSE;
+}
+
+static void
+clutter_helix_video_texture_open_player (ClutterHelixVideoTexture *video_texture,
+                                         ClutterHelixPlayerSlot   *slot)
+{
+  PlayerCallbacks callbacks = 
+  {
+    on_pos_length_cb,
+    on_buffering_cb,
+    on_state_change_cb,
+    on_new_frame_cb,
+    on_error_cb
+  };
+
+  slot->owner  = video_texture;
+  slot->failed = FALSE;
+  get_player (&slot->player, &callbacks, (void *)slot);
+}
+
+/* Interface implementation */
+static void
+set_uri (ClutterMedia    *media,
+         const char      *uri)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE(media);
+  ClutterHelixVideoTexturePrivate *priv; 
+  gboolean is_playing = FALSE;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return;
+
+  if (priv->uri)
+    {
+      is_playing = get_playing (media);
+      clutter_helix_video_texture_stop_trick (video_texture);
+      player_stop (priv->player);
+      g_free (priv->uri);
+    }
+
+  clutter_helix_video_texture_forget_item (video_texture);
+
+  if (uri) 
+    {
+      priv->uri = g_strdup (uri);
+    
+      /**
+       * Ensure the tick timeout is installed.
+       * 
+       * We also have it installed in PAUSED state, because
+       * seeks etc may have a delayed effect on the position.
+       **/
+      if (priv->tick_timeout_id == 0)
+        {
+          priv->tick_timeout_id = g_timeout_add (TICK_TIMEOUT * 1000,
+						 (GSourceFunc) tick_timeout,
+						 video_texture);
+        }
+      player_openurl (priv->player, priv->uri);
+      if (is_playing && priv->rate != 1.0)
+        clutter_helix_video_texture_start_trick (video_texture);
+      else if (is_playing)
+        player_begin (priv->player);
+    } 
+  else 
+    {
+      priv->uri = NULL;
+    
+      if (priv->tick_timeout_id > 0) 
+	      {
+	        g_source_remove (priv->tick_timeout_id);
+	        priv->tick_timeout_id = 0;
+	      }
+    }
+  
+  priv->can_seek = FALSE;
+  priv->duration = 0;
+
+  
+  /*
+   * Emit notififications for all these to make sure UI is not showing
+   * any properties of the old URI.
+   */
+  g_object_notify (G_OBJECT (video_texture), "uri");
+  g_object_notify (G_OBJECT (video_texture), "can-seek");
+  g_object_notify (G_OBJECT (video_texture), "duration");
+  g_object_notify (G_OBJECT (video_texture), "progress");
+}
+
+static const char *
+get_uri (ClutterMedia *media)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv; 
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), NULL);
+
+  priv = video_texture->priv;
+
+  return priv->uri;
+}
+
+/*
+ * Gapless playback
+ *
+ * The next item of a playlist is opened on a second player while the current
+ * one plays. Once it has decoded its first frame that player is parked
+ * (paused and rewound) and the frame is kept aside. At the end of the current
+ * item the players are swapped: the prerolled one resumes and its first frame
+ * replaces the last frame of the previous item straight away. The same frame
+ * decoded again after the rewind is dropped, see loop_shown.
+ */
+
+static void
+clutter_helix_video_texture_cancel_preroll (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *frame;
+
+  if (priv->next_uri && priv->preroll->player)
+    player_stop (priv->preroll->player);
+
+  g_mutex_lock (priv->id_lock);
+  if (priv->preroll_id > 0)
+    {
+      g_source_remove (priv->preroll_id);
+      priv->preroll_id = 0;
+    }
+  frame = priv->next_frame;
+  priv->next_frame = NULL;
+  g_mutex_unlock (priv->id_lock);
+
+  clutter_helix_frame_free (frame);
+
+  g_free (priv->next_uri);
+  priv->next_uri = NULL;
+}
+
+static gboolean
+preroll_pause_idle_func (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  g_mutex_lock (priv->id_lock);
+  priv->preroll_id = 0;
+  g_mutex_unlock (priv->id_lock);
+
+  if (priv->next_uri && priv->preroll->player)
+    {
+      player_pause (priv->preroll->player);
+      player_seek (priv->preroll->player, 0);
+    }
+
+  return FALSE;
+}
+
+static void
+set_next_uri (ClutterHelixVideoTexture *video_texture,
+              const char               *uri)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixPlayerSlot *slot;
+
+  if (!priv->player)
+    return;
+
+  clutter_helix_video_texture_cancel_preroll (video_texture);
+
+  slot = priv->preroll;
+  if (uri && slot->player == NULL)
+    clutter_helix_video_texture_open_player (video_texture, slot);
+
+  if (uri && slot->player)
+    {
+      priv->next_uri = g_strdup (uri);
+      slot->failed = FALSE;
+
+      /* Decode silently until the first frame shows up, the player is then
+       * parked by preroll_pause_idle_func() */
+      player_setvolume (slot->player, 0);
+      player_openurl (slot->player, priv->next_uri);
+      player_begin (slot->player);
+    }
+
+  g_object_notify (G_OBJECT (video_texture), "next-uri");
+}
+
+static void
+clutter_helix_video_texture_swap_players (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixPlayerSlot *finished;
+  ClutterHelixFrame *frame;
+  int volume;
+
+  finished = priv->active;
+  volume = player_getvolume (finished->player);
+  player_stop (finished->player);
+
+  clutter_helix_video_texture_forget_item (video_texture);
+
+  g_mutex_lock (priv->id_lock);
+  priv->active  = priv->preroll;
+  priv->preroll = finished;
+  priv->player  = priv->active->player;
+  if (priv->preroll_id > 0)
+    {
+      g_source_remove (priv->preroll_id);
+      priv->preroll_id = 0;
+    }
+  frame = priv->next_frame;
+  priv->next_frame = NULL;
+
+  /* the prerolled frame supersedes anything left from the previous item, the
+   * last uploaded frame stays on screen until it gets uploaded */
+  if (frame)
+    {
+      clutter_helix_frame_free (priv->frame);
+      priv->frame = frame;
+      /* the parked player was rewound, it decodes this frame again */
+      priv->loop_shown   = 1;
+      priv->loop_decoded = 0;
+      if (priv->idle_id == 0)
+        priv->idle_id =
+          clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                         clutter_helix_video_render_idle_func,
+                                         video_texture,
+                                         NULL);
+    }
+  g_mutex_unlock (priv->id_lock);
+
+
+  g_free (priv->uri);
+  priv->uri      = priv->next_uri;
+  priv->next_uri = NULL;
+  priv->can_seek = player_canseek (priv->player);
+  priv->duration = 0;
+
+  player_setvolume (priv->player, volume < 0 ? 0 : volume);
+  player_begin (priv->player);
+
+  g_object_notify (G_OBJECT (video_texture), "uri");
+  g_object_notify (G_OBJECT (video_texture), "next-uri");
+  g_object_notify (G_OBJECT (video_texture), "can-seek");
+  g_object_notify (G_OBJECT (video_texture), "duration");
+  g_object_notify (G_OBJECT (video_texture), "progress");
+}
+
+/*
+ * Seamless looping
+ *
+ * While the stream starts, copies of its first frames are kept (bounded by
+ * loop-cache-frames and loop-cache-size). When the end is reached the decoder
+ * is rewound in the background and the cached frames are played out at the
+ * frame rate. Decoded frame i is dropped if the replay has shown cached frame
+ * i already, otherwise the decoder takes over from there and the replay
+ * stops: the loop boundary neither repeats nor skips a frame, whether the
+ * decoder comes back in a burst or slowly.
+ */
+
+/* Wraps a picture decoded by Helix, with what it doesn't tell about it */
+static ClutterHelixFrame *
+clutter_helix_video_texture_new_frame (ClutterHelixVideoTexture *video_texture,
+                                       guchar                   *data,
+                                       unsigned int              size,
+                                       PlayerImgInfo            *info)
+{
+  ClutterHelixFrame *frame;
+
+  frame = clutter_helix_frame_new (data, size, info->cx, info->cy, info->cid);
+  if (video_texture->priv->bottom_first)
+    frame->flags |= CLUTTER_HELIX_FRAME_BOTTOM_FIRST;
+
+  return frame;
+}
+
+/* Called with priv->id_lock held, from the Helix thread */
+static void
+clutter_helix_video_texture_cache_head (ClutterHelixVideoTexture *video_texture,
+                                        unsigned char            *p,
+                                        unsigned int              size,
+                                        PlayerImgInfo            *info)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guchar *data;
+
+  if (priv->head_frames->length >= priv->loop_cache_frames ||
+      priv->head_bytes + size > priv->loop_cache_size)
+    {
+      priv->head_complete = TRUE;
+      return;
+    }
+
+  data = malloc (size);
+  if (data == NULL)
+    {
+      priv->head_complete = TRUE;
+      return;
+    }
+  memcpy (data, p, size);
+
+  g_queue_push_tail (priv->head_frames,
+                     clutter_helix_video_texture_new_frame (video_texture,
+                                                            data, size, info));
+  priv->head_bytes += size;
+}
+
+static void
+clutter_helix_video_texture_stop_replay (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (priv->replay_id > 0)
+    {
+      g_source_remove (priv->replay_id);
+      priv->replay_id = 0;
+    }
+  priv->replay = NULL;
+}
+
+static void
+clutter_helix_video_texture_clear_head (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *frame;
+
+  clutter_helix_video_texture_stop_replay (video_texture);
+
+  g_mutex_lock (priv->id_lock);
+  while ((frame = g_queue_pop_head (priv->head_frames)))
+    clutter_helix_frame_free (frame);
+  priv->head_bytes    = 0;
+  priv->head_complete = FALSE;
+  priv->loop_shown    = 0;
+  priv->loop_decoded  = 0;
+  g_mutex_unlock (priv->id_lock);
+}
+
+static gboolean
+loop_replay_func (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean caught_up;
+
+  /* the decoder delivered the frame this one is a copy of, it takes over */
+  g_mutex_lock (priv->id_lock);
+  caught_up = priv->loop_decoded > priv->loop_shown;
+  if (!caught_up && priv->replay)
+    priv->loop_shown++;
+  g_mutex_unlock (priv->id_lock);
+
+  if (caught_up || priv->replay == NULL)
+    {
+      priv->replay    = NULL;
+      priv->replay_id = 0;
+      return FALSE;
+    }
+
+  clutter_helix_video_texture_upload_frame (video_texture,
+                                            priv->replay->data);
+  priv->replay = priv->replay->next;
+
+  if (priv->replay == NULL)
+    {
+      priv->replay_id = 0;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+clutter_helix_video_texture_restart_loop (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *stale;
+  guint n_frames;
+
+  clutter_helix_video_texture_stop_replay (video_texture);
+
+  g_mutex_lock (priv->id_lock);
+  n_frames = priv->head_frames->length;
+  priv->head_complete = TRUE;
+  priv->loop_shown    = 0;
+  priv->loop_decoded  = 0;
+  stale = priv->frame;
+  priv->frame = NULL;
+  g_mutex_unlock (priv->id_lock);
+
+  clutter_helix_frame_free (stale);
+
+  player_seek (priv->player, 0);
+  player_begin (priv->player);
+
+  if (n_frames == 0)
+    return;
+
+  /* the rate of the stream, the head frames may have come in a burst */
+  priv->replay = priv->head_frames->head;
+  if (loop_replay_func (video_texture))
+    priv->replay_id = clutter_threads_add_timeout_full (G_PRIORITY_HIGH,
+                                                        MAX (priv->frame_interval, 1),
+                                                        loop_replay_func,
+                                                        video_texture,
+                                                        NULL);
+}
+
+/*
+ * Frame stepping
+ *
+ * Every decoded frame ends up in priv->step_cache once shown (or dropped)
+ * so that steps within the recently decoded window are served from memory.
+ * Stepping out of the window seeks around the target and decodes a run of
+ * STEP_SPAN_FRAMES frames in one go, caching all of them.
+ *
+ * The cache only holds the newest frame until the first step, it grows to
+ * step-cache-size from then on, so that plain playback doesn't pay for it.
+ *
+ * Helix doesn't timestamp frames: they are stamped from the last position it
+ * reported plus the wall clock time elapsed since, and a step moves by the
+ * average frame interval measured that way. Steps are thus approximate, they
+ * may land a frame off when the decoder is late or the frame rate varies.
+ */
+
+/* Called with priv->id_lock held */
+static gint64
+clutter_helix_video_texture_frame_time (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gint64 timestamp, delta;
+
+  timestamp = priv->pos_ms;
+  if (priv->state == PLAYER_STATE_PLAYING || priv->step_end >= 0)
+    timestamp += (clutter_helix_get_time_us () - priv->pos_time) / 1000;
+
+  delta = timestamp - priv->last_timestamp;
+  if (delta > 0 && delta < 500)
+    priv->frame_interval = (3 * priv->frame_interval + delta) / 4;
+  priv->last_timestamp = timestamp;
+
+  return timestamp;
+}
+
+static void
+clutter_helix_video_texture_cancel_step (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  g_mutex_lock (priv->id_lock);
+  priv->step_end = -1;
+  if (priv->step_id > 0)
+    {
+      g_source_remove (priv->step_id);
+      priv->step_id = 0;
+    }
+  g_mutex_unlock (priv->id_lock);
+}
+
+static gboolean
+step_idle_func (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *frame;
+  gboolean done;
+
+  g_mutex_lock (priv->id_lock);
+  priv->step_id = 0;
+  done = (priv->step_end < 0);
+  g_mutex_unlock (priv->id_lock);
+
+  if (done)
+    player_pause (priv->player);
+
+  if (!priv->step_shown)
+    {
+      frame = clutter_helix_frame_cache_step (priv->step_cache,
+                                              priv->step_target,
+                                              0,
+                                              G_MAXINT64);
+      if (frame)
+        {
+          clutter_helix_video_texture_upload_frame (video_texture, frame);
+          clutter_helix_frame_free (frame);
+          priv->step_shown = TRUE;
+        }
+    }
+
+  g_object_notify (G_OBJECT (video_texture), "progress");
+
+  return FALSE;
+}
+
+/* Shows the frame @n_frames frames away from the one displayed, leaving the
+ * player paused. */
+static void
+clutter_helix_video_texture_step_frames (ClutterHelixVideoTexture *video_texture,
+                                         gint                      n_frames)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *frame;
+  gint64 target, span, start;
+
+  clutter_helix_video_texture_cancel_step (video_texture);
+  priv->stepped = TRUE;
+
+  if (!priv->step_cache_used)
+    {
+      priv->step_cache_used = TRUE;
+      clutter_helix_frame_cache_set_max_size (priv->step_cache,
+                                              priv->step_cache_size);
+    }
+
+  frame = clutter_helix_frame_cache_step (priv->step_cache,
+                                          priv->shown_timestamp,
+                                          n_frames,
+                                          priv->frame_interval * 3 / 2 + 1);
+  if (frame)
+    {
+      clutter_helix_video_texture_upload_frame (video_texture, frame);
+      clutter_helix_frame_free (frame);
+      g_object_notify (G_OBJECT (video_texture), "progress");
+      return;
+    }
+
+  /* Out of the cached window. Stepping backward decodes the frames leading
+   * to the target, stepping forward the ones following it. */
+  target = priv->shown_timestamp + (gint64) n_frames * priv->frame_interval;
+  target = MAX (target, 0);
+  span = STEP_SPAN_FRAMES * priv->frame_interval;
+  start = n_frames < 0 ? MAX (target - span, 0) : target;
+
+  g_mutex_lock (priv->id_lock);
+  priv->step_target  = target;
+  priv->step_end     = n_frames < 0 ? target : target + span;
+  priv->step_reached = FALSE;
+  priv->step_shown   = FALSE;
+  priv->pos_ms       = start;
+  priv->pos_time     = clutter_helix_get_time_us ();
+  g_mutex_unlock (priv->id_lock);
+
+  player_seek (priv->player, start);
+  player_begin (priv->player);
+}
+
+/**
+ * clutter_helix_video_texture_step:
+ * @video_texture: a #ClutterHelixVideoTexture
+ * @n_frames: number of frames to step, negative to step backward
+ *
+ * Pauses playback and shows the frame @n_frames frames away from the one
+ * currently displayed. Steps within the recently decoded frames are
+ * immediate, the size of that window is set by
+ * #ClutterHelixVideoTexture:step-cache-size. Stepping further decodes the
+ * frames around the target once, so that the following steps are immediate
+ * too.
+ *
+ * Stepping is approximate: Helix doesn't report frame timestamps, they are
+ * estimated from the playback position and the wall clock, so a step may
+ * land one frame off the exact target.
+ */
+void
+clutter_helix_video_texture_step (ClutterHelixVideoTexture *video_texture,
+                                  gint                      n_frames)
+{
+  ClutterHelixVideoTexturePrivate *priv;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+
+  priv = video_texture->priv;
+
+  if (!priv->player || !priv->uri || n_frames == 0)
+    return;
+
+  if (get_playing (CLUTTER_MEDIA (video_texture)))
+    set_playing (CLUTTER_MEDIA (video_texture), FALSE);
+
+  clutter_helix_video_texture_step_frames (video_texture, n_frames);
+}
+
+/*
+ * Trick play
+ *
+ * Helix only plays at the normal rate, so other rates are driven from here
+ * with the player paused:
+ *
+ *  - below 1x, forward or backward, a timer steps one frame at a time. That
+ *    decodes short runs of frames once and serves the rest from the step
+ *    cache.
+ *  - above 1x, a timer moves a target position along at the requested rate
+ *    and seeks to it, one seek at a time. Only the first frame decoded
+ *    after a seek, the keyframe it landed on, is kept; the following ones
+ *    are dropped in the decoder callback, before they reach the clutter
+ *    thread, and the player is paused again until the next seek.
+ *
+ * The audio is muted meanwhile, unless #ClutterHelixVideoTexture:mute-trick-play
+ * is unset.
+ */
+
+static gboolean
+trick_pause_idle_func (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean pending;
+
+  g_mutex_lock (priv->id_lock);
+  priv->trick_pause_id = 0;
+  pending = priv->trick_pending;
+  g_mutex_unlock (priv->id_lock);
+
+  /* a new seek went out in the meantime, let it decode */
+  if (!pending)
+    player_pause (priv->player);
+
+  return FALSE;
+}
+
+static gboolean
+trick_timeout_func (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gint64 now, end;
+  gboolean pending;
+
+  end = (gint64) priv->duration * 1000;
+
+  if (ABS (priv->rate) < 1.0)
+    {
+      /* let a step that went out of the cache finish decoding, stepping
+       * again would cancel it and start over */
+      g_mutex_lock (priv->id_lock);
+      pending = priv->step_end >= 0 || priv->step_id > 0;
+      g_mutex_unlock (priv->id_lock);
+      if (pending)
+        return TRUE;
+
+      if ((priv->rate < 0 && priv->shown_timestamp <= 0) ||
+          (priv->rate > 0 && end > 0 &&
+           priv->shown_timestamp + priv->frame_interval >= end))
+        goto boundary;
+
+      clutter_helix_video_texture_step_frames (video_texture,
+                                               priv->rate > 0 ? 1 : -1);
+      return TRUE;
+    }
+
+  now = clutter_helix_get_time_us ();
+  priv->trick_pos += priv->rate * (now - priv->trick_time) / 1000;
+  priv->trick_time = now;
+
+  if (priv->trick_pos <= 0 || (end > 0 && priv->trick_pos >= end))
+    goto boundary;
+
+  g_mutex_lock (priv->id_lock);
+  pending = priv->trick_pending &&
+            now - priv->trick_seek_time < TRICK_SEEK_TIMEOUT * 1000;
+  if (!pending)
+    {
+      priv->trick_pending   = TRUE;
+      priv->trick_seek_time = now;
+      priv->pos_ms          = priv->trick_pos;
+      priv->pos_time        = now;
+    }
+  g_mutex_unlock (priv->id_lock);
+
+  if (!pending)
+    {
+      player_seek (priv->player, priv->trick_pos);
+      player_begin (priv->player);
+    }
+
+  return TRUE;
+
+boundary:
+  /* ran into either end of the stream, leaves the last frame shown */
+  priv->trick_id = 0;
+  set_playing (CLUTTER_MEDIA (video_texture), FALSE);
+
+  if (priv->rate > 0)
+    g_signal_emit_by_name (CLUTTER_MEDIA (video_texture), "eos");
+
+  return FALSE;
+}
+
+static void
+clutter_helix_video_texture_start_trick (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gdouble speed = ABS (priv->rate);
+  guint interval;
+
+  clutter_helix_video_texture_cancel_step (video_texture);
+  player_pause (priv->player);
+  priv->stepped = TRUE;
+
+  if (priv->mute_trick_play && priv->trick_volume < 0)
+    {
+      priv->trick_volume = player_getvolume (priv->player);
+      player_setvolume (priv->player, 0);
+    }
+
+  g_mutex_lock (priv->id_lock);
+  priv->trick_fast    = speed > 1.0;
+  priv->trick_pending = FALSE;
+  g_mutex_unlock (priv->id_lock);
+
+  priv->trick_pos  = priv->shown_timestamp;
+  priv->trick_time = clutter_helix_get_time_us ();
+
+  if (speed < 1.0)
+    interval = priv->frame_interval / speed;
+  else
+    interval = MAX (priv->frame_interval, TRICK_SEEK_INTERVAL);
+
+  priv->trick_id = clutter_threads_add_timeout (interval,
+                                                trick_timeout_func,
+                                                video_texture);
+}
+
+static void
+clutter_helix_video_texture_stop_trick (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean fast;
+
+  if (priv->trick_id > 0)
+    {
+      g_source_remove (priv->trick_id);
+      priv->trick_id = 0;
+    }
+
+  g_mutex_lock (priv->id_lock);
+  fast = priv->trick_fast;
+  priv->trick_fast    = FALSE;
+  priv->trick_pending = FALSE;
+  if (priv->trick_pause_id > 0)
+    {
+      g_source_remove (priv->trick_pause_id);
+      priv->trick_pause_id = 0;
+    }
+  g_mutex_unlock (priv->id_lock);
+
+  /* don't let an outstanding seek carry on at the normal rate */
+  if (fast)
+    player_pause (priv->player);
+
+  if (priv->trick_volume >= 0)
+    {
+      player_setvolume (priv->player, priv->trick_volume);
+      priv->trick_volume = -1;
+    }
+}
+
+static void
+set_rate (ClutterHelixVideoTexture *video_texture,
+          gdouble                   rate)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean playing;
+
+  if (ABS (rate) < MIN_RATE)
+    rate = rate < 0 ? -MIN_RATE : MIN_RATE;
+
+  if (rate == priv->rate)
+    return;
+
+  playing = priv->player && priv->uri &&
+            get_playing (CLUTTER_MEDIA (video_texture));
+
+  if (priv->player)
+    clutter_helix_video_texture_stop_trick (video_texture);
+
+  priv->rate = rate;
+
+  if (playing)
+    {
+      if (rate == 1.0)
+        set_playing (CLUTTER_MEDIA (video_texture), TRUE);
+      else
+        clutter_helix_video_texture_start_trick (video_texture);
+    }
+
+  g_object_notify (G_OBJECT (video_texture), "rate");
+}
+
+static void
+set_dirty_tiles (ClutterHelixVideoTexture *video_texture,
+                 gboolean                  dirty_tiles)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint i;
+
+  if (dirty_tiles == priv->dirty_tiles)
+    return;
+
+  /* the hashes get stale while off */
+  for (i = 0; i < G_N_ELEMENTS (priv->dirty_maps); i++)
+    clutter_helix_dirty_map_clear (&priv->dirty_maps[i]);
+
+  priv->dirty_tiles = dirty_tiles;
+  g_object_notify (G_OBJECT (video_texture), "dirty-tiles");
+}
+
+static void
+set_rgba_cache (ClutterHelixVideoTexture *video_texture,
+                gboolean                  rgba_cache)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (rgba_cache == priv->rgba_cache)
+    return;
+
+  priv->rgba_cache  = rgba_cache;
+  priv->rgba_failed = FALSE;
+  priv->rgba_dirty  = TRUE;
+
+  if (!rgba_cache)
+    clutter_helix_video_texture_free_rgba (video_texture);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (video_texture));
+  g_object_notify (G_OBJECT (video_texture), "rgba-cache");
+}
+
+static void
+set_color_matrix (ClutterHelixVideoTexture *video_texture,
+                  ClutterHelixColorMatrix   color_matrix)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (priv->color_matrix == color_matrix)
+    return;
+
+  priv->color_matrix = color_matrix;
+  clutter_helix_video_texture_update_colors (video_texture);
+
+  g_object_notify (G_OBJECT (video_texture), "color-matrix");
+}
+
+static void
+set_full_range (ClutterHelixVideoTexture *video_texture,
+                gboolean                  full_range)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (full_range == priv->full_range)
+    return;
+
+  priv->full_range = full_range;
+  clutter_helix_video_texture_update_colors (video_texture);
+
+  g_object_notify (G_OBJECT (video_texture), "full-range");
+}
+
+/* brightness, contrast and saturation */
+static void
+set_color_adjustment (ClutterHelixVideoTexture *video_texture,
+                      gdouble                  *adjustment,
+                      gdouble                   value,
+                      const gchar              *property)
+{
+  if (value == *adjustment)
+    return;
+
+  *adjustment = value;
+  clutter_helix_video_texture_update_colors (video_texture);
+
+  g_object_notify (G_OBJECT (video_texture), property);
+}
+
+static void
+set_deinterlace (ClutterHelixVideoTexture *video_texture,
+                 ClutterHelixDeinterlace   mode)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (priv->deinterlace == mode)
+    return;
+
+  priv->deinterlace = mode;
+  clutter_helix_video_texture_update_shader (video_texture);
+  if (mode != CLUTTER_HELIX_DEINTERLACE_BOB && priv->field_id)
+    {
+      g_source_remove (priv->field_id);
+      priv->field_id = 0;
+    }
+
+  priv->rgba_dirty = TRUE;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (video_texture));
+
+  g_object_notify (G_OBJECT (video_texture), "deinterlace");
+}
+
+static void
+set_field_order (ClutterHelixVideoTexture *video_texture,
+                 ClutterHelixFieldOrder    order)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  /* read by the Helix thread, applies from the next frame decoded */
+  g_mutex_lock (priv->id_lock);
+  priv->bottom_first = order == CLUTTER_HELIX_FIELD_ORDER_BOTTOM_FIRST;
+  g_mutex_unlock (priv->id_lock);
+
+  g_object_notify (G_OBJECT (video_texture), "field-order");
+}
+
+static gboolean
+get_playing (ClutterMedia *media)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv; 
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), FALSE);
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return FALSE;
+
+  return (priv->trick_id > 0 || priv->state == PLAYER_STATE_PLAYING);
+}
+
+static void
+set_playing (ClutterMedia *media,
+	           gboolean      playing)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv; 
+
+  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return;
+
+  if (priv->hold_id > 0)
+    {
+      g_source_remove (priv->hold_id);
+      priv->hold_id = 0;
+    }
+
+  if (!playing)
+    clutter_helix_video_texture_stop_trick (video_texture);
+        
+  if (priv->uri) 
+    {
+      if (playing && priv->rate != 1.0)
+        {
+          if (priv->trick_id == 0)
+            clutter_helix_video_texture_start_trick (video_texture);
+        }
+      else if (playing && priv->stepped)
+        {
+          /* resume from the frame stepped to */
+          clutter_helix_video_texture_cancel_step (video_texture);
+          priv->stepped = FALSE;
+          g_mutex_lock (priv->id_lock);
+          priv->pos_ms   = priv->shown_timestamp;
+          priv->pos_time = clutter_helix_get_time_us ();
+          g_mutex_unlock (priv->id_lock);
+          player_seek (priv->player, priv->shown_timestamp);
+          player_begin (priv->player);
+        }
+      else if (playing && !get_playing (media))
+        {
+          player_begin (priv->player);
+        }
+      else if (!playing && get_playing (media))
+        {
+          priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+          player_pause(priv->player);
+        }
+    } 
+  else 
+    {
+      if (playing)
+        g_warning ("Tried to play, but no URI is loaded.");
+    }
+  
+  g_object_notify (G_OBJECT (video_texture), "playing");
+  g_object_notify (G_OBJECT (video_texture), "progress");
+}
+static void
+set_position (ClutterMedia *media,
+	            gdouble       position) /* seconds */
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv; 
+
+  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return;
+
+  clutter_helix_video_texture_cancel_step (video_texture);
+  clutter_helix_video_texture_stop_replay (video_texture);
+  priv->stepped = FALSE;
+
+  g_mutex_lock (priv->id_lock);
+  /* the frames following a seek are not the head of the stream, nor the
+   * ones a loop replay has shown */
+  if (position > 0)
+    priv->head_complete = TRUE;
+  priv->loop_shown   = 0;
+  priv->loop_decoded = 0;
+  priv->pos_ms   = position * 1000;
+  priv->pos_time = clutter_helix_get_time_us ();
+  g_mutex_unlock (priv->id_lock);
+
+  player_seek (priv->player, position * 1000);
+}
+
+static void
+set_progress (ClutterMedia *media,
+	            gdouble       progress)
+{
+  if (progress >= 0 && progress <= 1.0) {
+    ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+    ClutterHelixVideoTexturePrivate *priv; 
+
+    g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+
+    priv = video_texture->priv;
+    
+    gdouble position = 0;
+    if (priv->duration > 0)
+      {
+        position = (gint)(progress * (gdouble)priv->duration);
+      }
+    set_position (media, position);
+    g_object_notify (G_OBJECT (video_texture), "progress");
+  }
+}
+
+static int
+get_position (ClutterMedia *media)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv; 
+  gint32 position;
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return -1;
+  
+  position = get_curr_playtime (priv->player);
+  return (position / 1000);
+}
+
+static gdouble get_progress (ClutterMedia *media)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE(media);
+  ClutterHelixVideoTexturePrivate *priv; 
+  gint32 position;
+  gdouble progress = 0.0;
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return 0;
+  
+  position = get_position (media);
+  if (priv->duration > 0)
+    progress = (gdouble)position/(gdouble)priv->duration;
+
+  return progress;
+}
+
+static void
+set_volume (ClutterMedia *media,
+	          double        volume)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+  ClutterHelixVideoTexturePrivate *priv; 
+  unsigned short volume_in_u16;
+
+  g_return_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture));
+
+  priv = video_texture->priv;
+  
+  if (!priv->player)
+    return;
+
+  if (volume >= 1.0)
+    volume_in_u16 = 100;
+  else if (volume <= 0.0)
+    volume_in_u16 = 0;
+  else
+    volume_in_u16 = (int)(volume * (100.0));
+
+  /* muted for trick play, the volume comes back once at the normal rate */
+  if (priv->trick_volume >= 0)
+    priv->trick_volume = volume_in_u16;
+  else
+    player_setvolume (priv->player, volume_in_u16);  
+  g_object_notify (G_OBJECT (video_texture), "audio-volume");
+}
+
+static double
+get_volume (ClutterMedia *media)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE(media);
+  ClutterHelixVideoTexturePrivate *priv; 
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), 0.0);
+
+  priv = video_texture->priv;
+  
+  if (!priv->player)
+    return 0.0;
+
+  int ret;
+  if (priv->trick_volume >= 0)
+    ret = priv->trick_volume;
+  else
+    ret = player_getvolume (priv->player);
+  if (ret < 0)
+    ret = 0;
+  
+  return (double)((double)ret/(double)100);
+}
+
+static gboolean
+can_seek (ClutterMedia *media)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), FALSE);
+  
+  return video_texture->priv->can_seek;
+}
+
+static int
+get_buffer_percent (ClutterMedia *media)
+{
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
+  
+  return video_texture->priv->buffer_percent;
+}
+
+static int
+get_duration(ClutterMedia *media)
+{
+
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (media);
+
+  g_return_val_if_fail (CLUTTER_HELIX_IS_VIDEO_TEXTURE (video_texture), -1);
+  
+  return video_texture->priv->duration;
+}
+
+static void
+clutter_media_init (ClutterMediaIface *iface)
+{
+
+}
+
+static void
+clutter_helix_video_texture_dispose (GObject *object)
+{
+  ClutterHelixVideoTexture        *self;
+  ClutterHelixVideoTexturePrivate *priv; 
+  guint                            i;
+
+  self = CLUTTER_HELIX_VIDEO_TEXTURE (object); 
+  priv = self->priv;
+
+  if (priv->player) 
+    {
+      clutter_helix_video_texture_stop_trick (self);
+      clutter_helix_video_texture_cancel_preroll (self);
+
+      for (i = 0; i < G_N_ELEMENTS (priv->slots); i++)
+        {
+          if (priv->slots[i].player == NULL)
+            continue;
+
+          player_stop (priv->slots[i].player);
+          put_player (priv->slots[i].player);
+          priv->slots[i].player = NULL;
+        }
+      priv->player = NULL;
+    }
+
+  if (priv->renderer_state == CLUTTER_HELIX_RENDERER_RUNNING ||
+      priv->renderer_state == CLUTTER_HELIX_RENDERER_NEED_GC)
+    {
+      priv->renderer->deinit (self);
+      priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+    }
+  set_upload_thread (self, FALSE);
+  clutter_helix_video_texture_drop_planes (self);
+  g_hash_table_remove_all (priv->programs);
+  g_hash_table_remove_all (priv->core_programs);
+  for (i = 0; i < G_N_ELEMENTS (priv->dirty_maps); i++)
+    clutter_helix_dirty_map_clear (&priv->dirty_maps[i]);
+
+  clutter_helix_texture_budget_remove (self);
+  priv->texture_bytes = 0;
+
+  clutter_helix_atlas_slot_free (priv->atlas_slot);
+  priv->atlas_slot = NULL;
+
+  if (priv->idle_id > 0)
+    {
+      g_source_remove (priv->idle_id);
+      priv->idle_id = 0;
+    }
+
+  g_mutex_lock (priv->id_lock);
+  if (priv->eos_id > 0)
+    {
+      g_source_remove (priv->eos_id);
+      priv->eos_id = 0;
+    }
+  g_mutex_unlock (priv->id_lock);
+
+  if (priv->regrow_id > 0)
+    {
+      g_source_remove (priv->regrow_id);
+      priv->regrow_id = 0;
+    }
+
+  if (priv->flush_id > 0)
+    {
+      g_source_remove (priv->flush_id);
+      priv->flush_id = 0;
+    }
+
+  if (priv->field_id > 0)
+    {
+      g_source_remove (priv->field_id);
+      priv->field_id = 0;
+    }
+
+  if (priv->hold_id > 0)
+    {
+      g_source_remove (priv->hold_id);
+      priv->hold_id = 0;
+    }
+
+  clutter_helix_video_texture_stop_replay (self);
+  clutter_helix_video_texture_cancel_step (self);
+  
+  if (priv->id_lock)
+    {
+      g_mutex_free (priv->id_lock);
+      priv->id_lock = NULL;
+    }
+
+ if (priv->tick_timeout_id > 0) 
+    {
+      g_source_remove (priv->tick_timeout_id);
+      priv->tick_timeout_id = 0;
+    }
+    G_OBJECT_CLASS (clutter_helix_video_texture_parent_class)->dispose (object);
+}
+
+static void
+clutter_helix_video_texture_finalize (GObject *object)
+{
+  ClutterHelixVideoTexture        *self;
+  ClutterHelixVideoTexturePrivate *priv; 
+
+  self = CLUTTER_HELIX_VIDEO_TEXTURE (object); 
+  priv = self->priv;
+
+  if (priv->uri)
+    g_free (priv->uri);
+
+  clutter_helix_frame_free (priv->frame);
+  clutter_helix_frame_free (priv->hidden_frame);
+  clutter_helix_frame_free (priv->last_frame);
+  clutter_helix_frame_cache_free (priv->step_cache);
+  g_slist_free (priv->clones);
+  g_hash_table_destroy (priv->programs);
+  g_hash_table_destroy (priv->core_programs);
+
+  if (priv->head_frames)
+    {
+      g_queue_foreach (priv->head_frames, (GFunc) clutter_helix_frame_free,
+                       NULL);
+      g_queue_free (priv->head_frames);
+    }
+
+  deinit_main();
+
+  G_OBJECT_CLASS (clutter_helix_video_texture_parent_class)->finalize (object);
+}
+
+static void
+clutter_helix_video_texture_set_property (GObject      *object, 
+					                                guint         property_id,
+					                                const GValue *value, 
+					                                GParamSpec   *pspec)
+{
+  ClutterHelixVideoTexture *video_texture;
+
+  video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (object);
+
+  switch (property_id)
+    {
+    case PROP_URI:
+      set_uri (CLUTTER_MEDIA (video_texture), g_value_get_string (value));
+      break;
+    case PROP_PLAYING:
+      set_playing (CLUTTER_MEDIA (video_texture), g_value_get_boolean (value));
+      break;
+    case PROP_PROGRESS:
+      set_progress (CLUTTER_MEDIA (video_texture), g_value_get_double (value));
+      break;
+    case PROP_AUDIO_VOLUME:
+      set_volume (CLUTTER_MEDIA (video_texture), g_value_get_double (value));
+      break;
+    case PROP_NEXT_URI:
+      set_next_uri (video_texture, g_value_get_string (value));
+      break;
+    case PROP_LOOP:
+      video_texture->priv->loop = g_value_get_boolean (value);
+      break;
+    case PROP_LOOP_CACHE_FRAMES:
+      video_texture->priv->loop_cache_frames = g_value_get_uint (value);
+      break;
+    case PROP_LOOP_CACHE_SIZE:
+      video_texture->priv->loop_cache_size = g_value_get_uint (value);
+      break;
+    case PROP_STEP_CACHE_SIZE:
+      video_texture->priv->step_cache_size = g_value_get_uint (value);
+      if (video_texture->priv->step_cache_used)
+        clutter_helix_frame_cache_set_max_size (video_texture->priv->step_cache,
+                                                video_texture->priv->step_cache_size);
+      break;
+    case PROP_DROP_HIDDEN_FRAMES:
+      video_texture->priv->drop_hidden = g_value_get_boolean (value);
+      break;
+    case PROP_AUTO_DOWNSCALE:
+      video_texture->priv->auto_downscale = g_value_get_boolean (value);
+      video_texture->priv->display_shift = 0;
+      break;
+    case PROP_USE_ATLAS:
+      video_texture->priv->use_atlas = g_value_get_boolean (value);
+      break;
+    case PROP_RATE:
+      set_rate (video_texture, g_value_get_double (value));
+      break;
+    case PROP_MUTE_TRICK_PLAY:
+      video_texture->priv->mute_trick_play = g_value_get_boolean (value);
+      break;
+    case PROP_DIRTY_TILES:
+      set_dirty_tiles (video_texture, g_value_get_boolean (value));
+      break;
+    case PROP_UPLOAD_THREAD:
+      set_upload_thread (video_texture, g_value_get_boolean (value));
+      break;
+    case PROP_RGBA_CACHE:
+      set_rgba_cache (video_texture, g_value_get_boolean (value));
+      break;
+    case PROP_COLOR_MATRIX:
+      set_color_matrix (video_texture, g_value_get_enum (value));
+      break;
+    case PROP_FULL_RANGE:
+      set_full_range (video_texture, g_value_get_boolean (value));
+      break;
+    case PROP_BRIGHTNESS:
+      set_color_adjustment (video_texture,
+                            &video_texture->priv->brightness,
+                            g_value_get_double (value),
+                            "brightness");
+      break;
+    case PROP_CONTRAST:
+      set_color_adjustment (video_texture,
+                            &video_texture->priv->contrast,
+                            g_value_get_double (value),
+                            "contrast");
+      break;
+    case PROP_SATURATION:
+      set_color_adjustment (video_texture,
+                            &video_texture->priv->saturation,
+                            g_value_get_double (value),
+                            "saturation");
+      break;
+    case PROP_DEINTERLACE:
+      set_deinterlace (video_texture, g_value_get_enum (value));
+      break;
+    case PROP_FIELD_ORDER:
+      set_field_order (video_texture, g_value_get_enum (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+clutter_helix_video_texture_get_property (GObject    *object, 
+				                                  guint       property_id,
+				                                  GValue     *value, 
+				                                  GParamSpec *pspec)
+{
+  ClutterHelixVideoTexture *video_texture;
+  ClutterMedia             *media;
+
+  video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (object);
+  media         = CLUTTER_MEDIA (video_texture);
+
+  switch (property_id)
+    {
+    case PROP_URI:
+      g_value_set_string (value, get_uri (media));
+      break;
+    case PROP_PLAYING:
+      g_value_set_boolean (value, get_playing (media));
+      break;
+    case PROP_PROGRESS:
+      g_value_set_double (value, get_progress (media));
+      break;
+    case PROP_AUDIO_VOLUME:
+      g_value_set_double (value, get_volume (media));
+      break;
+    case PROP_CAN_SEEK:
+      g_value_set_boolean (value, can_seek (media));
+      break;
+    case PROP_BUFFER_FILL:
+      g_value_set_int (value, (gdouble)get_buffer_percent (media)/(gdouble)100);
+      break;
+    case PROP_DURATION:
+      g_value_set_double (value, get_duration (media));
+      break;
+    case PROP_NEXT_URI:
+      g_value_set_string (value, video_texture->priv->next_uri);
+      break;
+    case PROP_LOOP:
+      g_value_set_boolean (value, video_texture->priv->loop);
+      break;
+    case PROP_LOOP_CACHE_FRAMES:
+      g_value_set_uint (value, video_texture->priv->loop_cache_frames);
+      break;
+    case PROP_LOOP_CACHE_SIZE:
+      g_value_set_uint (value, video_texture->priv->loop_cache_size);
+      break;
+    case PROP_STEP_CACHE_SIZE:
+      g_value_set_uint (value, video_texture->priv->step_cache_size);
+      break;
+    case PROP_DROP_HIDDEN_FRAMES:
+      g_value_set_boolean (value, video_texture->priv->drop_hidden);
+      break;
+    case PROP_SKIPPED_UPLOADS:
+      g_value_set_uint (value, video_texture->priv->skipped_uploads);
+      break;
+    case PROP_TEXTURE_BYTES:
+      g_value_set_uint (value, video_texture->priv->texture_bytes);
+      break;
+    case PROP_AUTO_DOWNSCALE:
+      g_value_set_boolean (value, video_texture->priv->auto_downscale);
+      break;
+    case PROP_USE_ATLAS:
+      g_value_set_boolean (value, video_texture->priv->use_atlas);
+      break;
+    case PROP_RATE:
+      g_value_set_double (value, video_texture->priv->rate);
+      break;
+    case PROP_MUTE_TRICK_PLAY:
+      g_value_set_boolean (value, video_texture->priv->mute_trick_play);
+      break;
+    case PROP_VIDEO_FORMAT:
+      g_value_set_string (value, video_texture->priv->format_info ?
+                                 video_texture->priv->format_info->name : NULL);
+      break;
+    case PROP_PREFERRED_VIDEO_FORMAT:
+      g_value_set_string (value, video_texture->priv->preferred_info ?
+                                 video_texture->priv->preferred_info->name : NULL);
+      break;
+    case PROP_DIRTY_TILES:
+      g_value_set_boolean (value, video_texture->priv->dirty_tiles);
+      break;
+    case PROP_BYTES_SAVED:
+      g_value_set_uint64 (value, video_texture->priv->bytes_saved);
+      break;
+    case PROP_UPLOAD_THREAD:
+      g_value_set_boolean (value, video_texture->priv->upload_thread);
+      break;
+    case PROP_RGBA_CACHE:
+      g_value_set_boolean (value, video_texture->priv->rgba_cache);
+      break;
+    case PROP_COLOR_MATRIX:
+      g_value_set_enum (value, video_texture->priv->color_matrix);
+      break;
+    case PROP_FULL_RANGE:
+      g_value_set_boolean (value, video_texture->priv->full_range);
+      break;
+    case PROP_BRIGHTNESS:
+      g_value_set_double (value, video_texture->priv->brightness);
+      break;
+    case PROP_CONTRAST:
+      g_value_set_double (value, video_texture->priv->contrast);
+      break;
+    case PROP_SATURATION:
+      g_value_set_double (value, video_texture->priv->saturation);
+      break;
+    case PROP_DEINTERLACE:
+      g_value_set_enum (value, video_texture->priv->deinterlace);
+      break;
+    case PROP_FIELD_ORDER:
+      g_value_set_enum (value,
+                        video_texture->priv->bottom_first ?
+                          CLUTTER_HELIX_FIELD_ORDER_BOTTOM_FIRST :
+                          CLUTTER_HELIX_FIELD_ORDER_TOP_FIRST);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+clutter_helix_video_texture_class_init (ClutterHelixVideoTextureClass *klass)
+{
+  GObjectClass      *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class  = CLUTTER_ACTOR_CLASS (klass);
+
+  init_main();
+  g_type_class_add_private (klass, sizeof (ClutterHelixVideoTexturePrivate));
+
+  object_class->dispose      = clutter_helix_video_texture_dispose;
+  object_class->finalize     = clutter_helix_video_texture_finalize;
+  object_class->set_property = clutter_helix_video_texture_set_property;
+  object_class->get_property = clutter_helix_video_texture_get_property;
+
+  actor_class->paint                = clutter_helix_video_texture_paint;
+  actor_class->get_preferred_width  = clutter_helix_video_texture_get_preferred_width;
+  actor_class->get_preferred_height = clutter_helix_video_texture_get_preferred_height;
+
+  /* Interface props */
+  g_object_class_override_property (object_class, PROP_URI, "uri");
+  g_object_class_override_property (object_class, PROP_PLAYING, "playing");
+  g_object_class_override_property (object_class, PROP_PROGRESS, "progress");
+  g_object_class_override_property (object_class, PROP_AUDIO_VOLUME, "audio-volume");
+  g_object_class_override_property (object_class, PROP_CAN_SEEK, "can-seek");
+  g_object_class_override_property (object_class, PROP_DURATION, "duration");
+  g_object_class_override_property (object_class, PROP_BUFFER_FILL, "buffer-fill" );
+
+  /**
+   * ClutterHelixVideoTexture:next-uri:
+   *
+   * The URI to play once the current one has reached its end. It is opened
+   * and prerolled on a second player in the background, so the transition
+   * does not wait for the new stream to open and buffer. No #ClutterMedia::eos
+   * is emitted when switching to the next URI.
+   */
+  g_object_class_install_property (object_class, PROP_NEXT_URI,
+      g_param_spec_string ("next-uri",
+                           "Next URI",
+                           "URI to play after the current one",
+                           NULL,
+                           G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:loop:
+   *
+   * Whether to restart the stream when it reaches its end. The first frames
+   * of the stream are kept in memory and shown while the decoder restarts,
+   * so the loop boundary does not stall. #ClutterMedia::eos is not emitted
+   * when looping.
+   */
+  g_object_class_install_property (object_class, PROP_LOOP,
+      g_param_spec_boolean ("loop",
+                            "Loop",
+                            "Restart the stream when it reaches its end",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:loop-cache-frames:
+   *
+   * Maximum number of frames from the start of the stream kept to cover the
+   * decoder restart when #ClutterHelixVideoTexture:loop is set.
+   */
+  g_object_class_install_property (object_class, PROP_LOOP_CACHE_FRAMES,
+      g_param_spec_uint ("loop-cache-frames",
+                         "Loop cache frames",
+                         "Number of frames cached to cover a loop restart",
+                         0, G_MAXUINT,
+                         DEFAULT_LOOP_CACHE_FRAMES,
+                         G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:loop-cache-size:
+   *
+   * Maximum amount of memory, in bytes, used by the frames cached when
+   * #ClutterHelixVideoTexture:loop is set.
+   */
+  g_object_class_install_property (object_class, PROP_LOOP_CACHE_SIZE,
+      g_param_spec_uint ("loop-cache-size",
+                         "Loop cache size",
+                         "Memory used by the loop cache, in bytes",
+                         0, G_MAXUINT,
+                         DEFAULT_LOOP_CACHE_SIZE,
+                         G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:step-cache-size:
+   *
+   * Maximum amount of memory, in bytes, holding recently decoded frames for
+   * clutter_helix_video_texture_step(). Frames are evicted least recently
+   * used first. Nothing is cached before the first step.
+   */
+  g_object_class_install_property (object_class, PROP_STEP_CACHE_SIZE,
+      g_param_spec_uint ("step-cache-size",
+                         "Step cache size",
+                         "Memory holding recently decoded frames, in bytes",
+                         0, G_MAXUINT,
+                         DEFAULT_STEP_CACHE_SIZE,
+                         G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:drop-hidden-frames:
+   *
+   * Whether to drop the frames decoded while neither the texture nor any of
+   * its clones can be seen, straight from the decoder thread. Only the newest
+   * one is kept, to be shown once visible again. When unset, the skipped
+   * frames still feed the cache used by clutter_helix_video_texture_step().
+   */
+  g_object_class_install_property (object_class, PROP_DROP_HIDDEN_FRAMES,
+      g_param_spec_boolean ("drop-hidden-frames",
+                            "Drop hidden frames",
+                            "Drop frames decoded while not visible",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:skipped-uploads:
+   *
+   * Number of frames not uploaded because the texture could not be seen.
+   */
+  g_object_class_install_property (object_class, PROP_SKIPPED_UPLOADS,
+      g_param_spec_uint ("skipped-uploads",
+                         "Skipped uploads",
+                         "Frames not uploaded while not visible",
+                         0, G_MAXUINT,
+                         0,
+                         G_PARAM_READABLE));
+
+  /**
+   * ClutterHelixVideoTexture:texture-bytes:
+   *
+   * Amount of texture memory, in bytes, holding the current frame. It
+   * counts towards the budget set with clutter_helix_set_texture_budget().
+   */
+  g_object_class_install_property (object_class, PROP_TEXTURE_BYTES,
+      g_param_spec_uint ("texture-bytes",
+                         "Texture bytes",
+                         "Texture memory used by the current frame",
+                         0, G_MAXUINT,
+                         0,
+                         G_PARAM_READABLE));
+
+  /**
+   * ClutterHelixVideoTexture:auto-downscale:
+   *
+   * Whether to downscale the frames before uploading them when the texture
+   * and its clones are painted much smaller than the stream, for instance
+   * as thumbnails. This saves upload bandwidth and texture memory, at the
+   * cost of halving the frames on the CPU and of some sharpness, so it is
+   * off by default.
+   */
+  g_object_class_install_property (object_class, PROP_AUTO_DOWNSCALE,
+      g_param_spec_boolean ("auto-downscale",
+                            "Auto downscale",
+                            "Downscale frames to the painted size",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:use-atlas:
+   *
+   * Whether to share textures with the other small I420 streams. The planes
+   * of the streams are packed in a few large textures and painted with one
+   * material and one shader, so walls of many small videos need fewer
+   * texture and program changes. Each stream is still drawn by its own
+   * actor, one rectangle per paint. Takes effect on the next frame; streams
+   * larger than 640 pixels, or too many of them, still get textures of
+   * their own.
+   */
+  g_object_class_install_property (object_class, PROP_USE_ATLAS,
+      g_param_spec_boolean ("use-atlas",
+                            "Use atlas",
+                            "Share textures with other small streams",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:rate:
+   *
+   * The playback rate, negative to play backward. Its magnitude ranges from
+   * 0.25 to 16. Rates above 1 show keyframes only, rates below 1 step
+   * through every frame. See also #ClutterHelixVideoTexture:mute-trick-play.
+   */
+  g_object_class_install_property (object_class, PROP_RATE,
+      g_param_spec_double ("rate",
+                           "Rate",
+                           "Playback rate, negative to play backward",
+                           -MAX_RATE, MAX_RATE,
+                           1.0,
+                           G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:mute-trick-play:
+   *
+   * Whether to mute the audio while #ClutterHelixVideoTexture:rate is not 1.
+   * Otherwise the bits of audio decoded around each frame are played as is,
+   * without any pitch correction.
+   */
+  g_object_class_install_property (object_class, PROP_MUTE_TRICK_PLAY,
+      g_param_spec_boolean ("mute-trick-play",
+                            "Mute trick play",
+                            "Mute the audio at rates other than 1",
+                            TRUE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:video-format:
+   *
+   * The name of the format the frames are decoded to, "I420" or "RGB32"
+   * for instance, or %NULL before the first frame.
+   */
+  g_object_class_install_property (object_class, PROP_VIDEO_FORMAT,
+      g_param_spec_string ("video-format",
+                           "Video format",
+                           "Format of the decoded frames",
+                           NULL,
+                           G_PARAM_READABLE));
+
+  /**
+   * ClutterHelixVideoTexture:preferred-video-format:
+   *
+   * The name of the cheapest format to upload that the renderers available
+   * can convert on the GPU. When it differs from
+   * #ClutterHelixVideoTexture:video-format, the decoder is producing more
+   * bytes per frame than needed.
+   */
+  g_object_class_install_property (object_class, PROP_PREFERRED_VIDEO_FORMAT,
+      g_param_spec_string ("preferred-video-format",
+                           "Preferred video format",
+                           "Cheapest format the renderers can handle",
+                           NULL,
+                           G_PARAM_READABLE));
+
+  /**
+   * ClutterHelixVideoTexture:dirty-tiles:
+   *
+   * Whether to upload only the 64x64 blocks of the planes that changed
+   * since the last frame, found by hashing them. Frames identical to the
+   * last one aren't uploaded nor redrawn. That's a win for screen
+   * recordings and slides, a loss of a few percents of CPU for busy video.
+   * Frames split in tiles, 16 bit ones and the ones in the atlas are still
+   * uploaded whole.
+   */
+  g_object_class_install_property (object_class, PROP_DIRTY_TILES,
+      g_param_spec_boolean ("dirty-tiles",
+                            "Dirty tiles",
+                            "Upload only the parts of the frames that changed",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:bytes-saved:
+   *
+   * The bytes not uploaded thanks to #ClutterHelixVideoTexture:dirty-tiles.
+   */
+  g_object_class_install_property (object_class, PROP_BYTES_SAVED,
+      g_param_spec_uint64 ("bytes-saved",
+                           "Bytes saved",
+                           "Bytes not uploaded as unchanged",
+                           0, G_MAXUINT64,
+                           0,
+                           G_PARAM_READABLE));
+
+  /**
+   * ClutterHelixVideoTexture:upload-thread:
+   *
+   * Whether to upload the frames from a thread of their own, with a GL
+   * context sharing textures with the one of the stage. The clutter thread
+   * then only swaps textures, which is meant to keep uploads from delaying
+   * animations and input; how much that helps depends on the driver, see
+   * examples/upload-bench to measure it. Needs GLX and direct rendering;
+   * I420 and RGB32 frames only, not downscaled nor in the atlas, the
+   * others are uploaded as usual.
+   */
+  g_object_class_install_property (object_class, PROP_UPLOAD_THREAD,
+      g_param_spec_boolean ("upload-thread",
+                            "Upload thread",
+                            "Upload the frames from a thread of their own",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:rgba-cache:
+   *
+   * Whether to convert each new frame to RGBA once, into an offscreen
+   * texture, instead of on every paint. Saves GPU time when the frames get
+   * painted more than once: paused video, clones, other animations redrawing
+   * the stage. Costs a texture of 4 bytes per pixel, and needs FBOs; formats
+   * that don't need a shader are painted as usual.
+   */
+  g_object_class_install_property (object_class, PROP_RGBA_CACHE,
+      g_param_spec_boolean ("rgba-cache",
+                            "RGBA cache",
+                            "Convert the frames to RGBA once, not on every paint",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:color-matrix:
+   *
+   * The YUV to RGB conversion. %CLUTTER_HELIX_COLOR_AUTO picks BT.709 for
+   * streams 720 lines high or more and BT.601 otherwise, Helix not telling.
+   */
+  g_object_class_install_property (object_class, PROP_COLOR_MATRIX,
+      g_param_spec_enum ("color-matrix",
+                         "Color matrix",
+                         "YUV to RGB conversion",
+                         CLUTTER_HELIX_TYPE_COLOR_MATRIX,
+                         CLUTTER_HELIX_COLOR_AUTO,
+                         G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:full-range:
+   *
+   * Whether the samples use the full 0-255 range, as in JPEG, instead of
+   * 16-235 for luma and 16-240 for chroma.
+   */
+  g_object_class_install_property (object_class, PROP_FULL_RANGE,
+      g_param_spec_boolean ("full-range",
+                            "Full range",
+                            "Whether the samples use the full 0-255 range",
+                            FALSE,
+                            G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:brightness:
+   *
+   * Added to the luma, from -1.0 (black) to 1.0 (white).
+   *
+   * The color settings are applied on the GPU, by the YUV renderers. With
+   * the defaults and BT.601 limited range, the shaders are the cheapest
+   * ones; anything else uses a variant taking a matrix.
+   */
+  g_object_class_install_property (object_class, PROP_BRIGHTNESS,
+      g_param_spec_double ("brightness",
+                           "Brightness",
+                           "Added to the luma",
+                           -1.0, 1.0,
+                           0.0,
+                           G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:contrast:
+   *
+   * Scale of the luma around its middle, from 0.0 (grey) to 2.0.
+   */
+  g_object_class_install_property (object_class, PROP_CONTRAST,
+      g_param_spec_double ("contrast",
+                           "Contrast",
+                           "Scale of the luma around its middle",
+                           0.0, 2.0,
+                           1.0,
+                           G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:saturation:
+   *
+   * Scale of the chroma, from 0.0 (greyscale) to 2.0.
+   */
+  g_object_class_install_property (object_class, PROP_SATURATION,
+      g_param_spec_double ("saturation",
+                           "Saturation",
+                           "Scale of the chroma",
+                           0.0, 2.0,
+                           1.0,
+                           G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:deinterlace:
+   *
+   * How interlaced video gets deinterlaced, on the GPU. Only done for
+   * planar YUV frames drawn with GLSL; the color settings still apply.
+   */
+  g_object_class_install_property (object_class, PROP_DEINTERLACE,
+      g_param_spec_enum ("deinterlace",
+                         "Deinterlace",
+                         "How interlaced video gets deinterlaced",
+                         CLUTTER_HELIX_TYPE_DEINTERLACE,
+                         CLUTTER_HELIX_DEINTERLACE_NONE,
+                         G_PARAM_READWRITE));
+
+  /**
+   * ClutterHelixVideoTexture:field-order:
+   *
+   * Which field of the frames comes first in time. Helix doesn't tell, the
+   * frames decoded from then on are tagged with it.
+   */
+  g_object_class_install_property (object_class, PROP_FIELD_ORDER,
+      g_param_spec_enum ("field-order",
+                         "Field order",
+                         "Field first in time",
+                         CLUTTER_HELIX_TYPE_FIELD_ORDER,
+                         CLUTTER_HELIX_FIELD_ORDER_TOP_FIRST,
+                         G_PARAM_READWRITE));
+}
+
+static void
+on_buffering_cb (unsigned int   flags,
+		             unsigned short percentage,
+		             void          *context)
+{
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)slot->owner;
+  gboolean active;
+
+  g_mutex_lock (video_texture->priv->id_lock);
+  active = (slot == video_texture->priv->active);
+  g_mutex_unlock (video_texture->priv->id_lock);
+
+  if (!active)
+    return;
+
+  if (video_texture && video_texture->priv)
+    video_texture->priv->buffer_percent = percentage;
+  
+  g_object_notify (G_OBJECT (video_texture), "buffer-fill");
+}
+
+static gboolean
+emit_eos_idle_func(gpointer data)
+{
+  if (!data)
+    return FALSE;
+
+  ClutterHelixVideoTexture *vtexture = (ClutterHelixVideoTexture *)data;
+
+  g_mutex_lock (vtexture->priv->id_lock);
+  vtexture->priv->eos_id = 0;
+  g_mutex_unlock (vtexture->priv->id_lock);
+
+  /* The next item is ready, carry on with it instead of stopping */
+  if (vtexture->priv->next_uri && !vtexture->priv->preroll->failed)
+    {
+      clutter_helix_video_texture_swap_players (vtexture);
+      return FALSE;
+    }
+
+  if (vtexture->priv->loop)
+    {
+      clutter_helix_video_texture_restart_loop (vtexture);
+      return FALSE;
+    }
+
+  g_signal_emit_by_name (CLUTTER_MEDIA(vtexture), "eos");
+  return FALSE;
+}
+
+/* May get called with a mutex held in helix */
+static void
+on_pos_length_cb (unsigned int pos, unsigned int ulLength, void *context)
+{
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)slot->owner;
+  ClutterHelixVideoTexturePrivate *priv;
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return;
+
+  g_mutex_lock (priv->id_lock);
+  if (slot != priv->active)
+    {
+      g_mutex_unlock (priv->id_lock);
+      return;
+    }
+  priv->pos_ms   = pos;
+  priv->pos_time = clutter_helix_get_time_us ();
+  g_mutex_unlock (priv->id_lock);
+
+  /**
+   * Determine the duration.
+   **/
+  int new_duration = ulLength / 1000;
+  if (priv->duration != new_duration)
+    {
+      priv->duration = new_duration;
+      g_object_notify (G_OBJECT (video_texture), "duration");
+    }
+
+  g_mutex_lock (priv->id_lock);
+  if (pos >= ulLength && priv->eos_id == 0)
+    priv->eos_id = clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                                  emit_eos_idle_func,
+                                                  video_texture,
+                                                  NULL);
+  g_mutex_unlock (priv->id_lock);
+}
+
+/* Probably gets called with a mutex held in helix */
+static void
+on_state_change_cb (unsigned short old_state,
+                    unsigned short new_state,
+                    void          *context)
+{
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)slot->owner;
+  ClutterHelixVideoTexturePrivate *priv;
+
+  priv = video_texture->priv;
+
+  if (!priv->player)
+    return;
+
+  g_mutex_lock (priv->id_lock);
+  if (slot != priv->active)
+    {
+      g_mutex_unlock (priv->id_lock);
+      return;
+    }
+  g_mutex_unlock (priv->id_lock);
+
+  priv->state = new_state;
+  priv->can_seek  = player_canseek (priv->player);
+
+  g_object_notify (G_OBJECT (video_texture), "can-seek");
+}
+
+/* The fp renderers have a single fixed program, BT.601 limited range with
+ * no adjustments and progressive, the core ones don't deinterlace: with
+ * other settings the next renderer is picked */
+static gboolean
+clutter_helix_renderer_can_draw (ClutterHelixVideoTexture *video_texture,
+                                 ClutterHelixRenderer     *renderer)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if ((renderer->flags & (CLUTTER_HELIX_FP | CLUTTER_HELIX_GL_CORE)) &&
+      priv->deinterlace != CLUTTER_HELIX_DEINTERLACE_NONE)
+    return FALSE;
+
+  if (renderer->flags & CLUTTER_HELIX_FP)
+    return clutter_helix_video_texture_color_variant (video_texture) ==
+             COLOR_VARIANT_FIXED;
+
+  return TRUE;
+}
+
+static ClutterHelixRenderer *
+clutter_helix_find_renderer_by_format (ClutterHelixVideoTexture *video_texture,
+                                       ClutterHelixVideoFormat   format)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixRenderer *renderer = NULL, *fallback = NULL;
+  GSList *element;
+
+  for (element = priv->renderers; element; element = g_slist_next(element))
+    {
+      ClutterHelixRenderer *candidate = (ClutterHelixRenderer *)element->data;
+
+      if (candidate->format != format)
+        continue;
+
+      if (!clutter_helix_renderer_can_draw (video_texture, candidate))
+        {
+          if (fallback == NULL)
+            fallback = candidate;
+          continue;
+        }
+
+      renderer = candidate;
+      break;
+    }
+
+  /* the frame with the default colors rather than no frame at all */
+  return renderer ? renderer : fallback;
+}
+
+/* CID_LIBVA surfaces would need libva blitting, they are not supported */
+static const ClutterHelixFormatInfo *
+clutter_helix_format_info_from_cid (gint cid)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    if (formats[i].cid == cid)
+      return &formats[i];
+
+  return NULL;
+}
+
+/* Picks the cheapest format to decode to among the ones we have a renderer
+ * for, favouring renderers converting on the GPU. */
+static void
+clutter_helix_video_texture_negotiate_format (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixRenderer *renderer;
+  guint i;
+
+  priv->preferred_info = NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    {
+      renderer = clutter_helix_find_renderer_by_format (video_texture,
+                                                        formats[i].format);
+      if (renderer == NULL)
+        continue;
+
+      if (priv->preferred_info == NULL)
+        priv->preferred_info = &formats[i];
+
+      if (renderer->flags != 0)
+        {
+          priv->preferred_info = &formats[i];
+          break;
+        }
+    }
+}
+
+/*
+ * Texture budget
+ *
+ * The video textures share the budget set with
+ * clutter_helix_set_texture_budget(). Over budget, the least recently painted
+ * ones give memory back: unmapped textures are released (the last frame
+ * gets uploaded again when they are painted), mapped ones are downscaled.
+ */
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) / (a) * (a))
+
+/*
+ * Frame layouts
+ *
+ * Chroma planes are half the size of the picture, rounded up. Decoders may
+ * pad each line to some alignment, player.h doesn't tell which, so the
+ * layout of a frame is worked out from its size, see
+ * clutter_helix_video_format_guess_layout().
+ */
+
+/* Fills @strides and @offsets, in bytes, for lines padded to @align bytes.
+ * @shared: chroma lines are half as long as luma lines (a single line
+ * length for NV12). Returns the frame size, 0 if the layout doesn't hold. */
+static gsize
+clutter_helix_video_format_layout (ClutterHelixVideoFormat  format,
+                                   guint                    width,
+                                   guint                    height,
+                                   guint                    align,
+                                   gboolean                 shared,
+                                   guint                   *strides,
+                                   guint                   *offsets)
+{
+  guint cw = (width + 1) / 2, ch = (height + 1) / 2, bps = 1;
+
+  memset (strides, 0, MAX_PLANES * sizeof (guint));
+  memset (offsets, 0, MAX_PLANES * sizeof (guint));
+
+  switch (format)
+    {
+    case CLUTTER_HELIX_RGB32:
+      strides[0] = ALIGN_UP (width * 4, align);
+      return shared ? 0 : strides[0] * height;
+
+    case CLUTTER_HELIX_YUY2:
+    case CLUTTER_HELIX_UYVY:
+      strides[0] = ALIGN_UP (cw * 4, align);
+      return shared ? 0 : strides[0] * height;
+
+    case CLUTTER_HELIX_I420_10:
+      bps = 2;
+      /* fall through */
+    case CLUTTER_HELIX_I420:
+      strides[0] = ALIGN_UP (width * bps, align);
+      strides[1] = shared ? strides[0] / 2 : ALIGN_UP (cw * bps, align);
+      strides[2] = strides[1];
+      if (strides[1] < cw * bps)
+        return 0;
+      offsets[1] = strides[0] * height;
+      offsets[2] = offsets[1] + strides[1] * ch;
+      return offsets[2] + strides[2] * ch;
+
+    case CLUTTER_HELIX_YUVA:
+      /* I420 followed by a full resolution alpha plane */
+      strides[0] = ALIGN_UP (width, align);
+      strides[1] = shared ? strides[0] / 2 : ALIGN_UP (cw, align);
+      strides[2] = strides[1];
+      strides[3] = strides[0];
+      if (strides[1] < cw)
+        return 0;
+      offsets[1] = strides[0] * height;
+      offsets[2] = offsets[1] + strides[1] * ch;
+      offsets[3] = offsets[2] + strides[2] * ch;
+      return offsets[3] + strides[3] * height;
+
+    case CLUTTER_HELIX_NV12:
+      strides[0] = ALIGN_UP (width, align);
+      strides[1] = shared ? strides[0] : ALIGN_UP (cw * 2, align);
+      if (strides[1] < cw * 2)
+        return 0;
+      offsets[1] = strides[0] * height;
+      return offsets[1] + strides[1] * ch;
+
+    default:
+      return 0;
+    }
+}
+
+/* Finds the smallest line alignment accounting for the @size bytes of a
+ * frame. Failing that, assumes unpadded lines if the frame is big enough. */
+static gboolean
+clutter_helix_video_format_guess_layout (ClutterHelixVideoFormat  format,
+                                         guint                    width,
+                                         guint                    height,
+                                         gsize                    size,
+                                         guint                   *strides,
+                                         guint                   *offsets)
+{
+  guint align;
+
+  for (align = 1; align <= 256; align *= 2)
+    {
+      if (clutter_helix_video_format_layout (format, width, height, align,
+                                             FALSE, strides, offsets) == size)
+        return TRUE;
+      if (clutter_helix_video_format_layout (format, width, height, align,
+                                             TRUE, strides, offsets) == size)
+        return TRUE;
+    }
+
+  return clutter_helix_video_format_layout (format, width, height, 1,
+                                            FALSE, strides, offsets) <= size;
+}
+
+static gsize
+clutter_helix_video_format_frame_size (ClutterHelixVideoFormat format,
+                                       guint                   width,
+                                       guint                   height)
+{
+  guint strides[MAX_PLANES], offsets[MAX_PLANES];
+
+  return clutter_helix_video_format_layout (format, width, height, 1, FALSE,
+                                            strides, offsets);
+}
+
+/* @dst gets an unpadded frame of half the size of @src, rounded up. Returns
+ * FALSE if @format can't be downscaled. */
+static gboolean
+clutter_helix_video_format_halve (ClutterHelixVideoFormat  format,
+                                  const guchar            *src,
+                                  const guint             *strides,
+                                  const guint             *offsets,
+                                  guint                    width,
+                                  guint                    height,
+                                  guchar                  *dst)
+{
+  guint cw = (width + 1) / 2, ch = (height + 1) / 2;
+  guint dst_strides[MAX_PLANES], dst_offsets[MAX_PLANES];
+
+  clutter_helix_video_format_layout (format, cw, ch, 1, FALSE,
+                                     dst_strides, dst_offsets);
+
+  switch (format)
+    {
+    case CLUTTER_HELIX_RGB32:
+      clutter_helix_halve_plane (src, strides[0], width, height, 4,
+                                 dst, dst_strides[0]);
+      break;
+    case CLUTTER_HELIX_YUVA:
+      clutter_helix_halve_plane (src + offsets[3], strides[3],
+                                 width, height, 1,
+                                 dst + dst_offsets[3], dst_strides[3]);
+      /* fall through */
+    case CLUTTER_HELIX_I420:
+      clutter_helix_halve_plane (src + offsets[0], strides[0],
+                                 width, height, 1,
+                                 dst + dst_offsets[0], dst_strides[0]);
+      clutter_helix_halve_plane (src + offsets[1], strides[1], cw, ch, 1,
+                                 dst + dst_offsets[1], dst_strides[1]);
+      clutter_helix_halve_plane (src + offsets[2], strides[2], cw, ch, 1,
+                                 dst + dst_offsets[2], dst_strides[2]);
+      break;
+    case CLUTTER_HELIX_NV12:
+      clutter_helix_halve_plane (src + offsets[0], strides[0],
+                                 width, height, 1,
+                                 dst + dst_offsets[0], dst_strides[0]);
+      clutter_helix_halve_plane (src + offsets[1], strides[1], cw, ch, 2,
+                                 dst + dst_offsets[1], dst_strides[1]);
+      break;
+    default:
+      /* averaging packed 4:2:2 texels would blend neighbouring pixels */
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+clutter_helix_video_texture_is_mapped (ClutterHelixVideoTexture *video_texture)
+{
+  GSList *l;
+
+  if (CLUTTER_ACTOR_IS_MAPPED (CLUTTER_ACTOR (video_texture)))
+    return TRUE;
+
+  for (l = video_texture->priv->clones; l; l = l->next)
+    if (CLUTTER_ACTOR_IS_MAPPED (CLUTTER_ACTOR (l->data)))
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+clutter_helix_video_texture_release (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *frame;
+  CoglHandle empty;
+
+  /* keep the frame shown to put it back once painted again */
+  frame = priv->last_frame ? clutter_helix_frame_ref (priv->last_frame) : NULL;
+
+  priv->renderer->deinit (video_texture);
+  priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+  _renderer_disconnect_signals (video_texture);
+  clutter_helix_video_texture_drop_planes (video_texture);
+
+  empty = cogl_texture_new_with_size (1, 1,
+                                      COGL_TEXTURE_NO_SLICING,
+                                      COGL_PIXEL_FORMAT_RGBA_8888);
+  clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (video_texture), empty);
+  cogl_texture_unref (empty);
+
+  g_mutex_lock (priv->id_lock);
+  if (priv->hidden_frame == NULL)
+    {
+      priv->hidden_frame = frame;
+      frame = NULL;
+    }
+  g_mutex_unlock (priv->id_lock);
+  clutter_helix_frame_free (frame);
+
+  priv->texture_bytes = 0;
+  clutter_helix_texture_budget_update (video_texture, 0);
+}
+
+static gboolean
+clutter_helix_video_texture_evict (gpointer owner)
+{
+  ClutterHelixVideoTexture *video_texture = owner;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (priv->renderer_state != CLUTTER_HELIX_RENDERER_RUNNING ||
+      priv->texture_bytes == 0)
+    return FALSE;
+
+  if (!clutter_helix_video_texture_is_mapped (video_texture))
+    {
+      clutter_helix_video_texture_release (video_texture);
+      return TRUE;
+    }
+
+  if (priv->budget_shift >= MAX_BUDGET_SHIFT)
+    return FALSE;
+
+  priv->budget_shift++;
+
+  /* shrink now rather than on the next frame */
+  if (priv->last_frame == NULL)
+    return FALSE;
+
+  clutter_helix_video_texture_upload_frame (video_texture, priv->last_frame);
+
+  return TRUE;
+}
+
+/* ClutterTexture emits size-change whenever its texture is replaced, which
+ * says nothing about the stream anymore. Only ours get through. */
+static void
+clutter_helix_video_texture_size_change_cb (ClutterHelixVideoTexture *video_texture,
+                                            gint                      width,
+                                            gint                      height,
+                                            gpointer                  data)
+{
+  if (!video_texture->priv->size_changed)
+    g_signal_stop_emission_by_name (video_texture, "size-change");
+}
+
+static void
+clutter_helix_video_texture_size_changed (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  priv->size_changed = TRUE;
+  g_signal_emit_by_name (video_texture, "size-change",
+                         (gint) priv->stream_width,
+                         (gint) priv->stream_height);
+  priv->size_changed = FALSE;
+
+  /* see get_preferred_width() */
+  if (clutter_texture_get_sync_size (CLUTTER_TEXTURE (video_texture)))
+    clutter_actor_queue_relayout (CLUTTER_ACTOR (video_texture));
+}
+
+/*
+ * Upload thread, see clutter-helix-uploader.c
+ */
+
+static gboolean
+clutter_helix_video_texture_can_upload_off_thread (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  return priv->uploader && priv->renderer && priv->atlas_slot == NULL &&
+         (priv->renderer->upload == clutter_helix_yv12_upload ||
+          priv->renderer->upload == clutter_helix_rgb32_upload);
+}
+
+/* Describes the planes of @frame for the upload thread, as the renderers
+ * would upload them. Returns 0 if it can't. Called in the decoder thread. */
+static guint
+clutter_helix_video_texture_upload_planes (ClutterHelixFrame       *frame,
+                                           ClutterHelixUploadPlane *planes)
+{
+  const ClutterHelixFormatInfo *info;
+  guint strides[MAX_PLANES], offsets[MAX_PLANES], i, n, sub;
+
+  info = clutter_helix_format_info_from_cid (frame->cid);
+  if (info == NULL ||
+      (info->format != CLUTTER_HELIX_I420 && info->format != CLUTTER_HELIX_RGB32))
+    return 0;
+
+  if (!clutter_helix_video_format_guess_layout (info->format,
+                                                frame->width, frame->height,
+                                                frame->size,
+                                                strides, offsets))
+    return 0;
+
+  n = info->format == CLUTTER_HELIX_I420 ? 3 : 1;
+  for (i = 0; i < n; i++)
     {
-      player_stop (priv->player);
-      put_player (priv->player);
-      priv->player = NULL;
+      sub = i > 0 ? 2 : 1;
+
+      planes[i].offset     = offsets[i];
+      planes[i].stride     = strides[i];
+      planes[i].width      = (frame->width + sub - 1) / sub;
+      planes[i].height     = (frame->height + sub - 1) / sub;
+      planes[i].tex_width  = ALIGN_UP (frame->width, 2) / sub;
+      planes[i].tex_height = ALIGN_UP (frame->height, 2) / sub;
+      planes[i].bpp        = n == 1 ? 4 : 1;
     }
 
-  if (priv->renderer_state == CLUTTER_HELIX_RENDERER_RUNNING ||
-      priv->renderer_state == CLUTTER_HELIX_RENDERER_NEED_GC)
+  return n;
+}
+
+/* Called in the upload thread, @frame goes on as if just decoded */
+static void
+clutter_helix_video_texture_uploaded_cb (ClutterHelixFrame *frame,
+                                         gpointer           data)
+{
+  ClutterHelixVideoTexture *video_texture = data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  g_mutex_lock (priv->id_lock);
+  if (priv->idle_id == 0)
     {
-      priv->renderer->deinit (self);
-      priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+      priv->frame = frame;
+      priv->idle_id =
+        clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                       clutter_helix_video_render_idle_func,
+                                       video_texture,
+                                       NULL);
     }
+  else
+    clutter_helix_frame_cache_insert (priv->step_cache, frame);
+  g_mutex_unlock (priv->id_lock);
+}
 
-  if (priv->idle_id > 0)
+/* Paints the textures the upload thread made for @frame from now on, if it
+ * did. @replaced is set as by clutter_helix_upload_plane(). */
+static gboolean
+clutter_helix_video_texture_swap_uploaded (ClutterHelixVideoTexture *video_texture,
+                                           ClutterHelixFrame        *frame,
+                                           gboolean                 *replaced)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  CoglHandle textures[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  CoglHandle *planes[] = { &priv->y_tex, &priv->v_tex, &priv->u_tex };
+  guint i, n_textures;
+
+  if (!clutter_helix_uploader_swap (priv->uploader, frame,
+                                    textures, &n_textures))
+    return FALSE;
+
+  clutter_helix_video_texture_free_tiles (video_texture);
+
+  *replaced = priv->y_tex != textures[0];
+  for (i = 0; i < G_N_ELEMENTS (planes); i++)
     {
-      g_source_remove (priv->idle_id);
-      priv->idle_id = 0;
+      if (*planes[i])
+        cogl_texture_unref (*planes[i]);
+      *planes[i] = i < n_textures ? cogl_texture_ref (textures[i])
+                                  : COGL_INVALID_HANDLE;
     }
-  
-  if (priv->id_lock)
+
+  priv->uploaded_planes = TRUE;
+  priv->cap_width  = cogl_texture_get_width (priv->y_tex);
+  priv->cap_height = cogl_texture_get_height (priv->y_tex);
+
+  return TRUE;
+}
+
+static void
+set_upload_thread (ClutterHelixVideoTexture *video_texture,
+                   gboolean                  upload_thread)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixUploader *uploader;
+
+  if (upload_thread == priv->upload_thread)
+    return;
+
+  priv->upload_thread   = upload_thread;
+  priv->uploader_failed = FALSE;
+
+  if (!upload_thread)
     {
-      g_mutex_free (priv->id_lock);
-      priv->id_lock = NULL;
+      g_mutex_lock (priv->id_lock);
+      uploader = priv->uploader;
+      priv->uploader    = NULL;
+      priv->uploader_ok = FALSE;
+      g_mutex_unlock (priv->id_lock);
+
+      if (priv->uploaded_planes)
+        {
+          clutter_helix_video_texture_drop_planes (video_texture);
+          priv->uploaded_planes = FALSE;
+        }
+      clutter_helix_uploader_free (uploader);
     }
 
- if (priv->tick_timeout_id > 0) 
+  g_object_notify (G_OBJECT (video_texture), "upload-thread");
+}
+
+/*
+ * Bob deinterlacing: the second field of a frame gets shown half a frame
+ * interval after the first one.
+ */
+
+static gboolean
+clutter_helix_video_texture_field_timeout (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  priv->field_id     = 0;
+  priv->second_field = TRUE;
+  priv->rgba_dirty   = TRUE;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (video_texture));
+
+  return FALSE;
+}
+
+static void
+clutter_helix_video_texture_show_fields (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (priv->field_id)
     {
-      g_source_remove (priv->tick_timeout_id);
-      priv->tick_timeout_id = 0;
+      g_source_remove (priv->field_id);
+      priv->field_id = 0;
     }
-    G_OBJECT_CLASS (clutter_helix_video_texture_parent_class)->dispose (object);
+  priv->second_field = FALSE;
+
+  if (priv->program_deinterlace == CLUTTER_HELIX_DEINTERLACE_BOB &&
+      priv->state == PLAYER_STATE_PLAYING)
+    priv->field_id =
+      clutter_threads_add_timeout_full (G_PRIORITY_HIGH,
+                                        MAX (priv->frame_interval / 2, 1),
+                                        clutter_helix_video_texture_field_timeout,
+                                        video_texture,
+                                        NULL);
 }
 
-static void
-clutter_helix_video_texture_finalize (GObject *object)
+/* How many times a @width x @height frame of @format has to be halved to
+ * fit the textures without tiles, 0 for the formats that can be tiled */
+static guint
+clutter_helix_video_texture_fit_shift (ClutterHelixVideoTexture *video_texture,
+                                       ClutterHelixVideoFormat   format,
+                                       guint                     width,
+                                       guint                     height)
 {
-  ClutterHelixVideoTexture        *self;
-  ClutterHelixVideoTexturePrivate *priv; 
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint shift = 0;
 
-  self = CLUTTER_HELIX_VIDEO_TEXTURE (object); 
-  priv = self->priv;
+  if (format != CLUTTER_HELIX_YUVA)
+    return 0;
 
-  if (priv->uri)
-    g_free (priv->uri);
+  if (priv->max_texture_size == 0)
+    glGetIntegerv (GL_MAX_TEXTURE_SIZE, &priv->max_texture_size);
 
-  deinit_main();
+  while (ALIGN_UP (width, 2) > (guint) priv->max_texture_size ||
+         ALIGN_UP (height, 2) > (guint) priv->max_texture_size)
+    {
+      width  = (width + 1) / 2;
+      height = (height + 1) / 2;
+      shift++;
+    }
 
-  G_OBJECT_CLASS (clutter_helix_video_texture_parent_class)->finalize (object);
+  return shift;
 }
 
-static void
-clutter_helix_video_texture_set_property (GObject      *object, 
-					                                guint         property_id,
-					                                const GValue *value, 
-					                                GParamSpec   *pspec)
+/* Uploads @frame with the renderer handling its colorspace, the renderer is
+ * picked on the first frame. Has to be called in the clutter thread. */
+static gboolean
+clutter_helix_video_texture_upload_frame (ClutterHelixVideoTexture *video_texture,
+                                          ClutterHelixFrame        *frame)
 {
-  ClutterHelixVideoTexture *video_texture;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixVideoFormat format;
+  guchar *data, *scaled = NULL;
+  guint i, shift;
+  gboolean swapped, replaced;
 
-  video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (object);
+  if (G_UNLIKELY (priv->upload_thread && priv->uploader == NULL &&
+                  !priv->uploader_failed))
+    {
+      priv->uploader =
+        clutter_helix_uploader_new (clutter_helix_video_texture_uploaded_cb,
+                                    video_texture);
+      priv->uploader_failed = priv->uploader == NULL;
+    }
 
-  switch (property_id)
+  if (frame->width != priv->stream_width ||
+      frame->height != priv->stream_height)
     {
-    case PROP_URI:
-      set_uri (CLUTTER_MEDIA (video_texture), g_value_get_string (value));
-      break;
-    case PROP_PLAYING:
-      set_playing (CLUTTER_MEDIA (video_texture), g_value_get_boolean (value));
-      break;
-    case PROP_PROGRESS:
-      set_progress (CLUTTER_MEDIA (video_texture), g_value_get_double (value));
-      break;
-    case PROP_AUDIO_VOLUME:
-      set_volume (CLUTTER_MEDIA (video_texture), g_value_get_double (value));
-      break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      priv->stream_width  = frame->width;
+      priv->stream_height = frame->height;
+      clutter_helix_video_texture_size_changed (video_texture);
+      if (priv->color_matrix == CLUTTER_HELIX_COLOR_AUTO)
+        clutter_helix_video_texture_update_colors (video_texture);
+    }
+  priv->cid    = frame->cid;
+  priv->shown_timestamp = frame->timestamp;
+
+  /* kept to upload it again when the textures get released or resized */
+  if (frame != priv->last_frame)
+    {
+      clutter_helix_frame_free (priv->last_frame);
+      priv->last_frame = clutter_helix_frame_ref (frame);
+    }
+
+  if (priv->format_info == NULL || priv->format_info->cid != frame->cid)
+    {
+      priv->format_info = clutter_helix_format_info_from_cid (frame->cid);
+      if (priv->format_info == NULL)
+        {
+          g_warning ("Unsupported colorspace id:%d", frame->cid);
+          return FALSE;
+        }
+
+      if (priv->format_info != priv->preferred_info)
+        g_debug ("Decoding to %s, %s would be cheaper to upload",
+                 priv->format_info->name,
+                 priv->preferred_info ? priv->preferred_info->name : "none");
+
+      /* the stream changed format, a new URI for instance */
+      if (priv->renderer &&
+          priv->renderer->format != priv->format_info->format)
+        {
+          if (priv->renderer_state != CLUTTER_HELIX_RENDERER_STOPPED)
+            {
+              priv->renderer->deinit (video_texture);
+              _renderer_disconnect_signals (video_texture);
+            }
+          clutter_helix_video_texture_drop_planes (video_texture);
+          priv->renderer       = NULL;
+          priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+        }
+
+      g_object_notify (G_OBJECT (video_texture), "video-format");
+    }
+
+  if (priv->renderer == NULL) 
+    {
+      priv->renderer =
+        clutter_helix_find_renderer_by_format (video_texture,
+                                               priv->format_info->format);
+
+      if (priv->renderer == NULL)
+        {
+          g_warning ("No renderer for format:%s\n", priv->format_info->name);
+          return FALSE;
+        }
+
+      g_debug ("Rendering %s frames with the %s renderer",
+               priv->format_info->name, priv->renderer->name);
+    }
+
+  format = priv->renderer->format;
+
+  /* Scale back up only if 4 times the memory still fits, so that we don't
+   * go back and forth around the budget */
+  if (priv->budget_shift > 0 &&
+      clutter_helix_texture_budget_fits (priv->texture_bytes * 4))
+    priv->budget_shift--;
+
+  shift = priv->budget_shift +
+          clutter_helix_video_texture_display_shift (video_texture);
+  shift = MAX (shift, clutter_helix_video_texture_fit_shift (video_texture,
+                                                             format,
+                                                             frame->width,
+                                                             frame->height));
+
+  data = frame->data;
+  priv->width  = frame->width;
+  priv->height = frame->height;
+  if (!clutter_helix_video_format_guess_layout (format,
+                                                priv->width, priv->height,
+                                                frame->size,
+                                                priv->strides, priv->offsets))
+    {
+      g_warning ("Frame of %u bytes too small for %ux%u %s", frame->size,
+                 priv->width, priv->height, priv->format_info->name);
+      return FALSE;
+    }
+
+  for (i = 0; i < shift && priv->width >= 4 && priv->height >= 4; i++)
+    {
+      guchar *half;
+
+      half = g_malloc (clutter_helix_video_format_frame_size (format,
+                                                              (priv->width + 1) / 2,
+                                                              (priv->height + 1) / 2));
+      if (!clutter_helix_video_format_halve (format, data,
+                                             priv->strides, priv->offsets,
+                                             priv->width, priv->height, half))
+        {
+          g_free (half);
+          break;
+        }
+      g_free (scaled);
+      data = scaled = half;
+      priv->width  = (priv->width + 1) / 2;
+      priv->height = (priv->height + 1) / 2;
+      clutter_helix_video_format_layout (format, priv->width, priv->height,
+                                         1, FALSE,
+                                         priv->strides, priv->offsets);
+    }
+
+  clutter_helix_video_texture_choose_atlas (video_texture);
+
+  swapped = scaled == NULL &&
+            clutter_helix_video_texture_can_upload_off_thread (video_texture) &&
+            clutter_helix_video_texture_swap_uploaded (video_texture, frame,
+                                                       &replaced);
+  if (!swapped && priv->uploaded_planes)
+    {
+      /* the upload thread reuses its textures, back to ours */
+      clutter_helix_video_texture_drop_planes (video_texture);
+      priv->uploaded_planes = FALSE;
+    }
+
+  /* Grow the textures only when the frame doesn't fit, and give the memory
+   * back once they are 4 times too large, e.g. when downscaled */
+  if (!swapped &&
+      (priv->width > priv->cap_width || priv->height > priv->cap_height ||
+       priv->width * priv->height * 4 <= priv->cap_width * priv->cap_height))
+    {
+      /* even so that the chroma planes hold exactly half */
+      priv->cap_width  = ALIGN_UP (priv->width, 2);
+      priv->cap_height = ALIGN_UP (priv->height, 2);
+    }
+
+  /* The initialization / free functions of the renderers have to be called in
+   * the clutter thread (OpenGL context) */
+  if (G_UNLIKELY (priv->renderer_state == CLUTTER_HELIX_RENDERER_NEED_GC))
+    {
+      priv->renderer->deinit (video_texture);
+      priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+    }
+  if (G_UNLIKELY (priv->renderer_state == CLUTTER_HELIX_RENDERER_STOPPED))
+    {
+      priv->renderer->init (video_texture);
+      priv->renderer_state = CLUTTER_HELIX_RENDERER_RUNNING;
     }
+
+  if (swapped)
+    clutter_helix_video_texture_show_plane (video_texture, replaced,
+                                            priv->width, priv->height);
+  else
+    priv->renderer->upload (video_texture, data);
+
+  /* frames that went to tiles or back aren't deinterlaced the same */
+  clutter_helix_video_texture_update_shader (video_texture);
+  priv->frame_flags = frame->flags;
+  clutter_helix_video_texture_show_fields (video_texture);
+
+  /* the upload thread only does what the renderer would, as is */
+  g_mutex_lock (priv->id_lock);
+  priv->uploader_ok = scaled == NULL &&
+                      clutter_helix_video_texture_can_upload_off_thread (video_texture) &&
+                      !clutter_helix_video_texture_needs_tiles (video_texture);
+  g_mutex_unlock (priv->id_lock);
+
+  g_free (scaled);
+
+  /* swapped, the planes are one of the sets of the upload thread, which
+   * keeps all of them */
+  priv->texture_bytes = swapped ? 0 :
+                        clutter_helix_video_format_frame_size (format,
+                                                               priv->cap_width,
+                                                               priv->cap_height);
+  if (priv->uploader)
+    priv->texture_bytes += clutter_helix_uploader_get_size (priv->uploader);
+  if (priv->rgba_cache && !priv->rgba_failed)
+    priv->texture_bytes += priv->width * priv->height * 4;
+  clutter_helix_texture_budget_update (video_texture, priv->texture_bytes);
+
+  return TRUE;
 }
 
-static void
-clutter_helix_video_texture_get_property (GObject    *object, 
-				                                  guint       property_id,
-				                                  GValue     *value, 
-				                                  GParamSpec *pspec)
+/*
+ * Sync group support, see clutter-helix-sync-group.c
+ */
+
+gint64
+clutter_helix_video_texture_get_time (ClutterHelixVideoTexture *video_texture)
 {
-  ClutterHelixVideoTexture *video_texture;
-  ClutterMedia             *media;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gint64 time;
 
-  video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (object);
-  media         = CLUTTER_MEDIA (video_texture);
+  g_mutex_lock (priv->id_lock);
+  time = priv->pos_ms;
+  if (priv->state == PLAYER_STATE_PLAYING)
+    time += (clutter_helix_get_time_us () - priv->pos_time) / 1000;
+  g_mutex_unlock (priv->id_lock);
 
-  switch (property_id)
-    {
-    case PROP_URI:
-      g_value_set_string (value, get_uri (media));
-      break;
-    case PROP_PLAYING:
-      g_value_set_boolean (value, get_playing (media));
-      break;
-    case PROP_PROGRESS:
-      g_value_set_double (value, get_progress (media));
-      break;
-    case PROP_AUDIO_VOLUME:
-      g_value_set_double (value, get_volume (media));
-      break;
-    case PROP_CAN_SEEK:
-      g_value_set_boolean (value, can_seek (media));
-      break;
-    case PROP_BUFFER_FILL:
-      g_value_set_int (value, (gdouble)get_buffer_percent (media)/(gdouble)100);
-      break;
-    case PROP_DURATION:
-      g_value_set_double (value, get_duration (media));
-      break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+  return time;
+}
+
+void
+clutter_helix_video_texture_seek (ClutterHelixVideoTexture *video_texture,
+                                  gint64                    position)
+{
+  set_position (CLUTTER_MEDIA (video_texture), position / 1000.0);
+}
+
+static gboolean
+hold_timeout_func (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  priv->hold_id = 0;
+
+  g_mutex_lock (priv->id_lock);
+  priv->pos_time = clutter_helix_get_time_us ();
+  g_mutex_unlock (priv->id_lock);
+
+  player_begin (priv->player);
+
+  return FALSE;
+}
+
+/* Pauses the decoder for @duration ms, to let the others catch up. Unlike
+ * set_playing() this leaves the renderer alone. */
+void
+clutter_helix_video_texture_hold (ClutterHelixVideoTexture *video_texture,
+                                  guint                     duration)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  if (!priv->player || priv->hold_id > 0 ||
+      priv->state != PLAYER_STATE_PLAYING)
+    return;
+
+  player_pause (priv->player);
+  priv->hold_id = clutter_threads_add_timeout (duration,
+                                               hold_timeout_func,
+                                               video_texture);
+}
+
+void
+clutter_helix_video_texture_set_sync_group (ClutterHelixVideoTexture *video_texture,
+                                            ClutterHelixSyncGroup    *group)
+{
+  video_texture->priv->sync_group = group;
+}
+
+/*
+ * Visibility
+ *
+ * Uploading frames nobody sees is a waste of bus bandwidth, so frames are
+ * only uploaded while the texture or one of its clones can be seen. The
+ * newest frame is kept aside meanwhile and uploaded as soon as something
+ * paints the texture again. Uploading may change the size of the texture,
+ * which can't be done while painting, so painting only queues the upload
+ * for an idle running before the next redraw.
+ */
+
+static gboolean
+clutter_helix_actor_is_visible (ClutterActor *actor)
+{
+  ClutterActor *stage;
+  gfloat x, y, width, height, stage_width, stage_height;
+
+  if (!CLUTTER_ACTOR_IS_MAPPED (actor) ||
+      clutter_actor_get_paint_opacity (actor) == 0)
+    return FALSE;
+
+  stage = clutter_actor_get_stage (actor);
+  if (stage == NULL)
+    return FALSE;
+
+  /* bounding box of the transformed actor against the stage */
+  clutter_actor_get_transformed_position (actor, &x, &y);
+  clutter_actor_get_transformed_size (actor, &width, &height);
+  clutter_actor_get_size (stage, &stage_width, &stage_height);
+
+  if (width < 0)
+    {
+      x += width;
+      width = -width;
+    }
+  if (height < 0)
+    {
+      y += height;
+      height = -height;
     }
+
+  return x < stage_width && y < stage_height &&
+         x + width > 0 && y + height > 0;
 }
 
-static void
-clutter_helix_video_texture_class_init (ClutterHelixVideoTextureClass *klass)
+static gboolean
+clutter_helix_video_texture_is_visible (ClutterHelixVideoTexture *video_texture)
 {
-  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean visible;
+  GSList *l;
 
-  init_main();
-  g_type_class_add_private (klass, sizeof (ClutterHelixVideoTexturePrivate));
+  visible = clutter_helix_actor_is_visible (CLUTTER_ACTOR (video_texture));
+  for (l = priv->clones; l && !visible; l = l->next)
+    visible = clutter_helix_actor_is_visible (l->data);
 
-  object_class->dispose      = clutter_helix_video_texture_dispose;
-  object_class->finalize     = clutter_helix_video_texture_finalize;
-  object_class->set_property = clutter_helix_video_texture_set_property;
-  object_class->get_property = clutter_helix_video_texture_get_property;
+  g_mutex_lock (priv->id_lock);
+  priv->hidden = !visible;
+  g_mutex_unlock (priv->id_lock);
 
-  /* Interface props */
-  g_object_class_override_property (object_class, PROP_URI, "uri");
-  g_object_class_override_property (object_class, PROP_PLAYING, "playing");
-  g_object_class_override_property (object_class, PROP_PROGRESS, "progress");
-  g_object_class_override_property (object_class, PROP_AUDIO_VOLUME, "audio-volume");
-  g_object_class_override_property (object_class, PROP_CAN_SEEK, "can-seek");
-  g_object_class_override_property (object_class, PROP_DURATION, "duration");
-  g_object_class_override_property (object_class, PROP_BUFFER_FILL, "buffer-fill" );
+  return visible;
 }
 
+/* Keeps @frame to upload it once visible again, the frame it replaces is
+ * only worth keeping for stepping. */
 static void
-on_buffering_cb (unsigned int   flags,
-		             unsigned short percentage,
-		             void          *context)
+clutter_helix_video_texture_park_frame (ClutterHelixVideoTexture *video_texture,
+                                        ClutterHelixFrame        *frame)
 {
-  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)context;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *stale;
 
-  if (video_texture && video_texture->priv)
-    video_texture->priv->buffer_percent = percentage;
-  
-  g_object_notify (G_OBJECT (video_texture), "buffer-fill");
+  g_mutex_lock (priv->id_lock);
+  stale = priv->hidden_frame;
+  priv->hidden_frame = frame;
+  priv->skipped_uploads++;
+  g_mutex_unlock (priv->id_lock);
+
+  if (stale)
+    clutter_helix_frame_cache_insert (priv->step_cache, stale);
 }
 
 static gboolean
-emit_eos_idle_func(gpointer data)
+flush_hidden_idle_func (gpointer data)
 {
-  if (!data)
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  ClutterHelixFrame *frame;
+
+  priv->flush_id = 0;
+
+  /* painted while still out of the stage does not count */
+  if (!clutter_helix_video_texture_is_visible (video_texture))
     return FALSE;
 
-  ClutterHelixVideoTexture *vtexture = (ClutterHelixVideoTexture *)data;
-  g_signal_emit_by_name (CLUTTER_MEDIA(vtexture), "eos");
+  g_mutex_lock (priv->id_lock);
+  frame = priv->hidden_frame;
+  priv->hidden_frame = NULL;
+  g_mutex_unlock (priv->id_lock);
+
+  if (frame)
+    {
+      clutter_helix_video_texture_upload_frame (video_texture, frame);
+      clutter_helix_frame_cache_insert (priv->step_cache, frame);
+    }
+
   return FALSE;
 }
 
-/* May get called with a mutex held in helix */
-static void
-on_pos_length_cb (unsigned int pos, unsigned int ulLength, void *context)
+/* Called when painting the texture or a clone: queues the upload of the
+ * frame parked while hidden, if any */
+void
+clutter_helix_video_texture_queue_flush_hidden (ClutterHelixVideoTexture *video_texture)
 {
-  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)context;
-  ClutterHelixVideoTexturePrivate *priv;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gboolean parked;
 
-  priv = video_texture->priv;
+  g_mutex_lock (priv->id_lock);
+  parked = (priv->hidden_frame != NULL);
+  g_mutex_unlock (priv->id_lock);
 
-  if (!priv->player)
+  if (parked && priv->flush_id == 0)
+    priv->flush_id = clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                                    flush_hidden_idle_func,
+                                                    video_texture,
+                                                    NULL);
+}
+
+/*
+ * Downscale on ingest
+ *
+ * A texture painted much smaller than the stream does not need all its
+ * pixels. Frames get halved on the CPU, plane by plane, until just larger
+ * than the largest on screen size of the texture and its clones. Sizes are
+ * quantized to powers of two: growing happens at once, shrinking only once
+ * the actor has been small for DISPLAY_SHRINK_DELAY frames, so that zoom
+ * animations don't reallocate textures on every frame.
+ */
+
+static gboolean
+regrow_idle_func (gpointer data)
+{
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+
+  priv->regrow_id = 0;
+
+  if (priv->last_frame)
+    clutter_helix_video_texture_upload_frame (video_texture, priv->last_frame);
+
+  return FALSE;
+}
+
+/* Called when @actor, the texture or one of its clones, gets painted */
+void
+clutter_helix_video_texture_painted (ClutterHelixVideoTexture *video_texture,
+                                     ClutterActor             *actor)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  gfloat width, height;
+
+  clutter_helix_texture_budget_touch (video_texture);
+
+  if (!priv->auto_downscale)
     return;
 
-  /**
-   * Determine the duration.
-   **/
-  int new_duration = ulLength / 1000;
-  if (priv->duration != new_duration)
+  clutter_actor_get_transformed_size (actor, &width, &height);
+  priv->painted_width  = MAX (priv->painted_width, ABS (width));
+  priv->painted_height = MAX (priv->painted_height, ABS (height));
+
+  /* zoomed in while paused, no new frame will come to fix the blur */
+  if (priv->display_shift > 0 &&
+      (priv->painted_width > priv->width ||
+       priv->painted_height > priv->height) &&
+      priv->state != PLAYER_STATE_PLAYING &&
+      priv->regrow_id == 0)
+    priv->regrow_id = clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                                     regrow_idle_func,
+                                                     video_texture,
+                                                     NULL);
+}
+
+static guint
+clutter_helix_video_texture_display_shift (ClutterHelixVideoTexture *video_texture)
+{
+  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
+  guint wanted = 0;
+
+  if (!priv->auto_downscale)
+    return 0;
+
+  /* not painted since the last upload, nothing new to go by */
+  if (priv->painted_width <= 0 || priv->painted_height <= 0)
+    return priv->display_shift;
+
+  while (wanted < MAX_DISPLAY_SHIFT &&
+         (priv->stream_width >> (wanted + 1)) >= priv->painted_width &&
+         (priv->stream_height >> (wanted + 1)) >= priv->painted_height)
+    wanted++;
+
+  if (wanted < priv->display_shift)
     {
-      priv->duration = new_duration;
-      g_object_notify (G_OBJECT (video_texture), "duration");
+      priv->display_shift = wanted;
+      priv->shrink_count = 0;
+    }
+  else if (wanted > priv->display_shift)
+    {
+      if (++priv->shrink_count >= DISPLAY_SHRINK_DELAY)
+        {
+          priv->display_shift = wanted;
+          priv->shrink_count = 0;
+        }
     }
+  else
+    priv->shrink_count = 0;
 
-  if (pos >= ulLength)
-    clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
-				                           emit_eos_idle_func,
-				                           video_texture,
-				                           NULL);
+  priv->painted_width = priv->painted_height = 0;
+
+  return priv->display_shift;
 }
 
-/* Probably gets called with a mutex held in helix */
 static void
-on_state_change_cb (unsigned short old_state,
-                    unsigned short new_state,
-                    void          *context)
+clutter_helix_video_texture_paint (ClutterActor *actor)
 {
-  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)context;
-  ClutterHelixVideoTexturePrivate *priv;
+  ClutterHelixVideoTexture *video_texture = CLUTTER_HELIX_VIDEO_TEXTURE (actor);
 
-  priv = video_texture->priv;
+  clutter_helix_video_texture_painted (video_texture, actor);
 
-  if (!priv->player)
-    return;
+  clutter_helix_video_texture_queue_flush_hidden (video_texture);
 
-  priv->state = new_state;
-  priv->can_seek  = player_canseek (priv->player);
+  if (video_texture->priv->atlas_slot &&
+      video_texture->priv->renderer_state == CLUTTER_HELIX_RENDERER_RUNNING)
+    {
+      ClutterActorBox box;
+
+      clutter_actor_get_allocation_box (actor, &box);
+      clutter_helix_atlas_slot_paint (video_texture->priv->atlas_slot,
+                                      0, 0,
+                                      box.x2 - box.x1,
+                                      box.y2 - box.y1,
+                                      clutter_actor_get_paint_opacity (actor));
+      return;
+    }
 
-  g_object_notify (G_OBJECT (video_texture), "can-seek");
-}
+  if (video_texture->priv->renderer_state == CLUTTER_HELIX_RENDERER_RUNNING &&
+      video_texture->priv->renderer->paint)
+    {
+      ClutterActorBox box;
+
+      clutter_actor_get_allocation_box (actor, &box);
+      video_texture->priv->renderer->paint (video_texture,
+                                            0, 0,
+                                            box.x2 - box.x1,
+                                            box.y2 - box.y1,
+                                            clutter_actor_get_paint_opacity (actor));
+      return;
+    }
 
-static ClutterHelixRenderer *
-clutter_helix_find_renderer_by_format (ClutterHelixVideoTexture *video_texture,
-                                       ClutterHelixVideoFormat   format)
-{
-  ClutterHelixVideoTexturePrivate *priv = video_texture->priv;
-  ClutterHelixRenderer *renderer = NULL;
-  GSList *element;
+  /* the renderer's paint handler already ran, the shader gets unbound */
+  if (clutter_helix_video_texture_convert_rgba (video_texture))
+    {
+      ClutterActorBox box;
+
+      clutter_actor_get_allocation_box (actor, &box);
+      clutter_helix_video_texture_paint_rgba (video_texture,
+                                              0, 0,
+                                              box.x2 - box.x1,
+                                              box.y2 - box.y1,
+                                              clutter_actor_get_paint_opacity (actor));
+      return;
+    }
 
-  for (element = priv->renderers; element; element = g_slist_next(element))
+  /* the frame only covers part of the textures, or is split in tiles */
+  if ((video_texture->priv->tex_s < 1.0 || video_texture->priv->tex_t < 1.0 ||
+       video_texture->priv->tiles) &&
+      video_texture->priv->renderer_state == CLUTTER_HELIX_RENDERER_RUNNING)
     {
-      ClutterHelixRenderer *candidate = (ClutterHelixRenderer *)element->data;
+      ClutterActorBox box;
+      CoglHandle material;
+      guint8 opacity;
+
+      material = clutter_texture_get_cogl_material (CLUTTER_TEXTURE (actor));
+      opacity = clutter_actor_get_paint_opacity (actor);
+      clutter_actor_get_allocation_box (actor, &box);
 
-      if (candidate->format == format)
+      cogl_material_set_color4ub (material, opacity, opacity, opacity, opacity);
+      if (video_texture->priv->tiles)
         {
-          renderer = candidate;
-          break;
+          clutter_helix_video_texture_paint_tiles (video_texture, material,
+                                                   0, 0,
+                                                   box.x2 - box.x1,
+                                                   box.y2 - box.y1);
+          return;
         }
+
+      cogl_set_source (material);
+      cogl_rectangle_with_texture_coords (0, 0,
+                                          box.x2 - box.x1, box.y2 - box.y1,
+                                          0, 0,
+                                          video_texture->priv->tex_s,
+                                          video_texture->priv->tex_t);
+      return;
+    }
+
+  CLUTTER_ACTOR_CLASS (clutter_helix_video_texture_parent_class)->paint (actor);
+}
+
+/* Report the size of the stream, whatever the size of the textures */
+static void
+clutter_helix_video_texture_get_preferred_width (ClutterActor *actor,
+                                                 gfloat        for_height,
+                                                 gfloat       *min_width_p,
+                                                 gfloat       *natural_width_p)
+{
+  ClutterHelixVideoTexturePrivate *priv = CLUTTER_HELIX_VIDEO_TEXTURE (actor)->priv;
+
+  if (priv->stream_width == 0 ||
+      !clutter_texture_get_sync_size (CLUTTER_TEXTURE (actor)))
+    {
+      CLUTTER_ACTOR_CLASS (clutter_helix_video_texture_parent_class)->
+        get_preferred_width (actor, for_height, min_width_p, natural_width_p);
+      return;
     }
 
-  return renderer;
+  if (min_width_p)
+    *min_width_p = 0;
+  if (natural_width_p)
+    *natural_width_p = priv->stream_width;
+}
+
+static void
+clutter_helix_video_texture_get_preferred_height (ClutterActor *actor,
+                                                  gfloat        for_width,
+                                                  gfloat       *min_height_p,
+                                                  gfloat       *natural_height_p)
+{
+  ClutterHelixVideoTexturePrivate *priv = CLUTTER_HELIX_VIDEO_TEXTURE (actor)->priv;
+
+  if (priv->stream_height == 0 ||
+      !clutter_texture_get_sync_size (CLUTTER_TEXTURE (actor)))
+    {
+      CLUTTER_ACTOR_CLASS (clutter_helix_video_texture_parent_class)->
+        get_preferred_height (actor, for_width, min_height_p, natural_height_p);
+      return;
+    }
+
+  if (min_height_p)
+    *min_height_p = 0;
+  if (natural_height_p)
+    *natural_height_p = priv->stream_height;
 }
 
 static gboolean
 clutter_helix_video_render_idle_func (gpointer data)
 {
-  GError *error;
-  unsigned char *buffer;
-  gint cid;
+  ClutterHelixFrame *frame;
   ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)data;
   ClutterHelixVideoTexturePrivate *priv;
 
   priv = video_texture->priv;
 
   g_mutex_lock (priv->id_lock);
-  buffer = priv->buffer;
-  priv->buffer = NULL;
-  if (buffer == NULL) 
+  frame = priv->frame;
+  priv->frame = NULL;
+  if (frame == NULL) 
     {
       priv->idle_id = 0;
       g_mutex_unlock (priv->id_lock);
@@ -1171,65 +6019,35 @@ clutter_helix_video_render_idle_func (gpointer data)
     }
   g_mutex_unlock (priv->id_lock);
 
-  error = NULL;
-  if (priv->renderer == NULL) 
+  /* ahead of the sync group timeline, hold the frame until it gets there */
+  if (priv->sync_group)
     {
-      ClutterHelixVideoFormat format = CLUTTER_HELIX_NOFORMAT;
-      cid = priv->cid;
-      if (cid == CID_ARGB32)
-        {
-          format = CLUTTER_HELIX_RGB32;
-        }
-      else if (cid == CID_I420)
-        {
-          format = CLUTTER_HELIX_I420;
-        }
-      else if (cid == CID_LIBVA)
-        {
-          /* TODO: Add implementation to perform libva blitting */
-        }
-      else {
-          g_warning ("Unsupported colorspace id:%d", cid);
-        }
-
-      if (format == CLUTTER_HELIX_NOFORMAT)
-        {
-          g_mutex_lock (priv->id_lock);
-          priv->idle_id = 0;
-          g_mutex_unlock (priv->id_lock);
-          free (buffer);
-          return FALSE;
-        }
-
-      priv->renderer =  clutter_helix_find_renderer_by_format (video_texture,
-                                                               format);
+      guint delay;
 
-      if (priv->renderer == NULL)
+      delay = clutter_helix_sync_group_get_delay (priv->sync_group,
+                                                  frame->timestamp);
+      if (delay > 0)
         {
-          g_warning ("No renderer for format:%d\n", format);
           g_mutex_lock (priv->id_lock);
-          priv->idle_id = 0;
+          priv->frame = frame;
+          priv->idle_id =
+            clutter_threads_add_timeout_full (G_PRIORITY_HIGH,
+                                              delay,
+                                              clutter_helix_video_render_idle_func,
+                                              video_texture,
+                                              NULL);
           g_mutex_unlock (priv->id_lock);
-          free (buffer);
           return FALSE;
         }
     }
 
-  /* The initialization / free functions of the renderers have to be called in
-   * the clutter thread (OpenGL context) */
-  if (G_UNLIKELY (priv->renderer_state == CLUTTER_HELIX_RENDERER_NEED_GC))
-    {
-      priv->renderer->deinit (video_texture);
-      priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
-    }
-  if (G_UNLIKELY (priv->renderer_state == CLUTTER_HELIX_RENDERER_STOPPED))
+  if (clutter_helix_video_texture_is_visible (video_texture))
     {
-      priv->renderer->init (video_texture);
-      priv->renderer_state = CLUTTER_HELIX_RENDERER_RUNNING;
+      clutter_helix_video_texture_upload_frame (video_texture, frame);
+      clutter_helix_frame_cache_insert (priv->step_cache, frame);
     }
-
-  priv->renderer->upload (video_texture, buffer);
-  free (buffer);
+  else
+    clutter_helix_video_texture_park_frame (video_texture, frame);
 
   g_mutex_lock (priv->id_lock);
   priv->idle_id = 0;
@@ -1243,8 +6061,12 @@ static void on_new_frame_cb(unsigned char *p,
                             PlayerImgInfo *Info,
                             void          *context)
 {
-  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)context;
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)slot->owner;
   ClutterHelixVideoTexturePrivate *priv;
+  ClutterHelixFrame *frame;
+  ClutterHelixUploadPlane planes[CLUTTER_HELIX_UPLOAD_MAX_PLANES];
+  guint n_planes;
 
   priv = video_texture->priv;
   
@@ -1252,19 +6074,129 @@ static void on_new_frame_cb(unsigned char *p,
     return;
 
   g_mutex_lock (priv->id_lock);
-  if (priv->idle_id ==0) 
-    {
-      priv->buffer = p; 
-      priv->width = Info->cx;
-      priv->height = Info->cy;
-      priv->cid = Info->cid;
-      priv->idle_id = clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
-                                               clutter_helix_video_render_idle_func,
-                                                     video_texture,
-                                                     NULL);
-      } else {
+  if (slot != priv->active)
+    {
+      /* prerolling the next item: keep its first frame and park the player */
+      if (priv->next_uri && priv->next_frame == NULL)
+        {
+          priv->next_frame = clutter_helix_video_texture_new_frame (video_texture,
+                                                                    p, size,
+                                                                    Info);
+          priv->preroll_id =
+            clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                           preroll_pause_idle_func,
+                                           video_texture,
+                                           NULL);
+        }
+      else
         free (p);
-      }
+    }
+  else if (priv->loop_decoded++ < priv->loop_shown)
+    {
+      /* already shown from memory while the decoder restarted, see
+       * loop_replay_func() */
+      free (p);
+    }
+  else if (priv->trick_fast)
+    {
+      /* seeking along at a high rate: keep the frame the seek landed on and
+       * drop the ones decoded after it, see trick_timeout_func() */
+      if (priv->trick_pending)
+        {
+          priv->trick_pending = FALSE;
+
+          frame = clutter_helix_video_texture_new_frame (video_texture,
+                                                         p, size, Info);
+          frame->timestamp = priv->pos_ms;
+
+          clutter_helix_frame_free (priv->frame);
+          priv->frame = frame;
+          if (priv->idle_id == 0)
+            priv->idle_id =
+              clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                             clutter_helix_video_render_idle_func,
+                                             video_texture,
+                                             NULL);
+          if (priv->trick_pause_id == 0)
+            priv->trick_pause_id =
+              clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                             trick_pause_idle_func,
+                                             video_texture,
+                                             NULL);
+        }
+      else
+        free (p);
+    }
+  else if (priv->step_end >= 0)
+    {
+      /* decoding around a step target, see clutter_helix_video_texture_step() */
+      frame = clutter_helix_video_texture_new_frame (video_texture,
+                                                     p, size, Info);
+      frame->timestamp = clutter_helix_video_texture_frame_time (video_texture);
+
+      if (frame->timestamp >= priv->step_end)
+        priv->step_end = -1;
+
+      if ((frame->timestamp >= priv->step_target && !priv->step_reached) ||
+          priv->step_end < 0)
+        {
+          priv->step_reached = TRUE;
+          if (priv->step_id == 0)
+            priv->step_id =
+              clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                             step_idle_func,
+                                             video_texture,
+                                             NULL);
+        }
+
+      clutter_helix_frame_cache_insert (priv->step_cache, frame);
+    }
+  else
+    {
+      /* the head cache only makes sense if it starts with the first frame */
+      if (!priv->head_complete)
+        {
+          if (priv->loop)
+            clutter_helix_video_texture_cache_head (video_texture,
+                                                    p, size, Info);
+          else
+            priv->head_complete = TRUE;
+        }
+
+      frame = clutter_helix_video_texture_new_frame (video_texture,
+                                                     p, size, Info);
+      frame->timestamp = clutter_helix_video_texture_frame_time (video_texture);
+
+      if (priv->hidden && priv->drop_hidden)
+        {
+          /* nobody looks, don't even bother the clutter thread */
+          clutter_helix_frame_free (priv->hidden_frame);
+          priv->hidden_frame = frame;
+          priv->skipped_uploads++;
+        }
+      else if (priv->uploader_ok && !priv->hidden &&
+               (n_planes = clutter_helix_video_texture_upload_planes (frame,
+                                                                      planes)))
+        {
+          /* on to the clutter thread once uploaded, see
+           * clutter_helix_video_texture_uploaded_cb() */
+          frame = clutter_helix_uploader_push (priv->uploader, frame,
+                                               planes, n_planes);
+          if (frame)
+            clutter_helix_frame_cache_insert (priv->step_cache, frame);
+        }
+      else if (priv->idle_id ==0) 
+        {
+          priv->frame = frame;
+          priv->idle_id = clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                                   clutter_helix_video_render_idle_func,
+                                                         video_texture,
+                                                         NULL);
+        } else {
+          /* not shown, but still worth keeping for stepping */
+          clutter_helix_frame_cache_insert (priv->step_cache, frame);
+        }
+    }
   g_mutex_unlock (priv->id_lock);
 }
 
@@ -1274,7 +6206,21 @@ on_error_cb (unsigned long code,
              void         *context)
 {
   GError *error;
-  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)context;
+  ClutterHelixPlayerSlot *slot = (ClutterHelixPlayerSlot *)context;
+  ClutterHelixVideoTexture *video_texture = (ClutterHelixVideoTexture *)slot->owner;
+  gboolean active;
+
+  g_mutex_lock (video_texture->priv->id_lock);
+  active = (slot == video_texture->priv->active);
+  g_mutex_unlock (video_texture->priv->id_lock);
+
+  if (!active)
+    {
+      g_warning ("Failed to preroll %s: %s",
+                 video_texture->priv->next_uri, message);
+      slot->failed = TRUE;
+      return;
+    }
 
   error = g_error_new (g_quark_from_string ("clutter-helix"),
                        (int) code,
@@ -1299,11 +6245,29 @@ tick_timeout (ClutterHelixVideoTexture *video_texture)
   return TRUE;
 }
 
+/* Whether @name is in the comma separated list of renderers @wanted */
+static gboolean
+clutter_helix_renderer_is_wanted (gchar       **wanted,
+                                  const gchar  *name)
+{
+  guint i;
+
+  for (i = 0; wanted[i]; i++)
+    if (g_ascii_strcasecmp (g_strstrip (wanted[i]), name) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Also sets @atlas_features, the features the atlas gets to use */
 static GSList *
-clutter_helix_build_renderers_list (ClutterHelixSymbols *syms)
+clutter_helix_build_renderers_list (ClutterHelixSymbols *syms,
+                                    gint                *atlas_features)
 {
   GSList             *list = NULL;
   const gchar        *gl_extensions;
+  const gchar        *env;
+  gchar             **wanted = NULL;
   GLint               nb_texture_units = 0;
   gint                features = 0;
   gint                i;
@@ -1314,9 +6278,40 @@ clutter_helix_build_renderers_list (ClutterHelixSymbols *syms)
   ClutterHelixRenderer *renderers[] =
   {
     &rgb32_renderer,
+#ifndef HAVE_COGL_GLES2
+    &i420_core_renderer,
+#ifdef CID_NV12
+    &nv12_core_renderer,
+#endif
+#endif
     &i420_glsl_renderer,
+#ifdef CID_NV12
+    &nv12_glsl_renderer,
+#endif
+#ifdef CID_YUY2
+    &yuy2_glsl_renderer,
+#endif
+#ifdef CID_UYVY
+    &uyvy_glsl_renderer,
+#endif
+#ifdef CID_YUVA
+    &yuva_glsl_renderer,
+#endif
+#ifdef CID_I420_10
+    &i420_10_narrow_renderer,
+#ifdef CLUTTER_COGL_HAS_GL
+    &i420_16_glsl_renderer,
+#endif
+#endif
 #ifdef CLUTTER_COGL_HAS_GL
     &i420_fp_renderer,
+#endif
+#ifdef HAVE_COGL_GLES2
+    /* native GLES2 rather than through the Cogl wrapper shaders */
+    &i420_core_renderer,
+#ifdef CID_NV12
+    &nv12_core_renderer,
+#endif
 #endif
     NULL
   };
@@ -1328,6 +6323,8 @@ clutter_helix_build_renderers_list (ClutterHelixSymbols *syms)
 
   if (nb_texture_units >= 3)
     features |= CLUTTER_HELIX_MULTI_TEXTURE;
+  if (nb_texture_units >= 4)
+    features |= CLUTTER_HELIX_MULTI_TEXTURE_4;
 
 #ifdef CLUTTER_COGL_HAS_GL
   if (cogl_check_extension ("GL_ARB_fragment_program", gl_extensions))
@@ -1354,14 +6351,39 @@ clutter_helix_build_renderers_list (ClutterHelixSymbols *syms)
   if (cogl_features_available (COGL_FEATURE_SHADERS_GLSL))
     features |= CLUTTER_HELIX_GLSL;
 
+  if (clutter_helix_core_program_available ())
+    features |= CLUTTER_HELIX_GL_CORE;
+
+#ifdef CLUTTER_COGL_HAS_GL
+  /* GL_LUMINANCE16 is core in desktop GL, GLES has no 16 bit formats */
+  features |= CLUTTER_HELIX_TEXTURE_16;
+#endif
+
+  /* to compare the renderers on a given GL, software rasterizers included */
+  env = g_getenv ("CLUTTER_HELIX_RENDERER");
+  if (env && *env)
+    wanted = g_strsplit (env, ",", 0);
+
   for (i = 0; renderers[i]; i++)
     {
       gint needed = renderers[i]->flags;
 
+      if (wanted && !clutter_helix_renderer_is_wanted (wanted, renderers[i]->name))
+        continue;
+
       if ((needed & features) == needed) 
         list = g_slist_prepend (list, renderers[i]);
     }
 
+  /* not in the list, see clutter_helix_video_texture_choose_atlas() */
+  if (wanted && !clutter_helix_renderer_is_wanted (wanted,
+                                                   i420_atlas_renderer.name))
+    *atlas_features = 0;
+  else
+    *atlas_features = features;
+
+  g_strfreev (wanted);
+
   return list;
 }
 
@@ -1369,14 +6391,6 @@ static void
 clutter_helix_video_texture_init (ClutterHelixVideoTexture *video_texture)
 {
   ClutterHelixVideoTexturePrivate *priv;
-  PlayerCallbacks callbacks = 
-  {
-    on_pos_length_cb,
-    on_buffering_cb,
-    on_state_change_cb,
-    on_new_frame_cb,
-    on_error_cb
-  };
 
   video_texture->priv  = priv =
     G_TYPE_INSTANCE_GET_PRIVATE (video_texture,
@@ -1385,10 +6399,48 @@ clutter_helix_video_texture_init (ClutterHelixVideoTexture *video_texture)
 
   priv->id_lock = g_mutex_new();
 
-  priv->renderers = clutter_helix_build_renderers_list (&priv->syms);
+  priv->head_frames       = g_queue_new ();
+  priv->loop_cache_frames = DEFAULT_LOOP_CACHE_FRAMES;
+  priv->loop_cache_size   = DEFAULT_LOOP_CACHE_SIZE;
+  priv->step_cache        = clutter_helix_frame_cache_new (0);
+  priv->step_cache_size   = DEFAULT_STEP_CACHE_SIZE;
+  priv->step_end          = -1;
+  priv->frame_interval    = DEFAULT_FRAME_INTERVAL;
+  priv->rate              = 1.0;
+  priv->mute_trick_play   = TRUE;
+  priv->trick_volume      = -1;
+  priv->tex_s             = 1.0;
+  priv->tex_t             = 1.0;
+  priv->programs          = g_hash_table_new_full (g_direct_hash,
+                                                   g_direct_equal,
+                                                   NULL,
+                                                   (GDestroyNotify) cogl_program_unref);
+  priv->core_programs     = g_hash_table_new_full (g_direct_hash,
+                                                   g_direct_equal,
+                                                   NULL,
+                                                   (GDestroyNotify) clutter_helix_core_program_free);
+  priv->color_variant     = -1;
+  priv->contrast          = 1.0;
+  priv->saturation        = 1.0;
+  clutter_helix_video_texture_compute_colors (video_texture);
+
+  priv->renderers = clutter_helix_build_renderers_list (&priv->syms,
+                                                        &priv->atlas_features);
   priv->renderer_state = CLUTTER_HELIX_RENDERER_STOPPED;
+  clutter_helix_video_texture_negotiate_format (video_texture);
+
+  clutter_helix_texture_budget_add (video_texture,
+                                    clutter_helix_video_texture_evict);
+  priv->auto_downscale = FALSE;
+
+  g_signal_connect (video_texture, "size-change",
+                    G_CALLBACK (clutter_helix_video_texture_size_change_cb),
+                    NULL);
 
-  get_player(&priv->player, &callbacks, (void *)video_texture);
+  priv->active  = &priv->slots[0];
+  priv->preroll = &priv->slots[1];
+  clutter_helix_video_texture_open_player (video_texture, priv->active);
+  priv->player = priv->active->player;
 }
 
 
@@ -1405,9 +6457,6 @@ clutter_helix_video_texture_new (void)
   if(!getenv("HELIX_LIBS"))
     setenv("HELIX_LIBS" , "/opt/real/RealPlayer", 0);
 
-  return g_object_new (CLUTTER_HELIX_TYPE_VIDEO_TEXTURE,
-            "disable-slicing",
-            TRUE,
-            NULL);
+  return g_object_new (CLUTTER_HELIX_TYPE_VIDEO_TEXTURE, NULL);
 }
 
@@ -99,9 +99,72 @@ struct _ClutterHelixVideoTextureClass
   void (* _clutter_reserved6) (void);
 }; 
 
+/**
+ * ClutterHelixColorMatrix:
+ * @CLUTTER_HELIX_COLOR_AUTO: BT.709 for streams 720 lines high or more,
+ *   BT.601 otherwise
+ * @CLUTTER_HELIX_COLOR_BT601: ITU-R BT.601, standard definition
+ * @CLUTTER_HELIX_COLOR_BT709: ITU-R BT.709, high definition
+ *
+ * The YUV to RGB conversion, see #ClutterHelixVideoTexture:color-matrix.
+ */
+typedef enum _ClutterHelixColorMatrix
+{
+  CLUTTER_HELIX_COLOR_AUTO,
+  CLUTTER_HELIX_COLOR_BT601,
+  CLUTTER_HELIX_COLOR_BT709
+} ClutterHelixColorMatrix;
+
+#define CLUTTER_HELIX_TYPE_COLOR_MATRIX clutter_helix_color_matrix_get_type()
+
+GType         clutter_helix_color_matrix_get_type     (void) G_GNUC_CONST;
+
+/**
+ * ClutterHelixDeinterlace:
+ * @CLUTTER_HELIX_DEINTERLACE_NONE: frames are shown as decoded
+ * @CLUTTER_HELIX_DEINTERLACE_BOB: each field in turn, at twice the frame
+ *   rate, its missing lines interpolated
+ * @CLUTTER_HELIX_DEINTERLACE_BLEND: each line blended with its neighbours
+ *
+ * How interlaced frames are shown, see
+ * #ClutterHelixVideoTexture:deinterlace.
+ */
+typedef enum _ClutterHelixDeinterlace
+{
+  CLUTTER_HELIX_DEINTERLACE_NONE,
+  CLUTTER_HELIX_DEINTERLACE_BOB,
+  CLUTTER_HELIX_DEINTERLACE_BLEND
+} ClutterHelixDeinterlace;
+
+#define CLUTTER_HELIX_TYPE_DEINTERLACE clutter_helix_deinterlace_get_type()
+
+GType         clutter_helix_deinterlace_get_type      (void) G_GNUC_CONST;
+
+/**
+ * ClutterHelixFieldOrder:
+ * @CLUTTER_HELIX_FIELD_ORDER_TOP_FIRST: the field of the top line comes
+ *   first in time
+ * @CLUTTER_HELIX_FIELD_ORDER_BOTTOM_FIRST: the other one comes first
+ *
+ * The field order of interlaced frames, see
+ * #ClutterHelixVideoTexture:field-order.
+ */
+typedef enum _ClutterHelixFieldOrder
+{
+  CLUTTER_HELIX_FIELD_ORDER_TOP_FIRST,
+  CLUTTER_HELIX_FIELD_ORDER_BOTTOM_FIRST
+} ClutterHelixFieldOrder;
+
+#define CLUTTER_HELIX_TYPE_FIELD_ORDER clutter_helix_field_order_get_type()
+
+GType         clutter_helix_field_order_get_type      (void) G_GNUC_CONST;
+
 GType         clutter_helix_video_texture_get_type    (void) G_GNUC_CONST;
 ClutterActor *clutter_helix_video_texture_new         (void);
 
+void          clutter_helix_video_texture_step        (ClutterHelixVideoTexture *video_texture,
+                                                       gint                      n_frames);
+
 
 G_END_DECLS
 
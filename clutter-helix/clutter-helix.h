@@ -4,7 +4,9 @@
 #include <clutter/clutter.h>
 
 #include "clutter-helix-video-texture.h"
+#include "clutter-helix-video-clone.h"
 #include "clutter-helix-audio.h"
+#include "clutter-helix-sync-group.h"
 #include "clutter-helix-util.h"
 #include "clutter-helix-version.h"
 
@@ -0,0 +1,200 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * upload-bench.c - Measures how regularly the stage gets painted while a
+ * video plays, with the frames uploaded from the clutter thread or from an
+ * upload thread.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* A rectangle spins over the video; the time between two of its frames is
+ * the main loop jitter a user would see. Uploads are slowest with a software
+ * GL, where they are plain memcpy()s, so compare under llvmpipe:
+ *
+ *   LIBGL_ALWAYS_SOFTWARE=1 ./upload-bench movie.mp4
+ *   LIBGL_ALWAYS_SOFTWARE=1 ./upload-bench --upload-thread movie.mp4
+ *
+ * There are no reference numbers: the gain of the upload thread depends on
+ * the driver, the stream and the machine, run both on the target before
+ * turning it on.
+ *
+ * --renderer picks the renderers to choose from, as CLUTTER_HELIX_RENDERER
+ * does, e.g. to check the core ones on the Mesa software rasterizers:
+ *
+ *   LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe ./upload-bench --renderer "I420 core" movie.mp4
+ *   LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=softpipe ./upload-bench --renderer "I420 core" movie.mp4
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include <clutter/clutter.h>
+#include <clutter-helix/clutter-helix.h>
+
+typedef struct _Bench
+{
+  GTimer  *timer;
+  gdouble  last;
+  GArray  *intervals;   /* in ms */
+} Bench;
+
+static gboolean  upload_thread = FALSE;
+static gint      duration      = 10;
+static gchar    *renderer      = NULL;
+
+static GOptionEntry entries[] =
+{
+  { "upload-thread", 'u', 0, G_OPTION_ARG_NONE, &upload_thread,
+    "Upload the frames from a thread of their own", NULL },
+  { "duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+    "Seconds to measure for (default: 10)", "SECONDS" },
+  { "renderer", 'r', 0, G_OPTION_ARG_STRING, &renderer,
+    "Comma separated renderers to choose from (default: all)", "NAMES" },
+  { NULL }
+};
+
+static void
+new_frame_cb (ClutterTimeline *timeline,
+              gint             msecs,
+              Bench           *bench)
+{
+  gdouble now = g_timer_elapsed (bench->timer, NULL) * 1000.0;
+
+  if (bench->last > 0)
+    {
+      gdouble interval = now - bench->last;
+      g_array_append_val (bench->intervals, interval);
+    }
+  bench->last = now;
+}
+
+static gboolean
+done_cb (gpointer data)
+{
+  Bench *bench = data;
+  gdouble mean = 0, variance = 0, max = 0, interval;
+  guint i, late = 0, n = bench->intervals->len;
+
+  if (n == 0)
+    {
+      g_print ("no frames painted\n");
+      clutter_main_quit ();
+      return FALSE;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      interval = g_array_index (bench->intervals, gdouble, i);
+      mean += interval;
+      max = MAX (max, interval);
+    }
+  mean /= n;
+
+  for (i = 0; i < n; i++)
+    {
+      interval = g_array_index (bench->intervals, gdouble, i);
+      variance += (interval - mean) * (interval - mean);
+      if (interval > 2 * mean)
+        late++;
+    }
+  variance /= n;
+
+  g_print ("upload thread: %s\n", upload_thread ? "yes" : "no");
+  g_print ("renderers:     %s\n", renderer ? renderer : "all");
+  g_print ("frames:        %u\n", n + 1);
+  g_print ("interval:      %.2f ms mean, %.2f ms stddev, %.2f ms max\n",
+           mean, sqrt (variance), max);
+  g_print ("late frames:   %u (over twice the mean)\n", late);
+
+  clutter_main_quit ();
+
+  return FALSE;
+}
+
+int
+main (int argc, char *argv[])
+{
+  ClutterTimeline *timeline;
+  ClutterActor *stage, *vtexture, *rect;
+  ClutterColor stage_color = { 0x00, 0x00, 0x00, 0x00 };
+  ClutterColor rect_color = { 0xff, 0xff, 0xff, 0x99 };
+  GError *error = NULL;
+  Bench bench = { 0, };
+
+  if (clutter_init_with_args (&argc, &argv, "FILE - upload benchmark",
+                              entries, NULL, &error) != CLUTTER_INIT_SUCCESS)
+    {
+      g_warning ("%s", error ? error->message : "could not initialise clutter");
+      return EXIT_FAILURE;
+    }
+
+  if (argc < 2)
+    {
+      g_print ("Usage: %s [--upload-thread] [--duration SECONDS] "
+               "[--renderer NAMES] FILE\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  /* read when the video texture gets created */
+  if (renderer)
+    g_setenv ("CLUTTER_HELIX_RENDERER", renderer, TRUE);
+
+  stage = clutter_stage_get_default ();
+  clutter_stage_set_color (CLUTTER_STAGE (stage), &stage_color);
+  clutter_actor_set_size (stage, 640, 480);
+
+  vtexture = clutter_helix_video_texture_new ();
+  g_object_set (vtexture, "upload-thread", upload_thread, NULL);
+  clutter_actor_set_size (vtexture, 640, 480);
+  clutter_container_add_actor (CLUTTER_CONTAINER (stage), vtexture);
+
+  rect = clutter_rectangle_new_with_color (&rect_color);
+  clutter_actor_set_size (rect, 100, 100);
+  clutter_actor_set_position (rect, 270, 190);
+  clutter_actor_set_anchor_point (rect, 50, 50);
+  clutter_container_add_actor (CLUTTER_CONTAINER (stage), rect);
+
+  timeline = clutter_timeline_new (1000);
+  clutter_timeline_set_loop (timeline, TRUE);
+  clutter_behaviour_apply (clutter_behaviour_rotate_new (clutter_alpha_new_full (timeline, CLUTTER_LINEAR),
+                                                         CLUTTER_Z_AXIS,
+                                                         CLUTTER_ROTATE_CW,
+                                                         0.0, 360.0),
+                           rect);
+
+  bench.timer = g_timer_new ();
+  bench.intervals = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  g_signal_connect (timeline, "new-frame", G_CALLBACK (new_frame_cb), &bench);
+
+  clutter_media_set_filename (CLUTTER_MEDIA (vtexture), argv[1]);
+  clutter_media_set_playing (CLUTTER_MEDIA (vtexture), TRUE);
+
+  clutter_actor_show_all (stage);
+  clutter_timeline_start (timeline);
+  g_timeout_add_seconds (duration, done_cb, &bench);
+
+  clutter_main ();
+
+  g_array_free (bench.intervals, TRUE);
+  g_timer_destroy (bench.timer);
+
+  return EXIT_SUCCESS;
+}
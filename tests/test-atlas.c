@@ -0,0 +1,87 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * test-atlas.c - Checks which GLs and streams the atlas of small I420
+ * streams takes, whichever renderer would draw the stream alone.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <glib.h>
+
+#include "clutter-helix-private.h"
+
+/* a desktop GL: the fp renderer draws I420 streams of their own */
+#define DESKTOP_FEATURES (CLUTTER_HELIX_FP |              \
+                          CLUTTER_HELIX_GLSL |            \
+                          CLUTTER_HELIX_MULTI_TEXTURE |   \
+                          CLUTTER_HELIX_MULTI_TEXTURE_4 | \
+                          CLUTTER_HELIX_TEXTURE_16)
+
+static void
+test_fp_and_glsl (void)
+{
+  g_assert (clutter_helix_atlas_accepts (DESKTOP_FEATURES, 320, 240));
+  g_assert (clutter_helix_atlas_accepts (DESKTOP_FEATURES,
+                                         CLUTTER_HELIX_ATLAS_MAX_STREAM,
+                                         CLUTTER_HELIX_ATLAS_MAX_STREAM));
+}
+
+static void
+test_glsl_only (void)
+{
+  g_assert (clutter_helix_atlas_accepts (CLUTTER_HELIX_GLSL |
+                                         CLUTTER_HELIX_MULTI_TEXTURE,
+                                         320, 240));
+}
+
+static void
+test_no_glsl (void)
+{
+  g_assert (!clutter_helix_atlas_accepts (CLUTTER_HELIX_FP |
+                                          CLUTTER_HELIX_MULTI_TEXTURE,
+                                          320, 240));
+  g_assert (!clutter_helix_atlas_accepts (CLUTTER_HELIX_GLSL, 320, 240));
+  /* left out by CLUTTER_HELIX_RENDERER */
+  g_assert (!clutter_helix_atlas_accepts (0, 320, 240));
+}
+
+static void
+test_large_stream (void)
+{
+  g_assert (!clutter_helix_atlas_accepts (DESKTOP_FEATURES,
+                                          CLUTTER_HELIX_ATLAS_MAX_STREAM + 1,
+                                          240));
+  g_assert (!clutter_helix_atlas_accepts (DESKTOP_FEATURES, 1280, 720));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/atlas/fp-and-glsl", test_fp_and_glsl);
+  g_test_add_func ("/atlas/glsl-only", test_glsl_only);
+  g_test_add_func ("/atlas/no-glsl", test_no_glsl);
+  g_test_add_func ("/atlas/large-stream", test_large_stream);
+
+  return g_test_run ();
+}
@@ -0,0 +1,188 @@
+/*
+ * Clutter-Helix.
+ *
+ * Helix integration library for Clutter.
+ *
+ * test-nv12.c - Checks the CPU side of the NV12 path: the reference
+ * conversion the NV12 renderers are written after, the color matrices they
+ * are given, and the downscaling of the interleaved chroma plane.
+ *
+ * Copyright 2009 Intel Corp.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <glib.h>
+
+#include "clutter-helix-private.h"
+
+#define TOLERANCE 2 /* per channel, the usual tables are rounded */
+
+typedef struct _Bar
+{
+  const gchar *name;
+  guchar       yuv[3];
+  guchar       rgb[3];
+} Bar;
+
+/* 8 bit limited range values of the primaries, from the standards */
+static const Bar bt601_bars[] =
+{
+  { "white", { 235, 128, 128 }, { 255, 255, 255 } },
+  { "black", {  16, 128, 128 }, {   0,   0,   0 } },
+  { "red",   {  81,  90, 240 }, { 255,   0,   0 } },
+  { "green", { 145,  54,  34 }, {   0, 255,   0 } },
+  { "blue",  {  41, 240, 110 }, {   0,   0, 255 } },
+};
+
+static const Bar bt709_bars[] =
+{
+  { "white", { 235, 128, 128 }, { 255, 255, 255 } },
+  { "red",   {  63, 102, 240 }, { 255,   0,   0 } },
+  { "green", { 173,  42,  26 }, {   0, 255,   0 } },
+  { "blue",  {  32, 240, 118 }, {   0,   0, 255 } },
+};
+
+#define BAR_WIDTH 4 /* pixels, 2 chroma samples */
+#define HEIGHT    4
+
+/* Paints @bars side by side in an NV12 frame, converts it and checks the
+ * pixels whose chroma doesn't come from two bars */
+static void
+check_bars (const Bar *bars,
+            guint      n_bars,
+            gboolean   bt709)
+{
+  guint width = n_bars * BAR_WIDTH, cw = width / 2, ch = HEIGHT / 2;
+  guchar *y_plane, *uv_plane, *rgb;
+  gfloat values[12];
+  guint b, x, y, c;
+
+  y_plane  = g_malloc (width * HEIGHT);
+  uv_plane = g_malloc (2 * cw * ch);
+  rgb      = g_malloc (3 * width * HEIGHT);
+
+  for (b = 0; b < n_bars; b++)
+    {
+      for (y = 0; y < HEIGHT; y++)
+        for (x = 0; x < BAR_WIDTH; x++)
+          y_plane[y * width + b * BAR_WIDTH + x] = bars[b].yuv[0];
+
+      for (y = 0; y < ch; y++)
+        for (x = 0; x < BAR_WIDTH / 2; x++)
+          {
+            guchar *pair = uv_plane + y * 2 * cw + 2 * (b * BAR_WIDTH / 2 + x);
+
+            pair[0] = bars[b].yuv[1];
+            pair[1] = bars[b].yuv[2];
+          }
+    }
+
+  clutter_helix_yuv_matrix (bt709, FALSE, 0.0, 1.0, 1.0, values);
+  clutter_helix_nv12_to_rgb (y_plane, width, uv_plane, 2 * cw,
+                             width, HEIGHT, values, rgb, 3 * width);
+
+  for (b = 0; b < n_bars; b++)
+    for (y = 0; y < HEIGHT; y++)
+      for (x = 1; x < BAR_WIDTH - 1; x++)
+        {
+          const guchar *pixel = rgb + y * 3 * width + 3 * (b * BAR_WIDTH + x);
+
+          for (c = 0; c < 3; c++)
+            if (ABS (pixel[c] - bars[b].rgb[c]) > TOLERANCE)
+              {
+                g_printerr ("%s %s at %u,%u: got %u,%u,%u, expected %u,%u,%u\n",
+                            bt709 ? "BT.709" : "BT.601", bars[b].name,
+                            b * BAR_WIDTH + x, y,
+                            pixel[0], pixel[1], pixel[2],
+                            bars[b].rgb[0], bars[b].rgb[1], bars[b].rgb[2]);
+                g_assert_not_reached ();
+              }
+        }
+
+  g_free (y_plane);
+  g_free (uv_plane);
+  g_free (rgb);
+}
+
+static void
+test_bt601 (void)
+{
+  check_bars (bt601_bars, G_N_ELEMENTS (bt601_bars), FALSE);
+}
+
+static void
+test_bt709 (void)
+{
+  check_bars (bt709_bars, G_N_ELEMENTS (bt709_bars), TRUE);
+}
+
+/* The default matrix has to agree with the constants of the cheap shader
+ * variant, YUV_FIXED_TO_RGB, which is used instead of it */
+static void
+test_fixed_matrix (void)
+{
+  static const gfloat fixed[12] =
+  {
+    1.1640625, 1.1640625,  1.1640625,
+    0,        -0.390625,   2.015625,
+    1.59765625, -0.8125,   0,
+    -1.1640625 * 0.0625 - 0.5 * 1.59765625,
+    -1.1640625 * 0.0625 + 0.5 * (0.390625 + 0.8125),
+    -1.1640625 * 0.0625 - 0.5 * 2.015625
+  };
+  gfloat values[12];
+  guint i;
+
+  clutter_helix_yuv_matrix (FALSE, FALSE, 0.0, 1.0, 1.0, values);
+
+  for (i = 0; i < 12; i++)
+    g_assert_cmpfloat (ABS (values[i] - fixed[i]), <, 0.01);
+}
+
+/* Halving the interleaved chroma plane averages U with U and V with V */
+static void
+test_halve_uv (void)
+{
+  static const guchar uv[] =
+  {
+    10, 200,  30, 100,  50,  0,  70, 50,
+    20, 210,  40, 110,  60, 10,  80, 60
+  };
+  static const guchar expected[] = { 25, 155, 65, 30 };
+  guchar half[4];
+  guint i;
+
+  clutter_helix_halve_plane (uv, 8, 4, 2, 2, half, 4);
+
+  for (i = 0; i < G_N_ELEMENTS (expected); i++)
+    g_assert_cmpint (half[i], ==, expected[i]);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/nv12/bt601", test_bt601);
+  g_test_add_func ("/nv12/bt709", test_bt709);
+  g_test_add_func ("/nv12/fixed-matrix", test_fixed_matrix);
+  g_test_add_func ("/nv12/halve-uv", test_halve_uv);
+
+  return g_test_run ();
+}